@@ -3,8 +3,10 @@
 out vec4 FragColor;
 
 struct Material {
+#ifndef BATCHED
     sampler2D diffuse;
     sampler2D specular;    
+#endif
     float shininess;
 }; 
 struct DirLight {
@@ -49,13 +51,29 @@ in vec3 FragPos;
 in vec2 vTexCoord;
 in vec3 vLocalPos;
 
-uniform float currFrame;
 uniform sampler2D texture1;
 uniform sampler2D texture2;
 
-uniform vec3 viewPos;
+// Written once per frame by FrameUniforms.h (time.x was currFrame)
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 time;
+};
 
 uniform Material material;
+
+// batched draws read every texture out of one array (MeshBatch.h)
+#ifdef BATCHED
+uniform sampler2DArray materialTextures;
+flat in vec2 vLayers;
+#define DIFFUSE(uv) texture(materialTextures, vec3(uv, vLayers.x))
+#define SPECULAR(uv) texture(materialTextures, vec3(uv, vLayers.y))
+#else
+#define DIFFUSE(uv) texture(material.diffuse, uv)
+#define SPECULAR(uv) texture(material.specular, uv)
+#endif
 uniform DirLight dirLight;
 uniform PointLight pointLights[NR_POINT_LIGHTS];
 uniform SpotLight spotLight;
@@ -68,7 +86,7 @@ void main()
 {
     // Basic properties
     vec3 norm = normalize(vNormal);
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(viewPos.xyz - FragPos);
 
     // Point lights
     // for (int i = 0; i < NR_POINT_LIGHTS; i++)
@@ -91,9 +109,9 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
     // combine
-    vec3 ambient  = light.ambient  * vec3(texture(material.diffuse, vTexCoord));
-    vec3 diffuse  = light.diffuse  * diff * vec3(texture(material.diffuse, vTexCoord));
-    vec3 specular = light.specular * spec * texture(material.specular, vTexCoord).rgb;
+    vec3 ambient  = light.ambient  * vec3(DIFFUSE(vTexCoord));
+    vec3 diffuse  = light.diffuse  * diff * vec3(DIFFUSE(vTexCoord));
+    vec3 specular = light.specular * spec * SPECULAR(vTexCoord).rgb;
     return (ambient + diffuse + specular);
 }
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
@@ -108,9 +126,9 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + 
                                 light.quadratic * (distance * distance));
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, vTexCoord));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, vTexCoord));
-    vec3 specular = light.specular * spec * texture(material.specular, vTexCoord).rgb;
+    vec3 ambient = light.ambient * vec3(DIFFUSE(vTexCoord));
+    vec3 diffuse = light.diffuse * diff * vec3(DIFFUSE(vTexCoord));
+    vec3 specular = light.specular * spec * SPECULAR(vTexCoord).rgb;
     ambient  *= attenuation; 
     diffuse  *= attenuation;
     specular *= attenuation; 
@@ -134,9 +152,9 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     // creates soft edges for spotlight
     float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
     // combine result
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, vTexCoord));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, vTexCoord));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, vTexCoord));
+    vec3 ambient = light.ambient * vec3(DIFFUSE(vTexCoord));
+    vec3 diffuse = light.diffuse * diff * vec3(DIFFUSE(vTexCoord));
+    vec3 specular = light.specular * spec * vec3(SPECULAR(vTexCoord));
     ambient *= intensity * attenuation;;
     diffuse *= intensity * attenuation;;
     specular *= intensity * attenuation;
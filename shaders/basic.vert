@@ -8,12 +8,34 @@ out vec2 vTexCoord;
 out vec3 FragPos;
 out vec3 vLocalPos;
 
+#ifdef BATCHED
+// MeshBatch.h: one draw per mesh out of shared buffers. The draw index comes
+// in as a per instance attribute (baseInstance picks it under multi draw
+// indirect), per draw data sits in a buffer texture, 5 texels a draw:
+// the model matrix columns, then the diffuse / specular layers.
+layout (location = 7) in int aDrawID;
+uniform samplerBuffer drawData;
+flat out vec2 vLayers;
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
+
+// Written once per frame by FrameUniforms.h
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 time;
+};
 
 void main()
 {
+#ifdef BATCHED
+    int base = aDrawID * 5;
+    mat4 model = mat4(texelFetch(drawData, base), texelFetch(drawData, base + 1),
+                      texelFetch(drawData, base + 2), texelFetch(drawData, base + 3));
+    vLayers = texelFetch(drawData, base + 4).xy;
+#endif
     mat3 normalMatrix = transpose(inverse(mat3(model)));
     vNormal = normalMatrix * aNormal;   
 
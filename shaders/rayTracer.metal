@@ -2,6 +2,11 @@
 #include <metal_stdlib>
 using namespace metal;
 
+// Set from MetalRenderer through MTLCompileOptions, 0 strips every counter
+#ifndef RT_ENABLE_STATS
+#define RT_ENABLE_STATS 1
+#endif
+
 // ray trace logic here
 struct Ray {
     float3 origin;
@@ -15,9 +20,66 @@ struct Sphere {
     float reflectivity;
     // float shininess; // for specular
 };
-struct Light {
-    float3 position;
-    float3 color;
+// Light layouts, must match GPULight / GPULightNode / GPULightParams in Shared.h
+struct GPULight {
+    float4 position; // w = intensity, 0 = no falloff
+    float4 color;
+};
+
+struct GPULightNode {
+    float4 boundsMin; // w = summed power below this node
+    float4 boundsMax;
+    int first;        // leaf: light index, interior: left child (right = first + 1)
+    int count;        // 1 = leaf
+    int pad[2];
+};
+
+struct GPULightParams {
+    uint count;
+    uint samples; // count <= samples shades every light
+    uint pad[2];
+};
+
+struct GPUSamplerParams {
+    uint type; // SamplerType in Random.h
+    uint samplesPerPixel;
+    uint frame;
+    uint pad;
+};
+
+// Scene layouts, must match GPUSphere / GPUMaterial / GPUSceneParams in
+// Shared.h and BVHNode in BVH.h (spheres come in BVH leaf order, GPUScene.h)
+struct GPUSphere {
+    packed_float3 center;
+    float radius;
+    uint material;
+    uint pad[3];
+};
+
+struct GPUMaterial {
+    packed_float3 color;
+    float reflectivity;
+};
+
+struct BVHNode {
+    packed_float3 boundsMin;
+    uint leftFirst; // interior: left child (right = left + 1), leaf: first sphere
+    packed_float3 boundsMax;
+    uint primCount; // 0 = interior
+};
+
+struct GPUSceneParams {
+    uint sphereCount;
+    uint nodeCount; // 0 = empty scene
+    uint pad[2];
+};
+
+// What the traversal needs, passed around instead of six buffer arguments
+struct SceneBuffers {
+    device const GPUSphere* spheres;
+    device const GPUMaterial* materials;
+    device const BVHNode* nodes;
+    uint nodeCount;
 };
 
 struct GPUCamera {
@@ -38,8 +100,149 @@ struct Hit {
     float3 color;
     float reflectivity;
 };
-constant int NUM_SPHERES = 5;
-constant int SAMPLES_PER = 4;
+constant float MISS = 1e30f;
+constant int STACK_SIZE = 64;
+
+// Counter slots, must match GPUStatSlot in Shared.h
+constant int STAT_PRIMARY_RAYS = 0;
+constant int STAT_SHADOW_RAYS = 1;
+constant int STAT_REFLECTION_RAYS = 2;
+constant int STAT_PRIMITIVE_TESTS = 3;
+constant int STAT_SHADOW_EARLY_OUTS = 4;
+constant int STAT_THROUGHPUT_CUTOFFS = 5;
+constant int STAT_SAMPLES = 6;
+constant int STAT_OCCLUDER_CACHE_LOOKUPS = 7;
+constant int STAT_OCCLUDER_CACHE_HITS = 8;
+constant int STAT_NODES_VISITED = 9;
+constant int STAT_COUNT = 10;
+
+// Per thread counters, live in registers and get flushed once at the end
+struct RayCounters {
+    uint c[STAT_COUNT] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+};
+
+#if RT_ENABLE_STATS
+#define STAT_ADD(counters, slot, n) ((counters).c[(slot)] += (n))
+#else
+#define STAT_ADD(counters, slot, n)
+#endif
+
+// Same samplers as Random.h, every number depends on (pixel, sample, frame, bounce, dimension)
+uint pcgHash(uint v) {
+    uint state = v * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+constant uint SAMPLER_GRID = 0;
+constant uint SAMPLER_RANDOM = 1;
+constant uint SAMPLER_SOBOL = 2;
+constant uint SAMPLER_BLUE_NOISE = 3;
+constant uint BLUE_NOISE_SIZE = 64;
+constant uint DIMS_PER_BOUNCE = 64;
+
+uint pcg4d(uint4 v) {
+    v = v * 1664525u + 1013904223u;
+    v.x += v.y * v.w; v.y += v.z * v.x; v.z += v.x * v.y; v.w += v.y * v.z;
+    v ^= v >> 16u;
+    v.x += v.y * v.w; v.y += v.z * v.x; v.z += v.x * v.y; v.w += v.y * v.z;
+    return v.x ^ v.w;
+}
+
+constant uint SOBOL_MATRICES[4][32] = {
+    {0x80000000u, 0x40000000u, 0x20000000u, 0x10000000u, 0x08000000u, 0x04000000u, 0x02000000u, 0x01000000u,
+     0x00800000u, 0x00400000u, 0x00200000u, 0x00100000u, 0x00080000u, 0x00040000u, 0x00020000u, 0x00010000u,
+     0x00008000u, 0x00004000u, 0x00002000u, 0x00001000u, 0x00000800u, 0x00000400u, 0x00000200u, 0x00000100u,
+     0x00000080u, 0x00000040u, 0x00000020u, 0x00000010u, 0x00000008u, 0x00000004u, 0x00000002u, 0x00000001u},
+    {0x80000000u, 0xc0000000u, 0xa0000000u, 0xf0000000u, 0x88000000u, 0xcc000000u, 0xaa000000u, 0xff000000u,
+     0x80800000u, 0xc0c00000u, 0xa0a00000u, 0xf0f00000u, 0x88880000u, 0xcccc0000u, 0xaaaa0000u, 0xffff0000u,
+     0x80008000u, 0xc000c000u, 0xa000a000u, 0xf000f000u, 0x88008800u, 0xcc00cc00u, 0xaa00aa00u, 0xff00ff00u,
+     0x80808080u, 0xc0c0c0c0u, 0xa0a0a0a0u, 0xf0f0f0f0u, 0x88888888u, 0xccccccccu, 0xaaaaaaaau, 0xffffffffu},
+    {0x80000000u, 0xc0000000u, 0x60000000u, 0x90000000u, 0xe8000000u, 0x5c000000u, 0x8e000000u, 0xc5000000u,
+     0x68800000u, 0x9cc00000u, 0xee600000u, 0x55900000u, 0x80680000u, 0xc09c0000u, 0x60ee0000u, 0x90550000u,
+     0xe8808000u, 0x5cc0c000u, 0x8e606000u, 0xc5909000u, 0x6868e800u, 0x9c9c5c00u, 0xeeee8e00u, 0x5555c500u,
+     0x8000e880u, 0xc0005cc0u, 0x60008e60u, 0x9000c590u, 0xe8006868u, 0x5c009c9cu, 0x8e00eeeeu, 0xc5005555u},
+    {0x80000000u, 0xc0000000u, 0x20000000u, 0x50000000u, 0xf8000000u, 0x74000000u, 0xa2000000u, 0x93000000u,
+     0xd8800000u, 0x25400000u, 0x59e00000u, 0xe6d00000u, 0x78080000u, 0xb40c0000u, 0x82020000u, 0xc3050000u,
+     0x208f8000u, 0x51474000u, 0xfbea2000u, 0x75d93000u, 0xa0858800u, 0x914e5400u, 0xdbe79e00u, 0x25db6d00u,
+     0x58800080u, 0xe54000c0u, 0x79e00020u, 0xb6d00050u, 0x800800f8u, 0xc00c0074u, 0x200200a2u, 0x50050093u}
+};
+
+uint sobol(uint index, uint dimension) {
+    uint x = 0;
+    for (int bit = 0; bit < 32; bit++)
+        x ^= SOBOL_MATRICES[dimension][bit] & (0u - ((index >> bit) & 1u));
+    return x;
+}
+
+uint owenScramble(uint x, uint seed) {
+    x = reverse_bits(x);
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return reverse_bits(x);
+}
+
+float sobolOwen(uint pixelSeed, uint sample, uint dimension) {
+    uint chunkSeed = pcgHash(pixelSeed ^ pcgHash(dimension / 4u));
+    uint index = owenScramble(sample, chunkSeed);
+    uint x = owenScramble(sobol(index, dimension % 4u), pcgHash(chunkSeed + dimension));
+    return float(x >> 8) * (1.0f / 16777216.0f);
+}
+
+float blueNoise(constant float* tile, uint x, uint y, uint sample, uint dimension, uint frame) {
+    uint shift = pcgHash((dimension + 0x68bc21ebu) ^ pcgHash(frame));
+    uint tx = (x + shift) & (BLUE_NOISE_SIZE - 1);
+    uint ty = (y + (shift >> 8)) & (BLUE_NOISE_SIZE - 1);
+    float step = (dimension & 1u) ? 0.569840291f : 0.754877666f;
+    return min(fract(tile[ty * BLUE_NOISE_SIZE + tx] + float(sample) * step), 0.99999994f);
+}
+
+struct SampleRng {
+    uint pixel;
+    uint pixelSeed;
+    uint x;
+    uint y;
+    uint sample;
+    uint frame;
+    uint bounce;
+    uint dimension;
+    uint type;
+    constant float* blueNoiseTile;
+};
+
+SampleRng makeRng(uint x, uint y, uint width, uint sample, uint type, uint frame, constant float* blueNoiseTile) {
+    SampleRng rng;
+    rng.pixel = y * width + x;
+    rng.pixelSeed = pcgHash(rng.pixel ^ pcgHash(frame + 0x9e3779b9u));
+    rng.x = x;
+    rng.y = y;
+    rng.sample = sample;
+    rng.frame = frame;
+    rng.bounce = 0;
+    rng.dimension = 0;
+    rng.type = type;
+    rng.blueNoiseTile = blueNoiseTile;
+    return rng;
+}
+
+void rngSetBounce(thread SampleRng& rng, uint bounce) {
+    if (bounce == rng.bounce) return;
+    rng.bounce = bounce;
+    rng.dimension = 0;
+}
+
+float rngNext(thread SampleRng& rng) {
+    uint d = rng.dimension++;
+    if (rng.type == SAMPLER_SOBOL)
+        return sobolOwen(rng.pixelSeed, rng.sample, rng.bounce * DIMS_PER_BOUNCE + d);
+    if (rng.type == SAMPLER_BLUE_NOISE)
+        return blueNoise(rng.blueNoiseTile, rng.x, rng.y, rng.sample, rng.bounce * DIMS_PER_BOUNCE + d, rng.frame);
+    uint bits = pcg4d(uint4(rng.pixel, rng.sample, rng.frame, (rng.bounce << 16) | (d & 0xffffu)));
+    return float(bits >> 8) * (1.0f / 16777216.0f);
+}
 
 /* ===================================
 TODO:
@@ -64,47 +267,72 @@ Later On (More Advance):
 =================================== */
 
 Ray generateRay(uint2 gid, float2 offset, constant GPUCamera* cam, uint2 gridSize);
-float3 traceRay(Ray ray, thread Sphere* spheres, Light light, float3 camPos);
+float3 traceRay(Ray ray, thread const SceneBuffers& scene, constant GPULight* lights, constant GPULightNode* lightNodes,
+                constant GPULightParams& lightParams, float3 camPos, thread SampleRng& rng,
+                thread int& lastOccluder, thread RayCounters& counters);
 bool intersectSphere(Ray ray, Sphere sphere, float tMin, float tMax, thread Hit& hit);
 
 kernel void rayTrace(
     texture2d<float, access::write> output [[texture(0)]],
     constant GPUCamera* camera [[buffer(0)]],
+    device atomic_uint* stats [[buffer(1)]], // lo, hi word per slot (GPUStats)
+    constant GPULight* lights [[buffer(2)]],
+    constant GPULightNode* lightNodes [[buffer(3)]],
+    constant GPULightParams& lightParams [[buffer(4)]],
+    constant GPUSamplerParams& samplerParams [[buffer(5)]],
+    constant float* blueNoiseTile [[buffer(6)]],
+    device const GPUSphere* sceneSpheres [[buffer(7)]],
+    device const GPUMaterial* materials [[buffer(8)]],
+    device const BVHNode* nodes [[buffer(9)]],
+    constant GPUSceneParams& sceneParams [[buffer(10)]],
     uint2 gid [[thread_position_in_grid]],
     uint2 gridSize [[threads_per_grid]])
 {
-    // Define Sphere and Light
-    Sphere spheres[NUM_SPHERES] = {
-        {{6.0, 5.5, 0.0}, 0.1, {1.0, 1.0, 1.0}, 0.0}, // Small sphere above light
-        // {{0.0, 0.0, -5.0}, 1.0, {0.7, 0.4, 0.7}, 0.2},       // Magenta Sphere
-        {{0.0, 0.0, -5.0}, 1.0, {1.0, 0.0, 0.0}, 0.0},       // Magenta Sphere
-        {{2.2, 1.0, -6.0}, 1.0, {0.0, 1.0, 0.0}, 0.8},       // Green Sphere
-         {{4.5, 0.0, -5.0}, 1.0, {0.9, 0.9, 0.9}, 0.95},   // Silver
-        {{0.0, -101.5, -5.0}, 100.0, {0.5, 0.5, 0.5}, 0.3}   // Ground (gray)
-    };
-    Light light = {{5.0, 5.0, 0.0}, {1.0, 1.0, 1.0}};
+    // Spheres, materials and their BVH come from GPUScene, lights from the light buffers
+    SceneBuffers scene = {sceneSpheres, materials, nodes, sceneParams.nodeCount};
 
     // Same typical logic for CPU ray tracing
     // but runs per pixel parallel, more efficient
 
     // gid.x = x && gid.y = y
 
-    float2 offsets[4] = { // can generalize this by making it based of size and step
-        {-0.25, -0.25},  // Top-left
-        {0.25, -0.25},  // Top-right  
-        {-0.25, 0.25},  // Bottom-left
-        {0.25, 0.25}    // Bottom-right
-    };
+    // k x k grid offsets for SAMPLER_GRID (the old {+-0.25, +-0.25} at 4 samples),
+    // every other sampler jitters with its first two dimensions
+    const uint samples = max(samplerParams.samplesPerPixel, 1u);
+    const uint k = uint(ceil(sqrt(float(samples))));
+
+    RayCounters counters;
+    int lastOccluder = -1; // sphere (GPU order) that blocked this thread's last shadow ray
 
     float3 finalColor = float3(0.0);
-    for (int sample = 0; sample < SAMPLES_PER; sample++) { // Generates basic Anti-Alisasing
-        Ray ray = generateRay(gid, offsets[sample], camera, gridSize);
-        float3 color = traceRay(ray, spheres, light, camera->position.xyz);
+    for (uint sample = 0; sample < samples; sample++) { // Generates basic Anti-Alisasing
+        SampleRng rng = makeRng(gid.x, gid.y, gridSize.x, sample, samplerParams.type, samplerParams.frame, blueNoiseTile);
+        float2 offset = (float2(sample % k, sample / k) + 0.5) / float(k) - 0.5;
+        if (samplerParams.type != SAMPLER_GRID) {
+            offset.x = rngNext(rng) - 0.5;
+            offset.y = rngNext(rng) - 0.5;
+        }
+        Ray ray = generateRay(gid, offset, camera, gridSize);
+        STAT_ADD(counters, STAT_PRIMARY_RAYS, 1);
+        STAT_ADD(counters, STAT_SAMPLES, 1);
+        float3 color = traceRay(ray, scene, lights, lightNodes, lightParams, camera->position.xyz, rng, lastOccluder, counters);
 
         finalColor += color;
     }
 
-    finalColor /= float(SAMPLES_PER);
+#if RT_ENABLE_STATS
+    // one atomic per simdgroup instead of one per pixel
+    for (int i = 0; i < STAT_COUNT; i++) {
+        uint total = simd_sum(counters.c[i]);
+        if (simd_is_first() && total != 0) {
+            uint before = atomic_fetch_add_explicit(&stats[2 * i], total, memory_order_relaxed);
+            if (before + total < before) // lo wrapped, carry
+                atomic_fetch_add_explicit(&stats[2 * i + 1], 1u, memory_order_relaxed);
+        }
+    }
+#endif
+
+    finalColor /= float(samples);
     // float3 color = ray.direction * 0.5 + 0.5;
     // float3 color = float3(camera->fov, camera->fov, camera->fov);
 
@@ -131,7 +359,174 @@ Ray generateRay(uint2 gid, float2 offset, constant GPUCamera* cam, uint2 gridSiz
     return genRay;
 }
 
-float3 traceRay(Ray primaryRay, thread Sphere* spheres, Light light, float3 camPos) {
+Sphere sceneSphere(thread const SceneBuffers& scene, uint i) {
+    GPUSphere s = scene.spheres[i];
+    GPUMaterial m = scene.materials[s.material];
+    return {float3(s.center), s.radius, float3(m.color), m.reflectivity};
+}
+
+// Entry distance of the ray into the node's box, MISS if it doesn't get in before tMax
+float slabs(device const BVHNode& node, float3 origin, float3 invDir, float tMin, float tMax) {
+    float3 t0 = (float3(node.boundsMin) - origin) * invDir;
+    float3 t1 = (float3(node.boundsMax) - origin) * invDir;
+    float3 tSmall = min(t0, t1);
+    float3 tBig = max(t0, t1);
+    float tEnter = max(max(tSmall.x, tSmall.y), max(tSmall.z, tMin));
+    float tExit = min(min(tBig.x, tBig.y), min(tBig.z, tMax));
+    return tEnter <= tExit ? tEnter : MISS;
+}
+
+// Closest hit through the BVH, nearer child first, same walk as BVH::closestHit
+bool intersectScene(thread const SceneBuffers& scene, Ray ray, float tMin, float tMax, thread Hit& hit,
+                    thread RayCounters& counters) {
+    if (scene.nodeCount == 0) return false;
+    float3 invDir = 1.0f / ray.direction;
+    uint stack[STACK_SIZE];
+    int stackSize = 0;
+    uint node = 0;
+    bool found = false;
+    while (true) {
+        STAT_ADD(counters, STAT_NODES_VISITED, 1);
+        uint count = scene.nodes[node].primCount;
+        if (count > 0) {
+            uint first = scene.nodes[node].leftFirst;
+            for (uint i = 0; i < count; i++) {
+                STAT_ADD(counters, STAT_PRIMITIVE_TESTS, 1);
+                if (intersectSphere(ray, sceneSphere(scene, first + i), tMin, tMax, hit)) {
+                    tMax = hit.t;
+                    found = true;
+                }
+            }
+            if (stackSize == 0) break;
+            node = stack[--stackSize];
+            continue;
+        }
+        uint left = scene.nodes[node].leftFirst, right = left + 1;
+        float tLeft = slabs(scene.nodes[left], ray.origin, invDir, tMin, tMax);
+        float tRight = slabs(scene.nodes[right], ray.origin, invDir, tMin, tMax);
+        if (tLeft > tRight) {
+            float t = tLeft; tLeft = tRight; tRight = t;
+            uint n = left; left = right; right = n;
+        }
+        if (tLeft == MISS) {
+            if (stackSize == 0) break;
+            node = stack[--stackSize];
+            continue;
+        }
+        node = left;
+        if (tRight != MISS) stack[stackSize++] = right;
+    }
+    return found;
+}
+
+// Any hit, stops at the first blocker and remembers it in lastOccluder
+bool occludedScene(thread const SceneBuffers& scene, Ray ray, float tMin, float tMax,
+                   thread int& lastOccluder, thread RayCounters& counters) {
+    Hit shadowHit;
+    // last occluder first, neighbouring samples usually share it
+    if (lastOccluder >= 0) {
+        STAT_ADD(counters, STAT_OCCLUDER_CACHE_LOOKUPS, 1);
+        STAT_ADD(counters, STAT_PRIMITIVE_TESTS, 1);
+        if (intersectSphere(ray, sceneSphere(scene, uint(lastOccluder)), tMin, tMax, shadowHit)) {
+            STAT_ADD(counters, STAT_OCCLUDER_CACHE_HITS, 1);
+            return true;
+        }
+    }
+    if (scene.nodeCount == 0) return false;
+    float3 invDir = 1.0f / ray.direction;
+    if (slabs(scene.nodes[0], ray.origin, invDir, tMin, tMax) == MISS) return false;
+    uint stack[STACK_SIZE];
+    int stackSize = 0;
+    uint node = 0;
+    while (true) {
+        STAT_ADD(counters, STAT_NODES_VISITED, 1);
+        uint count = scene.nodes[node].primCount;
+        if (count > 0) {
+            uint first = scene.nodes[node].leftFirst;
+            for (uint i = 0; i < count; i++) {
+                if (int(first + i) == lastOccluder) continue;
+                STAT_ADD(counters, STAT_PRIMITIVE_TESTS, 1);
+                if (intersectSphere(ray, sceneSphere(scene, first + i), tMin, tMax, shadowHit)) {
+                    lastOccluder = int(first + i);
+                    return true;
+                }
+            }
+        } else {
+            uint left = scene.nodes[node].leftFirst;
+            if (slabs(scene.nodes[left], ray.origin, invDir, tMin, tMax) != MISS) stack[stackSize++] = left;
+            if (slabs(scene.nodes[left + 1], ray.origin, invDir, tMin, tMax) != MISS) stack[stackSize++] = left + 1;
+        }
+        if (stackSize == 0) return false;
+        node = stack[--stackSize];
+    }
+}
+
+// Diffuse + specular from one light, with its shadow ray
+float3 shadeLight(Hit hit, float3 viewDir, GPULight light, thread const SceneBuffers& scene,
+                  thread int& lastOccluder, thread RayCounters& counters) {
+    float tMin = 0.001f;
+    float3 lightPos = light.position.xyz;
+    float3 lightDir = normalize(lightPos - hit.point);
+    float diffuse = max(dot(hit.normal, lightDir), 0.0f);
+
+    float3 reflectDir = reflect(-lightDir, hit.normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+
+    // float ior = 1.5; // (Index of refraction)
+    // float3 refracted = refract(currentRay.direction, hit.normal, 1.0 / ior);
+
+    // Shadow Test
+    Ray shadowRay;
+    shadowRay.direction = lightDir;
+    shadowRay.origin = hit.point;
+    float dist_to_light = distance(hit.point, lightPos);
+
+    STAT_ADD(counters, STAT_SHADOW_RAYS, 1);
+    if (occludedScene(scene, shadowRay, tMin, dist_to_light, lastOccluder, counters)) {
+        diffuse *= 0.2;
+        STAT_ADD(counters, STAT_SHADOW_EARLY_OUTS, 1);
+    }
+
+    float falloff = light.position.w > 0.0f ? light.position.w / (dist_to_light * dist_to_light) : 1.0f;
+    return (hit.color * diffuse * light.color.xyz + float3(1.0) * spec * 0.2) * falloff;
+}
+
+// Estimated contribution of a light BVH node at p, same as LightBVH::importance
+float lightImportance(GPULightNode node, float3 p) {
+    float3 d = p - 0.5f * (node.boundsMin.xyz + node.boundsMax.xyz);
+    float3 halfExtent = 0.5f * (node.boundsMax.xyz - node.boundsMin.xyz);
+    float dist2 = max(dot(d, d), dot(halfExtent, halfExtent));
+    return node.boundsMin.w / max(dist2, 1e-4f);
+}
+
+// Walks the light BVH picking children by importance, same as LightBVH::sample
+int sampleLight(constant GPULightNode* nodes, float3 p, float u, thread float& pdf) {
+    pdf = 0.0f;
+    float prob = 1.0f;
+    int index = 0;
+    while (nodes[index].count == 0) {
+        int left = nodes[index].first;
+        float wl = lightImportance(nodes[left], p);
+        float wr = lightImportance(nodes[left + 1], p);
+        if (wl + wr <= 0.0f) return -1;
+        float pl = wl / (wl + wr);
+        if (u < pl) {
+            u = min(u / pl, 0.99999994f);
+            prob *= pl;
+            index = left;
+        } else {
+            u = min((u - pl) / (1.0f - pl), 0.99999994f);
+            prob *= 1.0f - pl;
+            index = left + 1;
+        }
+    }
+    pdf = prob;
+    return nodes[index].first;
+}
+
+float3 traceRay(Ray primaryRay, thread const SceneBuffers& scene, constant GPULight* lights, constant GPULightNode* lightNodes,
+                constant GPULightParams& lightParams, float3 camPos, thread SampleRng& rng,
+                thread int& lastOccluder, thread RayCounters& counters) {
     float3 finalColor = float3(0.0);
     float3 throughPut = float3(1.0);
     Ray currentRay = primaryRay;
@@ -139,46 +534,31 @@ float3 traceRay(Ray primaryRay, thread Sphere* spheres, Light light, float3 camP
     int maxBounces = 4;
 
     for(int bounce=0; bounce < maxBounces; bounce++){
+        if (bounce > 0) STAT_ADD(counters, STAT_REFLECTION_RAYS, 1);
+        rngSetBounce(rng, bounce);
         Hit hit;
         float tMin = 0.001f; // Removes too close
         float tMax = 9999.9f;
             
         // Calculates intersect
-        for (int i=0; i < NUM_SPHERES; i++){
-            if(intersectSphere(currentRay, spheres[i], tMin, tMax, hit)) {
-                tMax = hit.t;
-            }
-        }
+        intersectScene(scene, currentRay, tMin, tMax, hit, counters);
 
         // if ray hits calculates shadow and returns color
         if(hit.hit) {
-            float3 lightDir = normalize(light.position - hit.point);
-            float diffuse = max(dot(hit.normal, lightDir), 0.0f);
-
             float3 viewDir = normalize(camPos - hit.point);
-            float3 reflectDir = reflect(-lightDir, hit.normal);
-            float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
-
-            // float ior = 1.5; // (Index of refraction)
-            // float3 refracted = refract(currentRay.direction, hit.normal, 1.0 / ior);
-
-            // Shadow Test
-            Ray shadowRay;
-            shadowRay.direction = lightDir;
-            shadowRay.origin = hit.point;
-            float dist_to_light = distance(hit.point, light.position);
-            
-            Hit shadowHit;
-            for(int i=0; i < NUM_SPHERES; i++) {
-                // if(sphere.matID == hit.matID) continue;
-                if(intersectSphere(shadowRay, spheres[i], tMin, dist_to_light, shadowHit)){
-                    diffuse *= 0.2;
-                    break;
+            float3 directLight = float3(0.0);
+            if (lightParams.count <= lightParams.samples) {
+                for (uint i = 0; i < lightParams.count; i++)
+                    directLight += shadeLight(hit, viewDir, lights[i], scene, lastOccluder, counters);
+            } else {
+                // pick a few lights through the light BVH, weighted by 1 / (pdf * samples)
+                for (uint s = 0; s < lightParams.samples; s++) {
+                    float pdf;
+                    int light = sampleLight(lightNodes, hit.point, rngNext(rng), pdf);
+                    if (light < 0 || pdf <= 0.0f) continue;
+                    directLight += shadeLight(hit, viewDir, lights[light], scene, lastOccluder, counters) / (pdf * float(lightParams.samples));
                 }
             }
-            
-            float3 directLight = hit.color * diffuse * light.color + float3(1.0) * spec * 0.2;
-            // float3 directLight = hit.color * diffuse * light.color;
             finalColor += throughPut * directLight;
 
             if (hit.reflectivity < 0.001) {
@@ -188,6 +568,7 @@ float3 traceRay(Ray primaryRay, thread Sphere* spheres, Light light, float3 camP
             throughPut *= hit.color * hit.reflectivity;
 
             if (length(throughPut) < 0.001) {
+                STAT_ADD(counters, STAT_THROUGHPUT_CUTOFFS, 1);
                 break;
             }
 
@@ -0,0 +1,419 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+
+#include "Profiler.h"
+#include "RenderStats.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+struct AABB {
+    glm::vec3 min = glm::vec3(1e30f);
+    glm::vec3 max = glm::vec3(-1e30f);
+
+    void grow(const glm::vec3& p) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    void grow(const AABB& b) {
+        min = glm::min(min, b.min);
+        max = glm::max(max, b.max);
+    }
+    glm::vec3 center() const { return 0.5f * (min + max); }
+    float area() const {
+        glm::vec3 e = max - min;
+        if (e.x < 0.0f) return 0.0f; // empty box
+        return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+};
+
+// Planes through one point with their normals pointing inwards, the shape a
+// tile's camera rays sweep out. Only the sides, there's no near or far plane.
+struct Frustum {
+    glm::vec4 planes[4]; // inside when dot(xyz, p) + w >= 0
+
+    // Apex plus the directions along the four edges, in order around the frustum
+    static Frustum fromCorners(const glm::vec3& apex, const glm::vec3 corners[4])
+    {
+        Frustum f;
+        const glm::vec3 middle = corners[0] + corners[1] + corners[2] + corners[3];
+        for (int i = 0; i < 4; i++) {
+            glm::vec3 n = glm::cross(corners[i], corners[(i + 1) % 4]);
+            if (glm::dot(n, middle) < 0.0f) n = -n; // whichever way round the corners came in
+            f.planes[i] = glm::vec4(n, -glm::dot(n, apex));
+        }
+        return f;
+    }
+
+    // Conservative, a box near a corner of the frustum can pass without touching it
+    bool overlaps(const glm::vec3& boxMin, const glm::vec3& boxMax) const
+    {
+        for (const glm::vec4& plane : planes) {
+            // the box corner furthest along the normal
+            glm::vec3 p(plane.x >= 0.0f ? boxMax.x : boxMin.x,
+                        plane.y >= 0.0f ? boxMax.y : boxMin.y,
+                        plane.z >= 0.0f ? boxMax.z : boxMin.z);
+            if (glm::dot(glm::vec3(plane), p) + plane.w < 0.0f) return false;
+        }
+        return true;
+    }
+
+    bool overlapsSphere(const glm::vec3& center, float radius) const
+    {
+        for (const glm::vec4& plane : planes)
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius * glm::length(glm::vec3(plane)))
+                return false;
+        return true;
+    }
+};
+
+// Nodes a bundle of rays starts at instead of the root, see BVH::findEntryNodes.
+// count == 0 means the bundle can't hit anything.
+struct BVHEntrySet {
+    static constexpr int CAPACITY = 8;
+    uint32_t nodes[CAPACITY];
+    int count = 0;
+};
+
+// 32 bytes, two nodes per cache line
+struct BVHNode {
+    glm::vec3 boundsMin;
+    uint32_t leftFirst;   // interior: index of left child (right = left + 1), leaf: first primitive
+    glm::vec3 boundsMax;
+    uint32_t primCount;   // 0 for interior nodes
+};
+
+// Knobs worth tuning against the traversal heatmap
+struct BVHBuildSettings {
+    int maxLeafSize = 2;       // stop splitting at or below this many primitives
+    int sahBins = 12;          // binned SAH, more bins = better splits, slower build
+    float traversalCost = 1.0f; // relative cost of one node visit vs one primitive test
+};
+
+// Binary BVH over anything that can give an AABB per primitive.
+// Primitive tests are callbacks so the same tree serves spheres, triangles etc.
+class BVH {
+public:
+    std::vector<BVHNode> nodes;
+    std::vector<uint32_t> primIndices; // leaves index into this
+
+    template <typename BoundsFn>
+    void build(uint32_t primCount, BoundsFn boundsOf, const BVHBuildSettings& settings = BVHBuildSettings())
+    {
+        PROFILE_SCOPE("BVH::build", "build");
+        this->settings = settings;
+        nodes.clear();
+        primIndices.resize(primCount);
+        primBounds.resize(primCount);
+        primCenters.resize(primCount);
+        for (uint32_t i = 0; i < primCount; i++) {
+            primIndices[i] = i;
+            primBounds[i] = boundsOf(i);
+            primCenters[i] = primBounds[i].center();
+        }
+        if (primCount == 0) return;
+
+        nodes.reserve(2 * primCount);
+        nodes.push_back(BVHNode{});
+        nodes[0].leftFirst = 0;
+        nodes[0].primCount = primCount;
+        updateBounds(0);
+        subdivide(0);
+
+        primBounds.clear();
+        primBounds.shrink_to_fit();
+        primCenters.clear();
+        primCenters.shrink_to_fit();
+    }
+
+    bool empty() const { return nodes.empty(); }
+
+    // Cuts the tree down to what a frustum can see, once per bundle of rays
+    // (a tile of camera rays). Walks down breadth first, dropping children
+    // outside the frustum, until the cut has CAPACITY nodes or only leaves.
+    // Leaves where primVisible(prim) is false for every primitive go too,
+    // a huge primitive's box can cover the frustum while the primitive doesn't.
+    template <typename VisibleFn>
+    void findEntryNodes(const Frustum& frustum, BVHEntrySet& entry, VisibleFn primVisible) const
+    {
+        entry.count = 0;
+        if (nodes.empty() || !frustum.overlaps(nodes[0].boundsMin, nodes[0].boundsMax)) return;
+
+        // ring buffer, queued + kept nodes never go over CAPACITY
+        const int capacity = BVHEntrySet::CAPACITY;
+        uint32_t queue[BVHEntrySet::CAPACITY];
+        int head = 0, queued = 1;
+        queue[0] = 0;
+        while (queued > 0) {
+            const uint32_t nodeIdx = queue[head];
+            head = (head + 1) % capacity;
+            queued--;
+            const BVHNode& node = nodes[nodeIdx];
+            if (node.primCount > 0) {
+                for (uint32_t i = 0; i < node.primCount; i++) {
+                    if (primVisible(primIndices[node.leftFirst + i])) {
+                        entry.nodes[entry.count++] = nodeIdx;
+                        break;
+                    }
+                }
+                continue;
+            }
+            uint32_t children[2];
+            int childCount = 0;
+            for (uint32_t child = node.leftFirst; child <= node.leftFirst + 1; child++)
+                if (frustum.overlaps(nodes[child].boundsMin, nodes[child].boundsMax)) children[childCount++] = child;
+            if (entry.count + queued + childCount > capacity) {
+                entry.nodes[entry.count++] = nodeIdx; // full, rays start here
+                continue;
+            }
+            for (int i = 0; i < childCount; i++) queue[(head + queued++) % capacity] = children[i];
+        }
+    }
+
+    // intersectPrim(prim, tMax) returns the hit distance or a negative number on a miss.
+    // With an entry set the walk starts at its nodes (nearest first) instead of the root.
+    template <typename IntersectFn>
+    bool closestHit(const glm::vec3& origin, const glm::vec3& dir, float tMin, float tMax,
+                    IntersectFn intersectPrim, RenderStats& stats, const BVHEntrySet* entry = nullptr) const
+    {
+        if (nodes.empty()) return false;
+        glm::vec3 invDir = 1.0f / dir;
+        bool found = false;
+
+        // the other entry nodes wait under a full depth stack
+        uint32_t stack[64 + BVHEntrySet::CAPACITY];
+        int stackSize = 0;
+        uint32_t nodeIdx = 0;
+        if (entry) {
+            stackSize = pushEntries(*entry, origin, invDir, tMin, tMax, stack);
+            if (stackSize == 0) return false;
+            nodeIdx = stack[--stackSize];
+        }
+        while (true) {
+            const BVHNode& node = nodes[nodeIdx];
+            RT_STAT(stats, nodesVisited, 1);
+            if (node.primCount > 0) {
+                for (uint32_t i = 0; i < node.primCount; i++) {
+                    float t = intersectPrim(primIndices[node.leftFirst + i], tMax);
+                    if (t >= 0.0f) {
+                        tMax = t;
+                        found = true;
+                    }
+                }
+                if (stackSize == 0) break;
+                nodeIdx = stack[--stackSize];
+                continue;
+            }
+            // visit the nearer child first, push the other one
+            uint32_t left = node.leftFirst, right = node.leftFirst + 1;
+            float tLeft = slabs(nodes[left], origin, invDir, tMin, tMax);
+            float tRight = slabs(nodes[right], origin, invDir, tMin, tMax);
+            if (tLeft > tRight) {
+                std::swap(tLeft, tRight);
+                std::swap(left, right);
+            }
+            if (tLeft == MISS) {
+                if (stackSize == 0) break;
+                nodeIdx = stack[--stackSize];
+                continue;
+            }
+            nodeIdx = left;
+            if (tRight != MISS) stack[stackSize++] = right;
+        }
+        return found;
+    }
+
+    // occludedPrim(prim) returns true on any hit, traversal stops right there
+    template <typename OccludeFn>
+    bool anyHit(const glm::vec3& origin, const glm::vec3& dir, float tMin, float tMax,
+                OccludeFn occludedPrim, RenderStats& stats) const
+    {
+        if (nodes.empty()) return false;
+        glm::vec3 invDir = 1.0f / dir;
+
+        if (slabs(nodes[0], origin, invDir, tMin, tMax) == MISS) return false;
+
+        uint32_t stack[64];
+        int stackSize = 0;
+        uint32_t nodeIdx = 0;
+        while (true) {
+            const BVHNode& node = nodes[nodeIdx];
+            RT_STAT(stats, nodesVisited, 1);
+            if (node.primCount > 0) {
+                for (uint32_t i = 0; i < node.primCount; i++)
+                    if (occludedPrim(primIndices[node.leftFirst + i])) return true;
+                if (stackSize == 0) return false;
+                nodeIdx = stack[--stackSize];
+                continue;
+            }
+            // children are culled before they get pushed, the nearer one goes
+            // first since it's more likely to hold a blocker close to the origin
+            uint32_t left = node.leftFirst, right = node.leftFirst + 1;
+            float tLeft = slabs(nodes[left], origin, invDir, tMin, tMax);
+            float tRight = slabs(nodes[right], origin, invDir, tMin, tMax);
+            if (tLeft > tRight) {
+                std::swap(tLeft, tRight);
+                std::swap(left, right);
+            }
+            if (tLeft == MISS) {
+                if (stackSize == 0) return false;
+                nodeIdx = stack[--stackSize];
+                continue;
+            }
+            nodeIdx = left;
+            if (tRight != MISS) stack[stackSize++] = right;
+        }
+    }
+
+    static constexpr float MISS = 1e30f;
+    static constexpr int MAX_DEPTH = 60; // traversal stacks hold 64 entries
+
+    // Entry distance into the node's box, MISS if the ray skips it
+    static float slabs(const BVHNode& node, const glm::vec3& origin, const glm::vec3& invDir,
+                       float tMin, float tMax)
+    {
+        glm::vec3 t0 = (node.boundsMin - origin) * invDir;
+        glm::vec3 t1 = (node.boundsMax - origin) * invDir;
+        glm::vec3 tSmall = glm::min(t0, t1);
+        glm::vec3 tBig = glm::max(t0, t1);
+        float tEnter = std::max(std::max(tSmall.x, tSmall.y), std::max(tSmall.z, tMin));
+        float tExit = std::min(std::min(tBig.x, tBig.y), std::min(tBig.z, tMax));
+        return tEnter <= tExit ? tEnter : MISS;
+    }
+
+private:
+    BVHBuildSettings settings;
+
+    // Entry nodes the ray enters, pushed so the nearest one comes off first
+    int pushEntries(const BVHEntrySet& entry, const glm::vec3& origin, const glm::vec3& invDir,
+                    float tMin, float tMax, uint32_t* stack) const
+    {
+        float tEnter[BVHEntrySet::CAPACITY];
+        int count = 0;
+        for (int i = 0; i < entry.count; i++) {
+            float t = slabs(nodes[entry.nodes[i]], origin, invDir, tMin, tMax);
+            if (t == MISS) continue;
+            int j = count++;
+            for (; j > 0 && tEnter[j - 1] < t; j--) { // far to near
+                tEnter[j] = tEnter[j - 1];
+                stack[j] = stack[j - 1];
+            }
+            tEnter[j] = t;
+            stack[j] = entry.nodes[i];
+        }
+        return count;
+    }
+    std::vector<AABB> primBounds;     // build time only
+    std::vector<glm::vec3> primCenters;
+
+    void updateBounds(uint32_t nodeIdx)
+    {
+        BVHNode& node = nodes[nodeIdx];
+        AABB box;
+        for (uint32_t i = 0; i < node.primCount; i++)
+            box.grow(primBounds[primIndices[node.leftFirst + i]]);
+        node.boundsMin = box.min;
+        node.boundsMax = box.max;
+    }
+
+    // Binned SAH split, returns the cost of the best split (axis/position out)
+    float findBestSplit(const BVHNode& node, int& bestAxis, float& bestPos) const
+    {
+        const int binCount = std::max(2, settings.sahBins);
+        float bestCost = 1e30f;
+        for (int axis = 0; axis < 3; axis++) {
+            float cMin = 1e30f, cMax = -1e30f;
+            for (uint32_t i = 0; i < node.primCount; i++) {
+                float c = primCenters[primIndices[node.leftFirst + i]][axis];
+                cMin = std::min(cMin, c);
+                cMax = std::max(cMax, c);
+            }
+            if (cMin == cMax) continue;
+
+            std::vector<AABB> binBounds(binCount);
+            std::vector<uint32_t> binCounts(binCount, 0);
+            float scale = binCount / (cMax - cMin);
+            for (uint32_t i = 0; i < node.primCount; i++) {
+                uint32_t prim = primIndices[node.leftFirst + i];
+                int bin = std::min(binCount - 1, (int)((primCenters[prim][axis] - cMin) * scale));
+                binCounts[bin]++;
+                binBounds[bin].grow(primBounds[prim]);
+            }
+
+            // sweep from both sides to get the area/count of every split plane
+            std::vector<float> leftArea(binCount - 1), rightArea(binCount - 1);
+            std::vector<uint32_t> leftCount(binCount - 1), rightCount(binCount - 1);
+            AABB leftBox, rightBox;
+            uint32_t leftSum = 0, rightSum = 0;
+            for (int i = 0; i < binCount - 1; i++) {
+                leftSum += binCounts[i];
+                leftCount[i] = leftSum;
+                leftBox.grow(binBounds[i]);
+                leftArea[i] = leftBox.area();
+                rightSum += binCounts[binCount - 1 - i];
+                rightCount[binCount - 2 - i] = rightSum;
+                rightBox.grow(binBounds[binCount - 1 - i]);
+                rightArea[binCount - 2 - i] = rightBox.area();
+            }
+            for (int i = 0; i < binCount - 1; i++) {
+                if (leftCount[i] == 0 || rightCount[i] == 0) continue;
+                float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestPos = cMin + (i + 1) / scale;
+                }
+            }
+        }
+        return bestCost;
+    }
+
+    void subdivide(uint32_t nodeIdx, int depth = 0)
+    {
+        BVHNode node = nodes[nodeIdx];
+        if ((int)node.primCount <= settings.maxLeafSize) return;
+        if (depth >= MAX_DEPTH) return; // keeps the traversal stacks bounded
+
+        int axis = -1;
+        float splitPos = 0.0f;
+        float splitCost = findBestSplit(node, axis, splitPos);
+        if (axis < 0) return; // all centers on top of each other
+
+        // compare against just testing everything in this node
+        AABB box;
+        box.min = node.boundsMin;
+        box.max = node.boundsMax;
+        float leafCost = node.primCount * box.area();
+        splitCost = settings.traversalCost * box.area() + splitCost;
+        if (splitCost >= leafCost && (int)node.primCount <= 4 * settings.maxLeafSize) return;
+
+        // partition primitives in place
+        uint32_t i = node.leftFirst;
+        uint32_t j = node.leftFirst + node.primCount - 1;
+        while (i <= j && j != UINT32_MAX) {
+            if (primCenters[primIndices[i]][axis] < splitPos) i++;
+            else std::swap(primIndices[i], primIndices[j--]);
+        }
+        uint32_t leftCount = i - node.leftFirst;
+        if (leftCount == 0 || leftCount == node.primCount) return;
+
+        uint32_t leftIdx = (uint32_t)nodes.size();
+        nodes.push_back(BVHNode{});
+        nodes.push_back(BVHNode{});
+        nodes[leftIdx].leftFirst = node.leftFirst;
+        nodes[leftIdx].primCount = leftCount;
+        nodes[leftIdx + 1].leftFirst = i;
+        nodes[leftIdx + 1].primCount = node.primCount - leftCount;
+        nodes[nodeIdx].leftFirst = leftIdx;
+        nodes[nodeIdx].primCount = 0;
+        updateBounds(leftIdx);
+        updateBounds(leftIdx + 1);
+        subdivide(leftIdx, depth + 1);
+        subdivide(leftIdx + 1, depth + 1);
+    }
+};
+
+#endif
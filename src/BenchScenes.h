@@ -0,0 +1,137 @@
+#ifndef BENCH_SCENES_H
+#define BENCH_SCENES_H
+
+#include <glm/glm.hpp>
+
+#include "CpuRenderer.h"
+#include "Scene.h"
+#include "Shared.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Fixed inputs for the benchmarks. Everything comes from a seeded LCG so the
+// same build always measures the same rays against the same primitives.
+namespace BenchScenes {
+
+struct Lcg {
+    uint32_t state;
+    explicit Lcg(uint32_t seed) : state(seed) {}
+
+    uint32_t next() {
+        state = state * 1664525u + 1013904223u;
+        return state;
+    }
+    // [0, 1)
+    float uniform() { return (next() >> 8) * (1.0f / 16777216.0f); }
+    float range(float lo, float hi) { return lo + (hi - lo) * uniform(); }
+};
+
+inline glm::vec3 randomDirection(Lcg& rng) {
+    // rejection sample the unit ball so the directions are uniform
+    while (true) {
+        glm::vec3 d(rng.range(-1.0f, 1.0f), rng.range(-1.0f, 1.0f), rng.range(-1.0f, 1.0f));
+        float len2 = glm::dot(d, d);
+        if (len2 > 1e-4f && len2 <= 1.0f) return d / std::sqrt(len2);
+    }
+}
+
+// count random spheres scattered through a box in front of the camera
+inline std::vector<Sphere> randomSpheres(int count, uint32_t seed = 1) {
+    Lcg rng(seed);
+    std::vector<Sphere> spheres;
+    spheres.reserve(count);
+    for (int i = 0; i < count; i++) {
+        Sphere s;
+        s.center = glm::vec3(rng.range(-10.0f, 10.0f), rng.range(-10.0f, 10.0f), rng.range(-30.0f, -5.0f));
+        s.radius = rng.range(0.2f, 1.0f);
+        s.color = glm::vec3(rng.uniform(), rng.uniform(), rng.uniform());
+        s.reflectivity = 0.0f;
+        spheres.push_back(s);
+    }
+    return spheres;
+}
+
+// UV sphere with 2 * rings * segments triangles
+inline void addTessellatedSphere(Scene& scene, glm::vec3 center, float radius, int rings, int segments) {
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    for (int r = 0; r <= rings; r++) {
+        float theta = 3.14159265f * r / rings;
+        for (int s = 0; s <= segments; s++) {
+            float phi = 2.0f * 3.14159265f * s / segments;
+            positions.push_back(center + radius * glm::vec3(std::sin(theta) * std::cos(phi),
+                                                            std::cos(theta),
+                                                            std::sin(theta) * std::sin(phi)));
+        }
+    }
+    for (int r = 0; r < rings; r++) {
+        for (int s = 0; s < segments; s++) {
+            unsigned int a = r * (segments + 1) + s;
+            unsigned int b = a + segments + 1;
+            indices.insert(indices.end(), {a, b, a + 1, a + 1, b, b + 1});
+        }
+    }
+    scene.addMesh(positions, indices, glm::vec3(0.8f), 0.0f);
+}
+
+// count point lights with 1/d^2 falloff scattered above the demo scene.
+// The total intensity is split between them so the image brightness stays
+// about the same whatever the count.
+inline std::vector<Light> randomLights(int count, float totalIntensity = 60.0f, uint32_t seed = 5) {
+    Lcg rng(seed);
+    std::vector<Light> lights(count);
+    for (Light& light : lights) {
+        light.position = glm::vec3(rng.range(-12.0f, 12.0f), rng.range(1.0f, 8.0f), rng.range(-20.0f, 2.0f));
+        light.color = glm::vec3(rng.range(0.6f, 1.0f), rng.range(0.6f, 1.0f), rng.range(0.6f, 1.0f));
+        light.intensity = totalIntensity / (float)count;
+    }
+    return lights;
+}
+
+// Spheres plus a few tessellated meshes, enough primitives for the BVH to matter
+inline Scene traversalScene(int sphereCount = 2000, uint32_t seed = 7) {
+    Scene scene;
+    scene.spheres = randomSpheres(sphereCount, seed);
+    addTessellatedSphere(scene, glm::vec3(-4.0f, 0.0f, -12.0f), 3.0f, 48, 96);
+    addTessellatedSphere(scene, glm::vec3(5.0f, 2.0f, -18.0f), 4.0f, 48, 96);
+    scene.lights = {{{5.0f, 5.0f, 0.0f}, {1.0f, 1.0f, 1.0f}}};
+    return scene;
+}
+
+// Same scene with every sphere a mirror, paths keep bouncing between them
+inline Scene mirrorScene(float reflectivity = 0.8f) {
+    Scene scene = traversalScene();
+    for (Sphere& sphere : scene.spheres) sphere.reflectivity = reflectivity;
+    return scene;
+}
+
+// One primary ray per pixel from the default camera, neighbours are close
+// together so they walk the same BVH nodes
+inline std::vector<Ray> coherentRays(int width, int height) {
+    Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+    GPUCamera cam = toGPU(camera, width, height);
+    std::vector<Ray> rays;
+    rays.reserve(width * height);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            rays.push_back(generateRay(x, y, glm::vec2(0.0f), cam, width, height));
+    return rays;
+}
+
+// Random origins inside the scene with random directions, like secondary
+// bounces after a diffuse hit
+inline std::vector<Ray> incoherentRays(int count, uint32_t seed = 3) {
+    Lcg rng(seed);
+    std::vector<Ray> rays(count);
+    for (Ray& ray : rays) {
+        ray.origin = glm::vec3(rng.range(-10.0f, 10.0f), rng.range(-10.0f, 10.0f), rng.range(-30.0f, -5.0f));
+        ray.direction = randomDirection(rng);
+    }
+    return rays;
+}
+
+} // namespace BenchScenes
+
+#endif
@@ -0,0 +1,645 @@
+#ifndef CPU_RENDERER_H
+#define CPU_RENDERER_H
+
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+#include "ImageIO.h"
+#include "Profiler.h"
+#include "Random.h"
+#include "Rasterizer.h"
+#include "RenderStats.h"
+#include "Scene.h"
+#include "Shared.h"
+#include "TextOverlay.h"
+#include "ThreadPool.h"
+#include "Wavefront.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// What ends up in the pixels. The heat modes colour each pixel by how much
+// work its rays did, summed over all samples and bounces.
+enum class RenderMode {
+    Shaded,
+    HeatNodes,   // BVH nodes visited
+    HeatPrims,   // primitive intersection tests
+    HeatTime     // wall clock nanoseconds in traceRay
+};
+
+inline const char* renderModeName(RenderMode mode) {
+    switch (mode) {
+        case RenderMode::HeatNodes: return "nodes";
+        case RenderMode::HeatPrims: return "prims";
+        case RenderMode::HeatTime:  return "time";
+        default:                    return "shaded";
+    }
+}
+
+inline bool parseRenderMode(const std::string& name, RenderMode& mode) {
+    if (name == "shaded")     mode = RenderMode::Shaded;
+    else if (name == "nodes") mode = RenderMode::HeatNodes;
+    else if (name == "prims") mode = RenderMode::HeatPrims;
+    else if (name == "time")  mode = RenderMode::HeatTime;
+    else return false;
+    return true;
+}
+
+// How tiles get handed to the workers
+enum class TileSchedule {
+    Dynamic,     // shared atomic counter, next free worker takes the next tile
+    Static,      // each worker gets one contiguous block of tiles up front
+    Interleaved  // worker i takes tiles i, i + N, i + 2N ...
+};
+
+inline const char* tileScheduleName(TileSchedule schedule) {
+    switch (schedule) {
+        case TileSchedule::Static:      return "static";
+        case TileSchedule::Interleaved: return "interleaved";
+        default:                        return "dynamic";
+    }
+}
+
+inline bool parseTileSchedule(const std::string& name, TileSchedule& schedule) {
+    if (name == "dynamic")          schedule = TileSchedule::Dynamic;
+    else if (name == "static")      schedule = TileSchedule::Static;
+    else if (name == "interleaved") schedule = TileSchedule::Interleaved;
+    else return false;
+    return true;
+}
+
+// Where the last frame's wall time went
+struct FrameTiming {
+    double totalMs = 0.0;     // whole render() call
+    double parallelMs = 0.0;  // pool->run(), from hand-off until the last worker returns
+    double rasterMs = 0.0;    // hybrid mode: visibility buffer, setup + tiles (also on the pool)
+    std::vector<double> workerBusyMs; // time each worker spent inside the job
+
+    double serialMs() const { return totalMs - parallelMs - rasterMs; }
+    // Share of the parallel section worker i sat waiting (woken late or out of tiles)
+    double idleFraction(size_t i) const {
+        return parallelMs > 0.0 ? std::max(0.0, 1.0 - workerBusyMs[i] / parallelMs) : 0.0;
+    }
+};
+
+// Pixel rectangle [x0, x1) x [y0, y1), y = 0 is the bottom row. Empty = whole frame.
+struct RenderRegion {
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    bool empty() const { return x1 <= x0 || y1 <= y0; }
+};
+
+// Tiles covering the region being rendered
+struct TileGrid {
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    int tileSize = 16, tilesX = 0, tilesY = 0;
+
+    TileGrid(const RenderRegion& region, int tileSize)
+        : x0(region.x0), y0(region.y0), x1(region.x1), y1(region.y1), tileSize(tileSize),
+          tilesX(std::max(0, (region.x1 - region.x0 + tileSize - 1) / tileSize)),
+          tilesY(std::max(0, (region.y1 - region.y0 + tileSize - 1) / tileSize)) {}
+
+    int count() const { return tilesX * tilesY; }
+    RenderRegion tile(int index) const
+    {
+        RenderRegion r;
+        r.x0 = x0 + (index % tilesX) * tileSize;
+        r.y0 = y0 + (index / tilesX) * tileSize;
+        r.x1 = std::min(r.x0 + tileSize, x1);
+        r.y1 = std::min(r.y0 + tileSize, y1);
+        return r;
+    }
+};
+
+struct CpuRenderSettings {
+    int threads = 0;        // 0 = one per hardware thread
+    int tileSize = 16;
+    TileSchedule schedule = TileSchedule::Dynamic;
+    int maxBounces = 4;
+    int rouletteDepth = 0;  // Russian roulette from this bounce on, 0 = off
+    uint64_t rayBudget = 0; // rays per frame before paths get shortened, 0 = no limit
+                            // (counted with RT_RAY_STAT, so it works with RT_ENABLE_STATS=0 too)
+    float frameTargetMs = 0.0f; // derive the ray budget from the last frame's rays/ms, 0 = off
+    int lightSamples = 4;   // lights sampled per hit through the light BVH, 0 = every light
+    bool occluderCache = true; // try each worker's last shadow occluder before the BVH
+    bool wavefront = false;    // stage-by-stage over tile batches instead of one path at a time (shaded mode only)
+    int wavefrontTiles = 4;    // tiles per wavefront batch
+    bool binSecondary = false; // wavefront: sort reflection rays by octant + origin Morton code
+    bool coarseSecondary = false; // reflection + shadow rays against the scene's coarse meshes (Scene::addMesh)
+    bool frustumCull = true;   // camera rays start at the BVH nodes inside their tile's frustum
+    bool hybrid = false;       // camera hits from a rasterised visibility buffer (shaded mode, grid sampler)
+    int samplesPerPixel = 4;
+    SamplerType sampler = SamplerType::Grid; // pixel jitter + light/roulette numbers
+    RenderMode mode = RenderMode::Shaded;
+    float heatScale = 0.0f; // cost mapped to the top of the ramp, 0 = frame maximum
+    RenderRegion region;    // only trace these pixels (split a frame over machines), empty = all
+};
+
+// Same as the kernel's generateRay: pixel (x, y), y = 0 is the bottom row
+inline Ray generateRay(int x, int y, glm::vec2 offset, const GPUCamera& cam, int width, int height)
+{
+    Ray genRay;
+    // Normalized pixel coordinates to [-1, 1]
+    float u = 2.0f * (float(x) + 0.5f + offset.x) / float(width) - 1.0f;
+    float v = 2.0f * (float(y) + 0.5f + offset.y) / float(height) - 1.0f;
+
+    // Calculate scale FOV
+    float scale = std::tan(cam.fov * 0.5f);
+
+    glm::vec3 dir_cam = glm::vec3(cam.front)
+                      + (u * cam.aspectRatio * scale) * glm::vec3(cam.right)
+                      + (v * scale) * glm::vec3(cam.up);
+
+    genRay.origin = glm::vec3(cam.position);
+    genRay.direction = glm::normalize(dir_cam);
+    return genRay;
+}
+
+// Every camera ray of the region lies inside this, jitter included: the
+// corners sit just past the outer pixel edges
+inline Frustum tileFrustum(const RenderRegion& r, const GPUCamera& cam, int width, int height)
+{
+    const float edge = 0.51f; // jitter reaches +-0.5, the rest is slack for rounding
+    const glm::vec3 corners[4] = {
+        generateRay(r.x0, r.y0, glm::vec2(-edge, -edge), cam, width, height).direction,
+        generateRay(r.x1 - 1, r.y0, glm::vec2(edge, -edge), cam, width, height).direction,
+        generateRay(r.x1 - 1, r.y1 - 1, glm::vec2(edge, edge), cam, width, height).direction,
+        generateRay(r.x0, r.y1 - 1, glm::vec2(-edge, edge), cam, width, height).direction
+    };
+    return Frustum::fromCorners(glm::vec3(cam.position), corners);
+}
+
+// Float colour to RGBA8, clamped the same way the RGBA8Unorm texture write does
+inline void packColor(glm::vec3 color, uint8_t* out)
+{
+    color = glm::clamp(color, 0.0f, 1.0f);
+    out[0] = (uint8_t)(color.r * 255.0f + 0.5f);
+    out[1] = (uint8_t)(color.g * 255.0f + 0.5f);
+    out[2] = (uint8_t)(color.b * 255.0f + 0.5f);
+    out[3] = 255;
+}
+
+// CPU port of the rayTrace kernel. Same camera, scene and shading, but the
+// scene goes through a BVH and the frame is split into tiles over a thread pool.
+class CpuRenderer {
+public:
+    void init(int w, int h, const CpuRenderSettings& renderSettings = CpuRenderSettings())
+    {
+        width = w;
+        height = h;
+        settings = renderSettings;
+        pool = std::make_unique<ThreadPool>(settings.threads);
+        workers.assign(pool->size(), WorkerSlot());
+        frameTiming.workerBusyMs.assign(pool->size(), 0.0);
+        pixels.assign(width * height * 4, 0);
+        costBuffer.assign(width * height, 0.0f);
+    }
+
+    void setScene(const Scene& newScene, const BVHBuildSettings& bvhSettings = BVHBuildSettings())
+    {
+        scene = newScene;
+        scene.buildBVH(bvhSettings);
+    }
+
+    void setMode(RenderMode mode) { settings.mode = mode; }
+    void setTileSize(int tileSize) { settings.tileSize = tileSize; }
+    void setSchedule(TileSchedule schedule) { settings.schedule = schedule; }
+    void setWavefront(bool enabled) { settings.wavefront = enabled; }
+    void setHybrid(bool enabled) { settings.hybrid = enabled; }
+    void setLightSamples(int lightSamples) { settings.lightSamples = lightSamples; }
+    void setSampler(SamplerType type, int samplesPerPixel)
+    {
+        settings.sampler = type;
+        settings.samplesPerPixel = std::max(1, samplesPerPixel);
+    }
+    // Keys the sample streams, the same frame index always gives the same
+    // image whatever the thread count, tile size or region split
+    void setFrameIndex(uint32_t frame) { frameIndex = frame; }
+    RenderMode getMode() const { return settings.mode; }
+    const CpuRenderSettings& getSettings() const { return settings; }
+
+    void render(const Camera& camera)
+    {
+        PROFILE_SCOPE("CpuRenderer::render");
+        using Clock = std::chrono::steady_clock;
+        const Clock::time_point frameStart = Clock::now();
+        GPUCamera cam = toGPU(camera, width, height);
+        for (WorkerSlot& slot : workers) slot.stats = RenderStats();
+
+        RenderRegion region = settings.region;
+        if (region.empty()) region = RenderRegion{0, 0, width, height};
+        region.x0 = std::max(region.x0, 0);
+        region.y0 = std::max(region.y0, 0);
+        region.x1 = std::min(region.x1, width);
+        region.y1 = std::min(region.y1, height);
+        const TileGrid grid(region, std::max(1, settings.tileSize));
+        const int tileCount = grid.count();
+        const int workerCount = pool->size();
+        // Work is handed out in units, one tile or one wavefront batch of tiles
+        const bool wavefront = settings.wavefront && settings.mode == RenderMode::Shaded;
+        const int unitTiles = wavefront ? std::max(1, settings.wavefrontTiles) : 1;
+        const int unitCount = (tileCount + unitTiles - 1) / unitTiles;
+        std::atomic<int> nextUnit{0};
+
+        // Hybrid: the camera hits of every sample get rasterised up front, the
+        // grid sampler is the only one with the same sub-pixel offsets in every pixel
+        const bool hybrid = settings.hybrid && settings.mode == RenderMode::Shaded &&
+                            settings.sampler == SamplerType::Grid;
+        frameTiming.rasterMs = 0.0;
+        if (hybrid) {
+            std::vector<glm::vec2> offsets(samplesPerPixel());
+            for (int sample = 0; sample < samplesPerPixel(); sample++)
+                offsets[sample] = gridOffset(sample, samplesPerPixel());
+            rasterizer.render(scene, cam, width, height, offsets, region.x0, region.y0, region.x1, region.y1,
+                              *pool, visibility);
+            frameTiming.rasterMs = rasterizer.setupMs + rasterizer.rasterMs;
+        }
+
+        // Ray budget: after each unit the rays it cost get added up, and the
+        // next unit's bounce limit shrinks when the rest of the frame at the
+        // current rate would go over. The ray counts stay on with
+        // RT_ENABLE_STATS=0 (RT_RAY_STAT) so this works in either build.
+        const uint64_t budget = frameRayBudget();
+        std::atomic<uint64_t> raysIssued{0};
+        std::atomic<int> unitsDone{0};
+        auto unitLimits = [&] {
+            PathLimits limits{settings.maxBounces, settings.maxBounces, settings.rouletteDepth};
+            const int done = unitsDone.load(std::memory_order_relaxed);
+            if (budget == 0 || done == 0) return limits;
+            const double issued = (double)raysIssued.load(std::memory_order_relaxed);
+            const double projected = issued / done * (unitCount - done);
+            const double left = (double)budget - issued;
+            if (projected > left) {
+                double share = std::max(0.0, left) / projected;
+                limits.bounceLimit = std::max(1, (int)(settings.maxBounces * share));
+            }
+            return limits;
+        };
+
+        const Clock::time_point parallelStart = Clock::now();
+        pool->run([&](int worker) {
+            const Clock::time_point busyStart = Clock::now();
+            RenderStats& stats = workers[worker].stats;
+            OccluderCache* occluders = settings.occluderCache ? &workers[worker].occluders : nullptr;
+            auto renderUnit = [&](int unit) {
+                PROFILE_SCOPE("tile", "worker");
+                const int firstTile = unit * unitTiles;
+                const int lastTile = std::min(firstTile + unitTiles, tileCount);
+                WavefrontQueues* queues = wavefront ? &workers[worker].queues : nullptr;
+                if (queues) {
+                    queues->radiance.clear();
+                    queues->tileEntries.clear();
+                    queues->primaryHits.clear();
+                }
+                const PathLimits limits = unitLimits();
+                const uint64_t raysBefore = stats.totalRays();
+
+                for (int tile = firstTile; tile < lastTile; tile++) {
+                    const RenderRegion r = grid.tile(tile);
+                    BVHEntrySet entrySet;
+                    const BVHEntrySet* entry = nullptr;
+                    if (settings.frustumCull && !hybrid) {
+                        scene.frustumEntry(tileFrustum(r, cam, width, height), entrySet);
+                        entry = &entrySet;
+                        if (queues) queues->tileEntries.push_back({(uint32_t)queues->paths.size(), entrySet});
+                    }
+                    for (int y = r.y0; y < r.y1; y++)
+                        for (int x = r.x0; x < r.x1; x++) {
+                            if (queues) queuePixel(x, y, cam, hybrid, *queues, stats);
+                            else renderPixel(x, y, cam, limits, hybrid, stats, occluders, entry);
+                        }
+                }
+                if (queues) {
+                    traceWavefront(scene, *queues, glm::vec3(cam.position), limits,
+                                   settings.lightSamples, stats, occluders, settings.binSecondary,
+                                   settings.coarseSecondary);
+                    resolveBatch(firstTile, lastTile, grid, *queues);
+                }
+                raysIssued.fetch_add(stats.totalRays() - raysBefore, std::memory_order_relaxed);
+                unitsDone.fetch_add(1, std::memory_order_relaxed);
+            };
+
+            switch (settings.schedule) {
+                case TileSchedule::Static: {
+                    int first = (int)((int64_t)unitCount * worker / workerCount);
+                    int last = (int)((int64_t)unitCount * (worker + 1) / workerCount);
+                    for (int unit = first; unit < last; unit++) renderUnit(unit);
+                    break;
+                }
+                case TileSchedule::Interleaved:
+                    for (int unit = worker; unit < unitCount; unit += workerCount) renderUnit(unit);
+                    break;
+                default:
+                    for (int unit = nextUnit.fetch_add(1); unit < unitCount; unit = nextUnit.fetch_add(1))
+                        renderUnit(unit);
+                    break;
+            }
+            workers[worker].busyMs =
+                std::chrono::duration<double, std::milli>(Clock::now() - busyStart).count();
+        });
+        frameTiming.parallelMs =
+            std::chrono::duration<double, std::milli>(Clock::now() - parallelStart).count();
+
+        // Per worker counters get summed once here
+        frameStats = RenderStats();
+        for (const WorkerSlot& slot : workers) frameStats += slot.stats;
+        frameStats.pixels = (uint64_t)width * height;
+        if (frameTiming.parallelMs > 0.0)
+            raysPerMs = (double)frameStats.totalRays() / frameTiming.parallelMs;
+
+        if (settings.mode != RenderMode::Shaded) {
+            PROFILE_SCOPE("heatmap");
+            colorizeCost();
+        }
+        if (!overlayText.empty())
+            TextOverlay::drawText(pixels.data(), width, height, 8, 8, overlayText);
+
+        for (int i = 0; i < workerCount; i++) frameTiming.workerBusyMs[i] = workers[i].busyMs;
+        frameTiming.totalMs = std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count();
+    }
+
+    // RGBA8, first row is the bottom of the screen (same as the Metal readback)
+    const std::vector<uint8_t>& getPixels() const { return pixels; }
+    // Raw per pixel cost of the last frame in the current heat mode
+    const std::vector<float>& getCostBuffer() const { return costBuffer; }
+    const RenderStats& getFrameStats() const { return frameStats; }
+    const FrameTiming& getFrameTiming() const { return frameTiming; }
+    float getHeatMax() const { return heatMax; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getThreadCount() const { return pool ? pool->size() : 0; }
+
+    void setOverlayText(const std::string& text) { overlayText = text; }
+
+    // Raw cost buffer as a single channel PFM (float32, bottom row first)
+    bool dumpCostBuffer(const std::string& path) const
+    {
+        return ImageIO::writePFM(path, costBuffer.data(), width, height);
+    }
+
+private:
+    struct alignas(64) WorkerSlot { // own cache line per worker, no false sharing
+        RenderStats stats;
+        double busyMs = 0.0;
+        OccluderCache occluders; // kept across frames, it's only a hint
+        WavefrontQueues queues;
+    };
+
+    int width = 0, height = 0;
+    CpuRenderSettings settings;
+    Scene scene;
+    std::unique_ptr<ThreadPool> pool;
+    std::vector<WorkerSlot> workers;
+    Rasterizer rasterizer;
+    VisibilityBuffer visibility;
+    std::vector<uint8_t> pixels;
+    std::vector<float> costBuffer;
+    RenderStats frameStats;
+    FrameTiming frameTiming;
+    double raysPerMs = 0.0; // last frame's rate, for frameTargetMs
+    uint32_t frameIndex = 0;
+    float heatMax = 0.0f;
+    std::string overlayText;
+
+    int samplesPerPixel() const { return std::max(1, settings.samplesPerPixel); }
+
+    // Regular k x k grid inside the pixel, at 4 samples that's the old {+-0.25, +-0.25}
+    static glm::vec2 gridOffset(int sample, int samples)
+    {
+        const int k = (int)std::ceil(std::sqrt((float)samples));
+        return glm::vec2(((sample % k) + 0.5f) / k - 0.5f, ((sample / k) + 0.5f) / k - 0.5f);
+    }
+
+    // The sampler's first two dimensions jitter the camera ray, except for Grid
+    Ray cameraRay(int x, int y, int sample, const GPUCamera& cam, SampleRng& rng) const
+    {
+        glm::vec2 offset = gridOffset(sample, samplesPerPixel());
+        if (settings.sampler != SamplerType::Grid) {
+            offset.x = rng.next() - 0.5f;
+            offset.y = rng.next() - 0.5f;
+        }
+        return generateRay(x, y, offset, cam, width, height);
+    }
+
+    SampleRng makeRng(int x, int y, int sample) const
+    {
+        return SampleRng((uint32_t)x, (uint32_t)y, (uint32_t)width, (uint32_t)sample, settings.sampler, frameIndex);
+    }
+
+    // Hybrid: the sample's camera hit out of the visibility buffer. The odd
+    // silhouette sample the buffer can't vouch for gets traced after all.
+    Hit cameraHit(int x, int y, int sample, const Ray& ray, RenderStats& stats) const
+    {
+        Hit hit;
+        if (visibilityHit(scene, visibility, visibility.index(sample, x, y), ray, 0.001f, 9999.9f, hit)) {
+            RT_STAT(stats, visibilityHits, 1);
+            return hit;
+        }
+        RT_RAY_STAT(stats, primaryRays, 1);
+        hit = Hit();
+        scene.intersect(ray, 0.001f, 9999.9f, hit, stats);
+        return hit;
+    }
+
+    // Wavefront: the pixel's camera rays go into the queue, paths are numbered
+    // in pixel order so resolveBatch can find them again
+    void queuePixel(int x, int y, const GPUCamera& cam, bool hybrid, WavefrontQueues& q, RenderStats& stats)
+    {
+        for (int sample = 0; sample < samplesPerPixel(); sample++) {
+            SampleRng rng = makeRng(x, y, sample);
+            Ray ray = cameraRay(x, y, sample, cam, rng);
+            PathState path{ray, glm::vec3(1.0f), rng, (uint32_t)q.radiance.size()};
+            if (hybrid) q.primaryHits.push_back(cameraHit(x, y, sample, ray, stats));
+            else RT_RAY_STAT(stats, primaryRays, 1);
+            RT_STAT(stats, samples, 1);
+            q.paths.push_back(path);
+            q.radiance.push_back(glm::vec3(0.0f));
+        }
+    }
+
+    // Averages each pixel's samples out of the finished batch, same pixel walk as the queueing
+    void resolveBatch(int firstTile, int lastTile, const TileGrid& grid, const WavefrontQueues& q)
+    {
+        size_t id = 0;
+        for (int tile = firstTile; tile < lastTile; tile++) {
+            const RenderRegion r = grid.tile(tile);
+            for (int y = r.y0; y < r.y1; y++)
+                for (int x = r.x0; x < r.x1; x++) {
+                    glm::vec3 finalColor(0.0f);
+                    for (int sample = 0; sample < samplesPerPixel(); sample++) finalColor += q.radiance[id++];
+                    finalColor /= float(samplesPerPixel());
+                    packColor(finalColor, &pixels[4 * (y * width + x)]);
+                }
+        }
+    }
+
+    // Rays this frame may spend, the smaller of the fixed budget and what the
+    // frame target allows at the last frame's rate. 0 = unlimited.
+    uint64_t frameRayBudget() const
+    {
+        uint64_t budget = settings.rayBudget;
+        if (settings.frameTargetMs > 0.0f && raysPerMs > 0.0) {
+            uint64_t target = (uint64_t)(raysPerMs * settings.frameTargetMs);
+            budget = budget ? std::min(budget, target) : target;
+        }
+        return budget;
+    }
+
+    void renderPixel(int x, int y, const GPUCamera& cam, const PathLimits& limits, bool hybrid, RenderStats& stats,
+                     OccluderCache* occluders, const BVHEntrySet* entry)
+    {
+        const uint64_t nodesBefore = stats.nodesVisited;
+        const uint64_t primsBefore = stats.primitiveTests;
+        std::chrono::steady_clock::time_point start;
+        if (settings.mode == RenderMode::HeatTime) start = std::chrono::steady_clock::now();
+
+        glm::vec3 finalColor(0.0f);
+        for (int sample = 0; sample < samplesPerPixel(); sample++) { // basic Anti-Alisasing
+            SampleRng rng = makeRng(x, y, sample);
+            Ray ray = cameraRay(x, y, sample, cam, rng);
+            RT_STAT(stats, samples, 1);
+            if (hybrid) {
+                const Hit first = cameraHit(x, y, sample, ray, stats);
+                finalColor += traceRay(ray, glm::vec3(cam.position), limits, rng, stats, occluders, nullptr, &first);
+                continue;
+            }
+            RT_RAY_STAT(stats, primaryRays, 1);
+            finalColor += traceRay(ray, glm::vec3(cam.position), limits, rng, stats, occluders, entry);
+        }
+        finalColor /= float(samplesPerPixel());
+
+        const int index = y * width + x;
+        switch (settings.mode) {
+            case RenderMode::HeatNodes: costBuffer[index] = (float)(stats.nodesVisited - nodesBefore); break;
+            case RenderMode::HeatPrims: costBuffer[index] = (float)(stats.primitiveTests - primsBefore); break;
+            case RenderMode::HeatTime:
+                costBuffer[index] = (float)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+                break;
+            default: break;
+        }
+
+        packColor(finalColor, &pixels[4 * index]);
+    }
+
+    // entry only applies to the camera ray, reflections start at the root.
+    // firstHit is the camera ray's hit when it's already known (hybrid mode).
+    glm::vec3 traceRay(const Ray& primaryRay, const glm::vec3& camPos, const PathLimits& limits, SampleRng& rng,
+                       RenderStats& stats, OccluderCache* occluders, const BVHEntrySet* entry = nullptr,
+                       const Hit* firstHit = nullptr) const
+    {
+        glm::vec3 finalColor(0.0f);
+        glm::vec3 throughPut(1.0f);
+        Ray currentRay = primaryRay;
+        const TraceDetail secondaryDetail = settings.coarseSecondary ? TraceDetail::Coarse : TraceDetail::Full;
+
+        for (int bounce = 0; bounce < limits.maxBounces; bounce++) {
+            if (bounce > 0) RT_RAY_STAT(stats, reflectionRays, 1);
+            rng.setBounce((uint32_t)bounce);
+            Hit hit;
+            const float tMin = 0.001f; // Removes too close
+            const float tMax = 9999.9f;
+
+            const bool found = bounce == 0 && firstHit
+                                   ? (hit = *firstHit).hit
+                                   : scene.intersect(currentRay, tMin, tMax, hit, stats, bounce == 0 ? entry : nullptr,
+                                                     bounce > 0 ? secondaryDetail : TraceDetail::Full);
+            if (found) {
+                glm::vec3 viewDir = glm::normalize(camPos - hit.point);
+                glm::vec3 directLight = scene.directLight(hit, viewDir, settings.lightSamples, rng, stats, occluders,
+                                                          secondaryDetail);
+                finalColor += throughPut * directLight;
+
+                if (hit.reflectivity < 0.001f) break;
+
+                throughPut *= hit.color * hit.reflectivity;
+
+                if (glm::length(throughPut) < 0.001f) {
+                    RT_STAT(stats, throughputCutoffs, 1);
+                    break;
+                }
+                if (!continuePath(throughPut, bounce, limits, rng, stats)) break;
+
+                // Create Reflected Ray
+                currentRay.origin = hit.point;
+                currentRay.direction = glm::reflect(currentRay.direction, hit.normal);
+            } else {
+                // Hit Sky and Stops
+                float a = 0.5f * (glm::normalize(currentRay.direction).y + 1.0f);
+                glm::vec3 skyColor = (1.0f - a) * glm::vec3(1.0f) + a * glm::vec3(0.5f, 0.7f, 1.0f);
+                finalColor += skyColor * throughPut;
+                break; // stops bouncing
+            }
+        }
+        return finalColor;
+    }
+
+    // cold -> hot: dark blue, blue, cyan, green, yellow, red
+    static glm::vec3 heatColor(float x)
+    {
+        static const glm::vec3 stops[6] = {
+            {0.0f, 0.0f, 0.2f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f, 1.0f},
+            {0.0f, 1.0f, 0.0f}, {1.0f, 1.0f, 0.0f}, {1.0f, 0.0f, 0.0f}
+        };
+        x = glm::clamp(x, 0.0f, 1.0f) * 5.0f;
+        int i = std::min((int)x, 4);
+        return glm::mix(stops[i], stops[i + 1], x - (float)i);
+    }
+
+    void colorizeCost()
+    {
+        heatMax = settings.heatScale;
+        if (heatMax <= 0.0f) {
+            heatMax = 0.0f;
+            for (float c : costBuffer) heatMax = std::max(heatMax, c);
+        }
+        const float inv = heatMax > 0.0f ? 1.0f / heatMax : 0.0f;
+        for (int i = 0; i < width * height; i++) {
+            glm::vec3 c = heatColor(costBuffer[i] * inv);
+            uint8_t* p = &pixels[4 * i];
+            p[0] = (uint8_t)(c.r * 255.0f);
+            p[1] = (uint8_t)(c.g * 255.0f);
+            p[2] = (uint8_t)(c.b * 255.0f);
+            p[3] = 255;
+        }
+        drawLegend();
+    }
+
+    // Ramp along the bottom with the scale written under it
+    void drawLegend()
+    {
+        const int barX = 8, barW = std::min(256, width - 16), barH = 12;
+        const int barTop = height - 40; // measured from the top of the image
+        if (barW <= 0 || barTop < 0) return;
+        for (int py = 0; py < barH; py++) {
+            int row = height - 1 - (barTop + py);
+            for (int px = 0; px < barW; px++) {
+                glm::vec3 c = heatColor((float)px / (float)(barW - 1));
+                uint8_t* p = &pixels[4 * (row * width + barX + px)];
+                p[0] = (uint8_t)(c.r * 255.0f);
+                p[1] = (uint8_t)(c.g * 255.0f);
+                p[2] = (uint8_t)(c.b * 255.0f);
+                p[3] = 255;
+            }
+        }
+        std::ostringstream label;
+        label << "0";
+        std::ostringstream maxLabel;
+        maxLabel << (uint64_t)heatMax << (settings.mode == RenderMode::HeatTime ? " NS" : "");
+        TextOverlay::drawText(pixels.data(), width, height, barX, barTop + barH + 4, label.str(),
+                              2, true, 255, 255, 255);
+        int maxX = barX + barW - (int)maxLabel.str().size() * 8;
+        TextOverlay::drawText(pixels.data(), width, height, maxX, barTop + barH + 4, maxLabel.str(),
+                              2, true, 255, 255, 255);
+        TextOverlay::drawText(pixels.data(), width, height, barX, barTop - 14,
+                              std::string(renderModeName(settings.mode)) + " PER PIXEL",
+                              2, true, 255, 255, 255);
+    }
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef DRAW_LIST_H
+#define DRAW_LIST_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Mesh.h"
+#include "Shader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Meshes to draw, sorted by material so a run of meshes with the same
+// textures only binds them once. Built at load (or whenever the set of
+// meshes changes); submit() itself doesn't allocate. Holds pointers, so the
+// meshes can't move while the list is in use.
+class DrawList {
+public:
+    static constexpr uint8_t CULLED = 0xFF;
+
+    struct Item {
+        Mesh* mesh;
+        const glm::mat4* model; // nullptr leaves the model uniform alone
+    };
+
+    void clear() { items.clear(); }
+    void reserve(size_t count) { items.reserve(count); }
+    void add(Mesh& mesh, const glm::mat4* model = nullptr) { items.push_back({&mesh, model}); }
+    size_t size() const { return items.size(); }
+
+    // by material, then by VAO within a material
+    void sort()
+    {
+        std::stable_sort(items.begin(), items.end(), [](const Item& a, const Item& b) {
+            if (a.mesh->materialKey != b.mesh->materialKey) return a.mesh->materialKey < b.mesh->materialKey;
+            return a.mesh->VAO < b.mesh->VAO;
+        });
+    }
+
+    const std::vector<Item>& getItems() const { return items; }
+
+    // lods (optional) has one entry per item in list order, what
+    // FrustumCuller::cull fills in: the level to draw, or CULLED to skip it
+    void submit(const Shader& shader, const uint8_t* lods = nullptr)
+    {
+        if (shader.ID != modelProgram) {
+            modelLocation = shader.location("model");
+            modelProgram = shader.ID;
+        }
+        const Mesh* previous = nullptr;
+        materialSwitches = 0;
+        for (size_t i = 0; i < items.size(); i++) {
+            const Item& item = items[i];
+            if (lods && lods[i] == CULLED) continue;
+            if (!previous || !item.mesh->sameMaterial(*previous)) {
+                item.mesh->bindMaterial(shader);
+                materialSwitches++;
+            }
+            if (item.model && modelLocation >= 0)
+                glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(*item.model));
+            item.mesh->drawGeometry(lods ? lods[i] : 0);
+            previous = item.mesh;
+        }
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // texture binds in the last submit, one per run of equal materials
+    unsigned int getMaterialSwitches() const { return materialSwitches; }
+
+private:
+    std::vector<Item> items;
+    unsigned int modelProgram = 0;
+    int modelLocation = -1;
+    unsigned int materialSwitches = 0;
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Camera.h"
+#include "Shader.h"
+
+// Per-frame values every raster shader reads, one std140 uniform block
+// written once a frame instead of a setMat4 per shader per draw. Shaders
+// declare
+//
+//   layout(std140) uniform FrameData {
+//       mat4 view;
+//       mat4 projection;
+//       vec4 viewPos;   // w unused
+//       vec4 time;      // x = seconds
+//   };
+//
+// and get pointed at BINDING with attach(shader) (GLSL 3.30 can't say
+// binding = 0 itself).
+struct GPUFrameData {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 viewPos;
+    glm::vec4 time;
+};
+static_assert(sizeof(GPUFrameData) == 160, "GPUFrameData has to match the std140 FrameData block");
+
+class FrameUniforms {
+public:
+    static constexpr unsigned int BINDING = 0;
+
+    void init()
+    {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(GPUFrameData), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, buffer);
+    }
+
+    // false if the shader doesn't read FrameData
+    bool attach(const Shader& shader) const { return shader.bindUniformBlock("FrameData", BINDING); }
+
+    // once per frame, before the draws
+    void update(const Camera& camera, float aspect, float seconds, float nearPlane = 0.1f, float farPlane = 100.0f)
+    {
+        GPUFrameData data;
+        data.view = camera.GetViewMatrix();
+        data.projection = glm::perspective(glm::radians(camera.Fov), aspect, nearPlane, farPlane);
+        data.viewPos = glm::vec4(camera.Position, 0.0f);
+        data.time = glm::vec4(seconds, 0.0f, 0.0f, 0.0f);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(data), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, buffer);
+    }
+
+    void cleanup()
+    {
+        if (buffer) glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+
+private:
+    GLuint buffer = 0;
+};
+
+#endif
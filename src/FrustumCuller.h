@@ -0,0 +1,183 @@
+#ifndef FRUSTUM_CULLER_H
+#define FRUSTUM_CULLER_H
+
+#include <glm/glm.hpp>
+
+#include "DrawList.h"
+#include "Profiler.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+struct CullStats {
+    size_t objects = 0;
+    size_t visible = 0;
+    size_t triangles = 0;     // drawn, at the picked LODs
+    size_t fullTriangles = 0; // the visible objects at LOD 0
+    double ms = 0.0;
+};
+
+// Culls a DrawList against the view frustum and picks each survivor's LOD,
+// once a frame on the CPU. build() takes the world space boxes (mesh bounds
+// through the model matrix) into SoA arrays; cull() tests four boxes per
+// step against the six planes with Simd.h lanes, spread over a ThreadPool in
+// chunks. The result is one byte per item, the LOD to draw or
+// DrawList::CULLED, which DrawList::submit takes as is.
+//
+// LOD: the coarsest level whose error, projected at the box's nearest
+// distance, stays under lodPixelError pixels.
+class FrustumCuller {
+public:
+    float lodPixelError = 1.0f;
+
+    // Again whenever items or their model matrices change
+    void build(const DrawList& list)
+    {
+        const std::vector<DrawList::Item>& items = list.getItems();
+        count = items.size();
+        const size_t padded = (count + 3) & ~(size_t)3;
+        for (std::vector<float>* lane : {&cx, &cy, &cz, &ex, &ey, &ez})
+            lane->assign(padded, 0.0f);
+        radius.assign(count, 0.0f);
+        scale.assign(count, 1.0f);
+        lodFirst.assign(count, 0);
+        lodErrors.clear();
+        lodTriangles.clear();
+        lods.assign(count, DrawList::CULLED);
+
+        for (size_t i = 0; i < count; i++) {
+            const Mesh& mesh = *items[i].mesh;
+            const glm::mat4 model = items[i].model ? *items[i].model : glm::mat4(1.0f);
+            const glm::vec3 center = glm::vec3(model * glm::vec4(0.5f * (mesh.boundsMin + mesh.boundsMax), 1.0f));
+            const glm::vec3 half = 0.5f * (mesh.boundsMax - mesh.boundsMin);
+            // box around the transformed box
+            const glm::mat3 m(model);
+            const glm::vec3 extent = glm::abs(m[0]) * half.x + glm::abs(m[1]) * half.y + glm::abs(m[2]) * half.z;
+            cx[i] = center.x;
+            cy[i] = center.y;
+            cz[i] = center.z;
+            ex[i] = extent.x;
+            ey[i] = extent.y;
+            ez[i] = extent.z;
+            radius[i] = glm::length(extent);
+            scale[i] = std::max(glm::length(m[0]), std::max(glm::length(m[1]), glm::length(m[2])));
+
+            lodFirst[i] = (uint32_t)lodErrors.size();
+            const size_t levels = std::min<size_t>(mesh.lods.size(), MAX_LODS);
+            for (size_t l = 0; l < levels; l++) {
+                lodErrors.push_back(mesh.lods[l].error);
+                lodTriangles.push_back(mesh.lods[l].count / 3);
+            }
+        }
+        lodFirst.push_back((uint32_t)lodErrors.size());
+    }
+
+    // Pass the same projection FrameUniforms uses. pool == nullptr culls on
+    // the calling thread.
+    void cull(const glm::mat4& view, const glm::mat4& projection, float fovY, int viewportHeight,
+              ThreadPool* pool = nullptr)
+    {
+        PROFILE_SCOPE("FrustumCuller::cull", "raster");
+        auto start = std::chrono::steady_clock::now();
+
+        // Gribb / Hartmann: planes straight out of the rows of projection * view
+        const glm::mat4 m = projection * view;
+        const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+        const glm::vec4 planes[6] = {row3 + row0, row3 - row0, row3 + row1, row3 - row1, row3 + row2, row3 - row2};
+
+        const glm::mat4 inverseView = glm::inverse(view);
+        const glm::vec3 eye(inverseView[3]);
+        // pixels per world unit at distance 1
+        const float pixelsAtOne = (float)viewportHeight / (2.0f * std::tan(0.5f * fovY));
+
+        const size_t blocks = (count + 3) / 4;
+        std::atomic<size_t> nextChunk{0};
+        std::atomic<size_t> visible{0}, triangles{0}, fullTriangles{0};
+        auto job = [&](int) {
+            size_t myVisible = 0, myTriangles = 0, myFull = 0;
+            while (true) {
+                const size_t firstBlock = nextChunk.fetch_add(CHUNK_BLOCKS);
+                if (firstBlock >= blocks) break;
+                const size_t lastBlock = std::min(blocks, firstBlock + CHUNK_BLOCKS);
+                for (size_t block = firstBlock; block < lastBlock; block++) {
+                    const size_t base = block * 4;
+                    const f32x4 x = simd::load(&cx[base]), y = simd::load(&cy[base]), z = simd::load(&cz[base]);
+                    const f32x4 hx = simd::load(&ex[base]), hy = simd::load(&ey[base]), hz = simd::load(&ez[base]);
+                    i32x4 inside = {-1, -1, -1, -1};
+                    for (const glm::vec4& plane : planes) {
+                        const f32x4 d = x * plane.x + y * plane.y + z * plane.z + plane.w;
+                        const f32x4 r = hx * std::fabs(plane.x) + hy * std::fabs(plane.y) + hz * std::fabs(plane.z);
+                        inside &= d >= -r;
+                    }
+                    for (int lane = 0; lane < 4 && base + lane < count; lane++) {
+                        const size_t i = base + lane;
+                        if (!inside[lane]) {
+                            lods[i] = DrawList::CULLED;
+                            continue;
+                        }
+                        const uint8_t lod = pickLod(i, eye, pixelsAtOne);
+                        lods[i] = lod;
+                        myVisible++;
+                        myTriangles += lodTriangles[lodFirst[i] + lod];
+                        myFull += lodTriangles[lodFirst[i]];
+                    }
+                }
+            }
+            visible += myVisible;
+            triangles += myTriangles;
+            fullTriangles += myFull;
+        };
+        if (pool && blocks > CHUNK_BLOCKS) pool->run(std::ref(job)); // no std::function allocation
+        else job(0);
+
+        stats.objects = count;
+        stats.visible = visible;
+        stats.triangles = triangles;
+        stats.fullTriangles = fullTriangles;
+        stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // one per DrawList item, for DrawList::submit
+    const uint8_t* getLods() const { return lods.data(); }
+    const CullStats& getStats() const { return stats; }
+
+private:
+    static constexpr size_t MAX_LODS = 8;
+    static constexpr size_t CHUNK_BLOCKS = 256; // 1024 boxes a grab
+
+    size_t count = 0;
+    std::vector<float> cx, cy, cz, ex, ey, ez; // box centres and half extents, padded to 4
+    std::vector<float> radius, scale;          // for the LOD distance / error scale
+    std::vector<uint32_t> lodFirst;            // item -> its levels in lodErrors, count + 1 entries
+    std::vector<float> lodErrors;
+    std::vector<uint32_t> lodTriangles;
+    std::vector<uint8_t> lods;
+    CullStats stats;
+
+    uint8_t pickLod(size_t i, const glm::vec3& eye, float pixelsAtOne) const
+    {
+        const uint32_t first = lodFirst[i], levels = lodFirst[i + 1] - first;
+        if (levels <= 1) return 0;
+        const float distance = glm::length(glm::vec3(cx[i], cy[i], cz[i]) - eye) - radius[i];
+        if (distance <= 0.0f) return 0; // camera inside the box
+        const float pixelsPerUnit = scale[i] * pixelsAtOne / distance;
+        uint8_t lod = 0;
+        for (uint32_t l = 1; l < levels; l++) {
+            if (lodErrors[first + l] * pixelsPerUnit > lodPixelError) break;
+            lod = (uint8_t)l;
+        }
+        return lod;
+    }
+};
+
+#endif
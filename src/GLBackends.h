@@ -0,0 +1,176 @@
+#ifndef GL_BACKENDS_H
+#define GL_BACKENDS_H
+
+#include <glad/glad.h>
+
+#include "GLComputeRenderer.h"
+#include "RenderBackend.h"
+#ifdef __APPLE__
+#include "MetalRenderer.h"
+#endif
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// The backends that hand main.cpp a GL texture. Need a current context
+// (4.3 for the compute one, see GLCompute::load).
+
+// Copies a texture back, for the compare mode / screenshots only
+inline void readTexturePixels(unsigned int texture, int width, int height, std::vector<uint8_t>& rgba)
+{
+    rgba.resize((size_t)width * height * 4);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// ============ CPU + texture upload ============
+class CpuTextureBackend : public CpuBackend {
+public:
+    using CpuBackend::CpuBackend;
+
+    bool init(int w, int h) override
+    {
+        CpuBackend::init(w, h);
+        width = w;
+        height = h;
+        // CPU frames get uploaded into this one
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return true;
+    }
+
+    void render(const Camera& camera) override
+    {
+        {
+            PROFILE_SCOPE("cpuRenderer.render");
+            CpuBackend::render(camera);
+        }
+        PROFILE_SCOPE("glTexSubImage2D");
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+                        renderer.getPixels().data());
+    }
+
+    unsigned int getOpenGLTextureID() override { return texture; }
+    void cleanup() override
+    {
+        if (texture) glDeleteTextures(1, &texture);
+        texture = 0;
+    }
+
+private:
+    int width = 0, height = 0;
+    GLuint texture = 0;
+};
+
+// ============ GL compute ============
+class GLComputeBackend : public RenderBackend {
+public:
+    BackendType type() const override { return BackendType::GLCompute; }
+
+    bool init(int w, int h) override
+    {
+        width = w;
+        height = h;
+        return renderer.init(w, h);
+    }
+    void render(const Camera& camera) override { renderer.render(camera); }
+    unsigned int getOpenGLTextureID() override { return renderer.getOpenGLTextureID(); }
+    void cleanup() override { renderer.cleanup(); }
+
+    const RenderStats& getFrameStats() const override { return renderer.getFrameStats(); }
+    void setLights(const std::vector<Light>& lights, int lightSamples = 4) override
+    {
+        renderer.setLights(lights, lightSamples);
+    }
+    void setScene(const Scene& scene) override { renderer.setScene(scene); }
+    void setSampler(SamplerType type, int samplesPerPixel = 4) override
+    {
+        renderer.setSampler(type, samplesPerPixel);
+    }
+    void setFrameIndex(uint32_t frame) override { renderer.setFrameIndex(frame); }
+
+    void finish() override { glFinish(); }
+    void readPixels(std::vector<uint8_t>& rgba) override
+    {
+        readTexturePixels(renderer.getOpenGLTextureID(), width, height, rgba);
+    }
+
+    GLComputeRenderer& getRenderer() { return renderer; }
+
+private:
+    int width = 0, height = 0;
+    GLComputeRenderer renderer;
+};
+
+#ifdef __APPLE__
+// ============ Metal ============
+class MetalBackend : public RenderBackend {
+public:
+    BackendType type() const override { return BackendType::Metal; }
+
+    bool init(int w, int h) override
+    {
+        width = w;
+        height = h;
+        renderer.init(w, h);
+        return renderer.getOpenGLTextureID() != 0;
+    }
+    // render() already waits for the command buffer and uploads
+    void render(const Camera& camera) override { renderer.render(camera); }
+    unsigned int getOpenGLTextureID() override { return renderer.getOpenGLTextureID(); }
+    void cleanup() override { renderer.cleanup(); }
+
+    const RenderStats& getFrameStats() const override { return renderer.getFrameStats(); }
+    void setOverlayText(const std::string& text) override { renderer.setOverlayText(text); }
+    void setLights(const std::vector<Light>& lights, int lightSamples = 4) override
+    {
+        renderer.setLights(lights, lightSamples);
+    }
+    void setScene(const Scene& scene) override { renderer.setScene(scene); }
+    void setSampler(SamplerType type, int samplesPerPixel = 4) override
+    {
+        renderer.setSampler(type, samplesPerPixel);
+    }
+    void setFrameIndex(uint32_t frame) override { renderer.setFrameIndex(frame); }
+
+    void readPixels(std::vector<uint8_t>& rgba) override
+    {
+        readTexturePixels(renderer.getOpenGLTextureID(), width, height, rgba);
+    }
+
+private:
+    int width = 0, height = 0;
+    MetalRenderer renderer;
+};
+#endif
+
+// nullptr if the backend isn't built into this binary (Metal off macOS)
+inline std::unique_ptr<RenderBackend> createBackend(BackendType type,
+                                                    const CpuRenderSettings& cpuSettings = CpuRenderSettings())
+{
+    switch (type) {
+        case BackendType::GLCompute: return std::make_unique<GLComputeBackend>();
+        case BackendType::Cpu:       return std::make_unique<CpuTextureBackend>(false, cpuSettings);
+        case BackendType::CpuScalar: return std::make_unique<CpuTextureBackend>(true, cpuSettings);
+        case BackendType::Metal:
+#ifdef __APPLE__
+            return std::make_unique<MetalBackend>();
+#else
+            std::cout << "ERROR::BACKEND::METAL_NOT_BUILT (macOS only)" << std::endl;
+            return nullptr;
+#endif
+    }
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,418 @@
+#ifndef GL_COMPUTE_RENDERER_H
+#define GL_COMPUTE_RENDERER_H
+
+#include <glad/glad.h>
+
+#include "Camera.h"
+#include "GPUScene.h"
+#include "Profiler.h"
+#include "Random.h"
+#include "RenderStats.h"
+#include "Scene.h"
+#include "Shared.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Same kernel as MetalRenderer (shaders/rayTracer.comp is a port of
+// rayTracer.metal) as an OpenGL 4.3 compute shader, for machines without
+// Metal. The shader writes straight into the texture ray.frag samples, so
+// there's no readback and no upload; only the counters come back. The scene
+// (spheres, materials, BVH nodes) sits in SSBOs 7-9, uploaded by setScene()
+// once and after that only the dirty ranges GPUScene hands back.
+//
+// glad here is a 3.3 loader, the handful of 4.2/4.3 entry points compute
+// needs get loaded by hand with the same proc address function. macOS stops
+// at GL 4.1, so there this backend can't start and init() says so.
+
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_SHADER_IMAGE_ACCESS_BARRIER_BIT
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#endif
+#ifndef GL_TEXTURE_FETCH_BARRIER_BIT
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#endif
+#ifndef GL_BUFFER_UPDATE_BARRIER_BIT
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#endif
+#ifndef GL_TEXTURE_UPDATE_BARRIER_BIT
+#define GL_TEXTURE_UPDATE_BARRIER_BIT 0x00000100
+#endif
+
+namespace GLCompute {
+
+typedef void (APIENTRYP PFNDISPATCHCOMPUTE)(GLuint x, GLuint y, GLuint z);
+typedef void (APIENTRYP PFNBINDIMAGETEXTURE)(GLuint unit, GLuint texture, GLint level, GLboolean layered,
+                                             GLint layer, GLenum access, GLenum format);
+typedef void (APIENTRYP PFNMEMORYBARRIER)(GLbitfield barriers);
+
+struct EntryPoints {
+    PFNDISPATCHCOMPUTE dispatchCompute = nullptr;
+    PFNBINDIMAGETEXTURE bindImageTexture = nullptr;
+    PFNMEMORYBARRIER memoryBarrier = nullptr;
+};
+
+inline EntryPoints& entryPoints()
+{
+    static EntryPoints gl;
+    return gl;
+}
+
+// Call after gladLoadGLLoader with the same function (glfwGetProcAddress,
+// eglGetProcAddress). False if the context is older than 4.3.
+inline bool load(GLADloadproc loader)
+{
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major < 4 || (major == 4 && minor < 3)) {
+        std::cout << "ERROR::GL_COMPUTE::CONTEXT_TOO_OLD " << major << "." << minor << " (needs 4.3)" << std::endl;
+        return false;
+    }
+    EntryPoints& gl = entryPoints();
+    gl.dispatchCompute = (PFNDISPATCHCOMPUTE)loader("glDispatchCompute");
+    gl.bindImageTexture = (PFNBINDIMAGETEXTURE)loader("glBindImageTexture");
+    gl.memoryBarrier = (PFNMEMORYBARRIER)loader("glMemoryBarrier");
+    if (!gl.dispatchCompute || !gl.bindImageTexture || !gl.memoryBarrier) {
+        std::cout << "ERROR::GL_COMPUTE::MISSING_ENTRY_POINTS" << std::endl;
+        gl = EntryPoints();
+        return false;
+    }
+    return true;
+}
+
+inline bool loaded() { return entryPoints().dispatchCompute != nullptr; }
+
+} // namespace GLCompute
+
+class GLComputeRenderer {
+public:
+    // Compute shader source, relative to the build directory like ray.vert
+    std::string shaderPath = "../shaders/rayTracer.comp";
+
+    // Needs GLCompute::load() first. False if the shader didn't build, the
+    // renderer stays unusable then (render() does nothing).
+    bool init(int w, int h)
+    {
+        width = w;
+        height = h;
+        if (!GLCompute::loaded()) {
+            std::cout << "ERROR::GL_COMPUTE::NOT_LOADED call GLCompute::load() first" << std::endl;
+            return false;
+        }
+        if (!buildProgram()) return false;
+
+        // rgba8 so the shader can bind it as an image, sampled by ray.frag like the Metal copy
+        glGenTextures(1, &glTextureID);
+        glBindTexture(GL_TEXTURE_2D, glTextureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // std140 rounds the camera block up to whole vec4s
+        glGenBuffers(1, &cameraBuffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, (sizeof(GPUCamera) + 15) & ~(size_t)15, nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        // Always bound, only written when the shader is built with stats
+        GPUStats zero = {};
+        glGenBuffers(1, &statsBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, statsBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GPUStats), &zero, GL_DYNAMIC_READ);
+
+        const std::vector<float>& tile = blueNoiseTile();
+        glGenBuffers(1, &blueNoiseBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, blueNoiseBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(float) * tile.size(), tile.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        setScene(Scene::demo());
+        setLights(Scene::demo().lights);
+        setSampler(SamplerType::Grid);
+        return true;
+    }
+
+    void render(const Camera& camera)
+    {
+        if (!program) return;
+        GLCompute::EntryPoints& gl = GLCompute::entryPoints();
+
+        uint64_t encodeStart = Profiler::get().nowUs();
+        GPUCamera gpuCam = toGPU(camera, width, height);
+        glBindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(GPUCamera), &gpuCam);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+#if RT_ENABLE_STATS
+        GPUStats zero = {};
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, statsBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GPUStats), &zero);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+#endif
+
+        glUseProgram(program);
+        glUniform1ui(uniforms.lightCount, lightParams.count);
+        glUniform1ui(uniforms.lightSamples, lightParams.samples);
+        glUniform1ui(uniforms.samplerType, samplerParams.type);
+        glUniform1ui(uniforms.samplesPerPixel, samplerParams.samplesPerPixel);
+        glUniform1ui(uniforms.frameIndex, samplerParams.frame);
+        glUniform1ui(uniforms.nodeCount, sceneParams.nodeCount);
+
+        // same slots as the Metal buffers
+        gl.bindImageTexture(0, glTextureID, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        glBindBufferBase(GL_UNIFORM_BUFFER, 0, cameraBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, statsBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, lightBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, lightNodeBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, blueNoiseBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, sphereBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, materialBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, nodeBuffer);
+
+        gl.dispatchCompute((GLuint)(width + 7) / 8, (GLuint)(height + 7) / 8, 1);
+        // the quad draw samples the image next, readPixels may glGetTexImage it,
+        // the counters get read back below
+        gl.memoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT |
+                         GL_BUFFER_UPDATE_BARRIER_BIT);
+        glUseProgram(0);
+        if (Profiler::get().isRecording())
+            Profiler::get().record("dispatch", "frame", encodeStart, Profiler::get().nowUs());
+
+#if RT_ENABLE_STATS
+        // Waits for the dispatch, the one sync point per frame (same as waitUntilCompleted)
+        GPUStats gpuStats = {};
+        {
+            PROFILE_SCOPE("glGetBufferSubData");
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, statsBuffer);
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GPUStats), &gpuStats);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+        frameStats = RenderStats();
+        frameStats.primaryRays       = statTotal(gpuStats, STAT_PRIMARY_RAYS);
+        frameStats.shadowRays        = statTotal(gpuStats, STAT_SHADOW_RAYS);
+        frameStats.reflectionRays    = statTotal(gpuStats, STAT_REFLECTION_RAYS);
+        frameStats.primitiveTests    = statTotal(gpuStats, STAT_PRIMITIVE_TESTS);
+        frameStats.shadowEarlyOuts   = statTotal(gpuStats, STAT_SHADOW_EARLY_OUTS);
+        frameStats.throughputCutoffs = statTotal(gpuStats, STAT_THROUGHPUT_CUTOFFS);
+        frameStats.samples           = statTotal(gpuStats, STAT_SAMPLES);
+        frameStats.occluderCacheLookups = statTotal(gpuStats, STAT_OCCLUDER_CACHE_LOOKUPS);
+        frameStats.occluderCacheHits    = statTotal(gpuStats, STAT_OCCLUDER_CACHE_HITS);
+        frameStats.nodesVisited         = statTotal(gpuStats, STAT_NODES_VISITED);
+        frameStats.pixels            = (uint64_t)width * height;
+#endif
+    }
+
+    unsigned int getOpenGLTextureID() { return glTextureID; }
+
+    void cleanup()
+    {
+        if (program) glDeleteProgram(program);
+        if (glTextureID) glDeleteTextures(1, &glTextureID);
+        GLuint buffers[] = {cameraBuffer, statsBuffer,  lightBuffer,    lightNodeBuffer,
+                            blueNoiseBuffer, sphereBuffer, materialBuffer, nodeBuffer};
+        for (GLuint buffer : buffers)
+            if (buffer) glDeleteBuffers(1, &buffer);
+        program = glTextureID = cameraBuffer = statsBuffer = lightBuffer = lightNodeBuffer = blueNoiseBuffer = 0;
+        sphereBuffer = materialBuffer = nodeBuffer = 0;
+        gpuScene = GPUScene();
+    }
+
+    // counters from the last render() call (all zero with RT_ENABLE_STATS=0)
+    const RenderStats& getFrameStats() const { return frameStats; }
+    // The image never leaves the GPU, so there's nothing to draw the overlay
+    // into. Kept so the backends are interchangeable; the stats still get written.
+    void setOverlayText(const std::string&) {}
+
+    // Spheres + their BVH. The first call (and any change in sphere count)
+    // builds and uploads everything; after that the tree is refitted and only
+    // the changed ranges go up with glBufferSubData. Triangles are ignored.
+    void setScene(const Scene& scene)
+    {
+        PROFILE_SCOPE("GLComputeRenderer::setScene");
+        if (gpuScene.nodes.empty()) gpuScene.build(scene);
+        else gpuScene.update(scene);
+        lastUploadBytes = gpuScene.dirtyBytes();
+
+        if (gpuScene.resized) {
+            uploadAll(sphereBuffer, gpuScene.spheres);
+            uploadAll(materialBuffer, gpuScene.materials);
+            uploadAll(nodeBuffer, gpuScene.nodes);
+        } else {
+            uploadRange(sphereBuffer, gpuScene.spheres, gpuScene.sphereDirty);
+            if (gpuScene.materialsResized) uploadAll(materialBuffer, gpuScene.materials);
+            else uploadRange(materialBuffer, gpuScene.materials, gpuScene.materialDirty);
+            uploadRange(nodeBuffer, gpuScene.nodes, gpuScene.nodeDirty);
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        gpuScene.clearDirty();
+        sceneParams = gpuScene.params();
+    }
+
+    // bytes the last setScene() sent
+    size_t getLastUploadBytes() const { return lastUploadBytes; }
+    const GPUScene& getGPUScene() const { return gpuScene; }
+
+    // builds the light BVH and uploads it, init() starts with the demo light.
+    // lightSamples = lights sampled per hit, 0 = every light
+    void setLights(const std::vector<Light>& lights, int lightSamples = 4)
+    {
+        LightBVH lightBVH;
+        lightBVH.build(lights);
+
+        // Buffers can't be empty, keep one zeroed entry around when there are no lights
+        std::vector<GPULight> lightData(std::max<size_t>(1, lightBVH.lights.size()), GPULight{});
+        std::vector<GPULightNode> nodeData(std::max<size_t>(1, lightBVH.nodes.size()), GPULightNode{});
+        std::copy(lightBVH.lights.begin(), lightBVH.lights.end(), lightData.begin());
+        std::copy(lightBVH.nodes.begin(), lightBVH.nodes.end(), nodeData.begin());
+
+        if (!lightBuffer) glGenBuffers(1, &lightBuffer);
+        if (!lightNodeBuffer) glGenBuffers(1, &lightNodeBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GPULight) * lightData.size(), lightData.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightNodeBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GPULightNode) * nodeData.size(), nodeData.data(),
+                     GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        lightParams.count = (uint32_t)lightBVH.lights.size();
+        lightParams.samples = lightSamples > 0 ? (uint32_t)lightSamples : lightParams.count;
+    }
+
+    // sampler for pixel jitter and light picks, init() starts with the 4 sample grid
+    void setSampler(SamplerType type, int samplesPerPixel = 4)
+    {
+        samplerParams.type = (uint32_t)type;
+        samplerParams.samplesPerPixel = (uint32_t)std::max(1, samplesPerPixel);
+    }
+
+    // keys the sample streams, same as CpuRenderer::setFrameIndex
+    void setFrameIndex(uint32_t frame) { samplerParams.frame = frame; }
+
+private:
+    int width = 0, height = 0;
+    GLuint program = 0;
+    GLuint glTextureID = 0;
+    GLuint cameraBuffer = 0;
+    GLuint statsBuffer = 0;
+    GLuint lightBuffer = 0;
+    GLuint lightNodeBuffer = 0;
+    GLuint blueNoiseBuffer = 0;
+    GLuint sphereBuffer = 0;
+    GLuint materialBuffer = 0;
+    GLuint nodeBuffer = 0;
+
+    // Uniforms standing in for the Metal light/sampler/scene param buffers
+    struct {
+        GLint lightCount = -1, lightSamples = -1, samplerType = -1, samplesPerPixel = -1, frameIndex = -1;
+        GLint nodeCount = -1;
+    } uniforms;
+    GPULightParams lightParams = {};
+    GPUSamplerParams samplerParams = {};
+    GPUSceneParams sceneParams = {};
+
+    GPUScene gpuScene;
+    size_t lastUploadBytes = 0;
+
+    // Buffers can't be empty, an empty scene still gets one zeroed element
+    template <typename T>
+    static void uploadAll(GLuint& buffer, const std::vector<T>& data)
+    {
+        if (!buffer) glGenBuffers(1, &buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        if (data.empty()) {
+            T zero = {};
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(T), &zero, GL_DYNAMIC_DRAW);
+        } else {
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(T) * data.size(), data.data(), GL_DYNAMIC_DRAW);
+        }
+    }
+
+    template <typename T>
+    static void uploadRange(GLuint buffer, const std::vector<T>& data, const DirtyRange& range)
+    {
+        if (range.empty()) return;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(T) * range.begin, sizeof(T) * (range.end - range.begin),
+                        data.data() + range.begin);
+    }
+
+    RenderStats frameStats;
+
+    bool buildProgram()
+    {
+        std::ifstream file(shaderPath);
+        if (!file) {
+            std::cout << "ERROR::GL_COMPUTE::FILE_NOT_SUCCESFULLY_READ " << shaderPath << std::endl;
+            return false;
+        }
+        std::stringstream stream;
+        stream << file.rdbuf();
+        std::string source = stream.str();
+
+        // stats switch is forwarded so the shader drops its counters too,
+        // has to go after #version
+        size_t versionEnd = source.find('\n', source.find("#version"));
+        if (versionEnd == std::string::npos) {
+            std::cout << "ERROR::GL_COMPUTE::NO_VERSION_LINE " << shaderPath << std::endl;
+            return false;
+        }
+        source.insert(versionEnd + 1, "#define RT_ENABLE_STATS " + std::to_string(RT_ENABLE_STATS) + "\n");
+
+        const char* code = source.c_str();
+        GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(shader, 1, &code, nullptr);
+        glCompileShader(shader);
+        if (!checkStatus(shader, GL_COMPILE_STATUS, "COMPILATION_FAILED")) {
+            glDeleteShader(shader);
+            return false;
+        }
+        program = glCreateProgram();
+        glAttachShader(program, shader);
+        glLinkProgram(program);
+        glDeleteShader(shader);
+        if (!checkStatus(program, GL_LINK_STATUS, "LINKING_FAILED")) {
+            glDeleteProgram(program);
+            program = 0;
+            return false;
+        }
+
+        uniforms.lightCount = glGetUniformLocation(program, "lightCount");
+        uniforms.lightSamples = glGetUniformLocation(program, "lightSamples");
+        uniforms.samplerType = glGetUniformLocation(program, "samplerType");
+        uniforms.samplesPerPixel = glGetUniformLocation(program, "samplesPerPixel");
+        uniforms.frameIndex = glGetUniformLocation(program, "frameIndex");
+        uniforms.nodeCount = glGetUniformLocation(program, "nodeCount");
+        return true;
+    }
+
+    static bool checkStatus(GLuint object, GLenum status, const char* what)
+    {
+        GLint ok = 0;
+        char infoLog[1024];
+        if (status == GL_COMPILE_STATUS) {
+            glGetShaderiv(object, status, &ok);
+            if (!ok) glGetShaderInfoLog(object, sizeof(infoLog), nullptr, infoLog);
+        } else {
+            glGetProgramiv(object, status, &ok);
+            if (!ok) glGetProgramInfoLog(object, sizeof(infoLog), nullptr, infoLog);
+        }
+        if (!ok)
+            std::cout << "ERROR::GL_COMPUTE::" << what << "\n" << infoLog << std::endl;
+        return ok != 0;
+    }
+};
+
+#endif
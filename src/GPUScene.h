@@ -0,0 +1,229 @@
+#ifndef GPU_SCENE_H
+#define GPU_SCENE_H
+
+#include "BVH.h"
+#include "Scene.h"
+#include "Shared.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <tuple>
+#include <vector>
+
+// The scene as the GPU kernels read it: spheres in BVH leaf order, deduped
+// materials and the BVH nodes, each in its own buffer. The backends upload it
+// once and after that only the ranges that changed (dirty ranges below).
+// Triangles stay on the CPU, the kernels only intersect spheres.
+
+static_assert(sizeof(BVHNode) == 32, "kernels read BVHNode as packed float3 + uint, twice");
+static_assert(sizeof(GPUSphere) == 32, "GPUSphere layout is shared with the kernels");
+static_assert(sizeof(GPUMaterial) == 16, "GPUMaterial layout is shared with the kernels");
+
+// [begin, end) in elements, grows to cover everything marked since the last clear
+struct DirtyRange {
+    size_t begin = 0, end = 0;
+
+    bool empty() const { return begin >= end; }
+    void clear() { begin = end = 0; }
+    void mark(size_t first, size_t count = 1)
+    {
+        if (count == 0) return;
+        if (empty()) {
+            begin = first;
+            end = first + count;
+        } else {
+            begin = std::min(begin, first);
+            end = std::max(end, first + count);
+        }
+    }
+};
+
+class GPUScene {
+public:
+    std::vector<GPUSphere> spheres;   // BVH leaf order
+    std::vector<GPUMaterial> materials;
+    std::vector<BVHNode> nodes;
+    std::vector<uint32_t> sceneIndex; // GPU sphere -> Scene::spheres index
+
+    DirtyRange sphereDirty, materialDirty, nodeDirty;
+    bool resized = false;          // element counts changed, the buffers need reallocating + a full upload
+    bool materialsResized = false; // only the material table grew, spheres and nodes keep their ranges
+
+    GPUSceneParams params() const
+    {
+        GPUSceneParams p = {};
+        p.sphereCount = (uint32_t)spheres.size();
+        p.nodeCount = (uint32_t)nodes.size();
+        return p;
+    }
+
+    // Builds the sphere BVH and lays everything out, all of it dirty
+    void build(const Scene& scene, const BVHBuildSettings& settings = BVHBuildSettings())
+    {
+        PROFILE_SCOPE("GPUScene::build", "build");
+        if (!scene.triangles.empty())
+            std::cout << "ERROR::GPU_SCENE::TRIANGLES_IGNORED " << scene.triangles.size()
+                      << " (the kernels only trace spheres)" << std::endl;
+
+        BVH bvh;
+        bvh.build((uint32_t)scene.spheres.size(), [&](uint32_t i) { return scene.spheres[i].bounds(); }, settings);
+        nodes = bvh.nodes;
+        sceneIndex = bvh.primIndices;
+
+        materials.clear();
+        materialLookup.clear();
+        materialUsers.clear();
+        freeMaterials.clear();
+        spheres.resize(sceneIndex.size());
+        for (size_t i = 0; i < spheres.size(); i++) {
+            const Sphere& sphere = scene.spheres[sceneIndex[i]];
+            spheres[i] = {};
+            spheres[i].center = sphere.center;
+            spheres[i].radius = sphere.radius;
+            spheres[i].material = acquireMaterial(sphere);
+        }
+
+        resized = true;
+        sphereDirty.mark(0, spheres.size());
+        materialDirty.mark(0, materials.size());
+        nodeDirty.mark(0, nodes.size());
+    }
+
+    // Same spheres moved / recoloured: keeps the tree, refits its bounds and
+    // marks whatever changed. A different sphere count rebuilds instead. A
+    // recolour rewrites the sphere's material slot in place when nobody else
+    // uses it, so an animated colour costs one 16 byte range a frame.
+    void update(const Scene& scene)
+    {
+        if (scene.spheres.size() != spheres.size() || nodes.empty()) {
+            build(scene);
+            return;
+        }
+        const size_t materialCount = materials.size();
+        for (size_t i = 0; i < spheres.size(); i++) {
+            const Sphere& sphere = scene.spheres[sceneIndex[i]];
+            GPUSphere packed = spheres[i];
+            packed.center = sphere.center;
+            packed.radius = sphere.radius;
+            const GPUMaterial& current = materials[packed.material];
+            if (current.color != sphere.color || current.reflectivity != sphere.reflectivity)
+                packed.material = recolour(packed.material, sphere);
+            if (std::memcmp(&packed, &spheres[i], sizeof(GPUSphere)) != 0) {
+                spheres[i] = packed;
+                sphereDirty.mark(i);
+            }
+        }
+        if (materials.size() != materialCount) materialsResized = true;
+
+        // children always sit after their parent, so back to front is bottom up
+        for (size_t n = nodes.size(); n-- > 0;) {
+            BVHNode node = nodes[n];
+            AABB box;
+            if (node.primCount > 0) {
+                for (uint32_t i = 0; i < node.primCount; i++) {
+                    const GPUSphere& s = spheres[node.leftFirst + i];
+                    box.grow(AABB{s.center - glm::vec3(s.radius), s.center + glm::vec3(s.radius)});
+                }
+            } else {
+                box.grow(AABB{nodes[node.leftFirst].boundsMin, nodes[node.leftFirst].boundsMax});
+                box.grow(AABB{nodes[node.leftFirst + 1].boundsMin, nodes[node.leftFirst + 1].boundsMax});
+            }
+            node.boundsMin = box.min;
+            node.boundsMax = box.max;
+            if (std::memcmp(&node, &nodes[n], sizeof(BVHNode)) != 0) {
+                nodes[n] = node;
+                nodeDirty.mark(n);
+            }
+        }
+    }
+
+    bool dirty() const { return resized || materialsResized || !sphereDirty.empty() || !materialDirty.empty() || !nodeDirty.empty(); }
+
+    // what the next upload sends, everything when resized
+    size_t dirtyBytes() const
+    {
+        if (resized)
+            return sizeof(GPUSphere) * spheres.size() + sizeof(GPUMaterial) * materials.size() +
+                   sizeof(BVHNode) * nodes.size();
+        const size_t materialBytes = materialsResized ? sizeof(GPUMaterial) * materials.size()
+                                                      : sizeof(GPUMaterial) * (materialDirty.end - materialDirty.begin);
+        return sizeof(GPUSphere) * (sphereDirty.end - sphereDirty.begin) + materialBytes +
+               sizeof(BVHNode) * (nodeDirty.end - nodeDirty.begin);
+    }
+
+    // the backend calls this once its buffers match
+    void clearDirty()
+    {
+        resized = false;
+        materialsResized = false;
+        sphereDirty.clear();
+        materialDirty.clear();
+        nodeDirty.clear();
+    }
+
+private:
+    typedef std::tuple<float, float, float, float> MaterialKey;
+    std::map<MaterialKey, uint32_t> materialLookup;
+    std::vector<uint32_t> materialUsers; // spheres per material slot, 0 = free
+    std::vector<uint32_t> freeMaterials; // slots nobody uses anymore, reused before the table grows
+
+    static MaterialKey keyOf(const glm::vec3& color, float reflectivity)
+    {
+        return std::make_tuple(color.r, color.g, color.b, reflectivity);
+    }
+
+    // the slot holding this colour + reflectivity, a new one if there's none
+    uint32_t acquireMaterial(const Sphere& sphere)
+    {
+        const MaterialKey key = keyOf(sphere.color, sphere.reflectivity);
+        auto found = materialLookup.find(key);
+        if (found != materialLookup.end()) {
+            materialUsers[found->second]++;
+            return found->second;
+        }
+        uint32_t material;
+        if (!freeMaterials.empty()) {
+            material = freeMaterials.back();
+            freeMaterials.pop_back();
+        } else {
+            material = (uint32_t)materials.size();
+            materials.emplace_back();
+            materialUsers.push_back(0);
+        }
+        materials[material] = {sphere.color, sphere.reflectivity};
+        materialUsers[material] = 1;
+        materialLookup.emplace(key, material);
+        materialDirty.mark(material);
+        return material;
+    }
+
+    void releaseMaterial(uint32_t material)
+    {
+        if (--materialUsers[material] > 0) return;
+        materialLookup.erase(keyOf(materials[material].color, materials[material].reflectivity));
+        freeMaterials.push_back(material);
+    }
+
+    // A sphere's colour changed: its only user rewrites the slot where it is,
+    // otherwise it moves to the matching (or a free / new) slot
+    uint32_t recolour(uint32_t material, const Sphere& sphere)
+    {
+        const MaterialKey key = keyOf(sphere.color, sphere.reflectivity);
+        if (materialUsers[material] == 1 && materialLookup.find(key) == materialLookup.end()) {
+            materialLookup.erase(keyOf(materials[material].color, materials[material].reflectivity));
+            materials[material] = {sphere.color, sphere.reflectivity};
+            materialLookup.emplace(key, material);
+            materialDirty.mark(material);
+            return material;
+        }
+        const uint32_t next = acquireMaterial(sphere); // first, the release may free the old slot
+        releaseMaterial(material);
+        return next;
+    }
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 64 bit FNV-1a, for keys that only have to tell things apart (shader
+// sources, material texture sets, welded vertices). Chain calls by passing
+// the last result as h. Nothing here is meant to look random, Random.h has
+// the sampler hashes.
+constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+inline uint64_t fnv1a(const void* data, size_t size, uint64_t h = FNV_OFFSET_BASIS)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) h = (h ^ bytes[i]) * FNV_PRIME;
+    return h;
+}
+
+inline uint64_t fnv1a(const std::string& text, uint64_t h = FNV_OFFSET_BASIS)
+{
+    return fnv1a(text.data(), text.size(), h);
+}
+
+#endif
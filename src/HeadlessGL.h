@@ -0,0 +1,56 @@
+#ifndef HEADLESS_GL_H
+#define HEADLESS_GL_H
+
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <iostream>
+
+// Repo root baked in by CMake, so the shader defaults don't depend on the
+// working directory. Falls back to running from build/.
+#ifndef RT_SOURCE_DIR
+#define RT_SOURCE_DIR ".."
+#endif
+
+// Surfaceless EGL context for the windowless GL tools (gl_compute_check,
+// raster_bench). No window system or display needed, Mesa llvmpipe is
+// enough. Loads glad with eglGetProcAddress, false if anything failed.
+inline bool createHeadlessContext(int major = 4, int minor = 3)
+{
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLDisplay display = EGL_NO_DISPLAY;
+    if (getPlatformDisplay)
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint eglMajor = 0, eglMinor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &eglMajor, &eglMinor)) {
+        std::cout << "ERROR::EGL::INITIALIZE_FAILED 0x" << std::hex << eglGetError() << std::dec << std::endl;
+        return false;
+    }
+    eglBindAPI(EGL_OPENGL_API);
+
+    EGLint configAttribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    eglChooseConfig(display, configAttribs, &config, 1, &configCount);
+
+    EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION, major, EGL_CONTEXT_MINOR_VERSION, minor,
+                               EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE};
+    EGLContext context = eglCreateContext(display, configCount > 0 ? config : (EGLConfig)nullptr, EGL_NO_CONTEXT,
+                                          contextAttribs);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        std::cout << "ERROR::EGL::NO_" << major << "_" << minor << "_CONTEXT 0x" << std::hex << eglGetError()
+                  << std::dec << std::endl;
+        return false;
+    }
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return false;
+    }
+    std::cout << "GL " << glGetString(GL_VERSION) << " | " << glGetString(GL_RENDERER) << std::endl;
+    return true;
+}
+
+#endif
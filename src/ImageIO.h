@@ -0,0 +1,102 @@
+#ifndef IMAGE_IO_H
+#define IMAGE_IO_H
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Minimal image files for the headless tools. Buffers are stored the way the
+// renderers produce them: first row = bottom of the screen.
+namespace ImageIO {
+
+// Binary PPM (P6), flipped so the file reads top-down like any viewer expects
+inline bool writePPM(const std::string& path, const uint8_t* rgba, int width, int height)
+{
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cout << "ERROR::IMAGE::COULD_NOT_OPEN " << path << std::endl;
+        return false;
+    }
+    out << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<uint8_t> row(width * 3);
+    for (int y = height - 1; y >= 0; y--) {
+        for (int x = 0; x < width; x++) {
+            const uint8_t* p = rgba + 4 * (y * width + x);
+            row[3 * x + 0] = p[0];
+            row[3 * x + 1] = p[1];
+            row[3 * x + 2] = p[2];
+        }
+        out.write((const char*)row.data(), row.size());
+    }
+    return true;
+}
+
+// Reads a binary PPM back into RGBA8, bottom row first (undoes writePPM)
+inline bool readPPM(const std::string& path, std::vector<uint8_t>& rgba, int& width, int& height)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cout << "ERROR::IMAGE::COULD_NOT_OPEN " << path << std::endl;
+        return false;
+    }
+    std::string magic;
+    int maxValue = 0;
+    in >> magic >> width >> height >> maxValue;
+    in.get(); // single whitespace before the pixel data
+    if (magic != "P6" || width <= 0 || height <= 0 || maxValue != 255) {
+        std::cout << "ERROR::IMAGE::UNSUPPORTED_PPM " << path << std::endl;
+        return false;
+    }
+    rgba.assign((size_t)width * height * 4, 255);
+    std::vector<uint8_t> row(width * 3);
+    for (int y = height - 1; y >= 0; y--) {
+        if (!in.read((char*)row.data(), row.size())) {
+            std::cout << "ERROR::IMAGE::TRUNCATED_PPM " << path << std::endl;
+            return false;
+        }
+        for (int x = 0; x < width; x++) {
+            uint8_t* p = &rgba[4 * (y * width + x)];
+            p[0] = row[3 * x + 0];
+            p[1] = row[3 * x + 1];
+            p[2] = row[3 * x + 2];
+        }
+    }
+    return true;
+}
+
+// PSNR in dB over the RGB channels of two RGBA8 images, infinity if identical
+inline double psnr(const uint8_t* a, const uint8_t* b, int width, int height)
+{
+    double sumSq = 0.0;
+    const size_t count = (size_t)width * height;
+    for (size_t i = 0; i < count; i++) {
+        for (int c = 0; c < 3; c++) {
+            double d = (double)a[4 * i + c] - (double)b[4 * i + c];
+            sumSq += d * d;
+        }
+    }
+    if (sumSq == 0.0) return INFINITY;
+    double mse = sumSq / (double)(count * 3);
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+// Single channel PFM ("Pf"), rows are bottom-up by definition so no flip.
+// Negative scale = little endian floats.
+inline bool writePFM(const std::string& path, const float* values, int width, int height)
+{
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cout << "ERROR::IMAGE::COULD_NOT_OPEN " << path << std::endl;
+        return false;
+    }
+    out << "Pf\n" << width << " " << height << "\n-1.0\n";
+    out.write((const char*)values, sizeof(float) * width * height);
+    return true;
+}
+
+} // namespace ImageIO
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef LIGHT_BVH_H
+#define LIGHT_BVH_H
+
+#include <glm/glm.hpp>
+
+#include "Profiler.h"
+#include "Shared.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Tree over the point lights for picking a light by its estimated
+// contribution instead of looping over all of them. Each interior node
+// stores the summed power below it, sampling walks from the root and picks
+// a child with probability proportional to power / distance^2, so the cost
+// is O(log lights) per sample. The kernel walks the same node array.
+class LightBVH {
+public:
+    std::vector<GPULight> lights;    // leaf order, not the order they were added in
+    std::vector<GPULightNode> nodes;
+
+    // Anything with position, color and intensity (0 = no falloff)
+    template <typename LightT>
+    void build(const std::vector<LightT>& input)
+    {
+        PROFILE_SCOPE("LightBVH::build", "build");
+        lights.clear();
+        nodes.clear();
+        const int count = (int)input.size();
+        if (count == 0) return;
+
+        std::vector<int> order(count);
+        for (int i = 0; i < count; i++) order[i] = i;
+
+        nodes.reserve(2 * count - 1);
+        nodes.push_back(GPULightNode{});
+        buildNode(0, order, 0, count, input);
+    }
+
+    int size() const { return (int)lights.size(); }
+
+    // Brightness used for the importance estimate
+    static float power(const glm::vec3& color, float intensity)
+    {
+        float luminance = glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+        return luminance * (intensity > 0.0f ? intensity : 1.0f);
+    }
+
+    // Estimated contribution of everything under the node at point p
+    static float importance(const GPULightNode& node, const glm::vec3& p)
+    {
+        glm::vec3 bmin(node.boundsMin), bmax(node.boundsMax);
+        glm::vec3 d = p - 0.5f * (bmin + bmax);
+        glm::vec3 halfExtent = 0.5f * (bmax - bmin);
+        // never closer than the box radius, points inside a cluster would blow up otherwise
+        float dist2 = std::max(glm::dot(d, d), glm::dot(halfExtent, halfExtent));
+        return node.boundsMin.w / std::max(dist2, 1e-4f);
+    }
+
+    // Picks one light for point p from u in [0, 1). Returns its index into
+    // lights and the probability it was picked with, -1 if nothing can be picked.
+    int sample(const glm::vec3& p, float u, float& pdf) const
+    {
+        pdf = 0.0f;
+        if (nodes.empty()) return -1;
+        float prob = 1.0f;
+        int index = 0;
+        while (nodes[index].count == 0) {
+            const int left = nodes[index].first;
+            const float wl = importance(nodes[left], p);
+            const float wr = importance(nodes[left + 1], p);
+            if (wl + wr <= 0.0f) return -1;
+            const float pl = wl / (wl + wr);
+            // reuse u for the next level by rescaling it into [0, 1)
+            if (u < pl) {
+                u = std::min(u / pl, 0.99999994f);
+                prob *= pl;
+                index = left;
+            } else {
+                u = std::min((u - pl) / (1.0f - pl), 0.99999994f);
+                prob *= 1.0f - pl;
+                index = left + 1;
+            }
+        }
+        pdf = prob;
+        return nodes[index].first;
+    }
+
+private:
+    template <typename LightT>
+    void buildNode(int nodeIndex, std::vector<int>& order, int begin, int end, const std::vector<LightT>& input)
+    {
+        glm::vec3 bmin(1e30f), bmax(-1e30f);
+        float nodePower = 0.0f;
+        for (int i = begin; i < end; i++) {
+            const LightT& light = input[order[i]];
+            bmin = glm::min(bmin, light.position);
+            bmax = glm::max(bmax, light.position);
+            nodePower += power(light.color, light.intensity);
+        }
+        nodes[nodeIndex].boundsMin = glm::vec4(bmin, nodePower);
+        nodes[nodeIndex].boundsMax = glm::vec4(bmax, 0.0f);
+
+        if (end - begin == 1) {
+            const LightT& light = input[order[begin]];
+            nodes[nodeIndex].first = (int32_t)lights.size();
+            nodes[nodeIndex].count = 1;
+            lights.push_back(GPULight{glm::vec4(light.position, light.intensity),
+                                      glm::vec4(light.color, 0.0f)});
+            return;
+        }
+
+        // Median split on the longest axis keeps the tree balanced
+        glm::vec3 extent = bmax - bmin;
+        int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        int mid = (begin + end) / 2;
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                         [&](int a, int b) { return input[a].position[axis] < input[b].position[axis]; });
+
+        const int left = (int)nodes.size();
+        nodes[nodeIndex].first = left;
+        nodes[nodeIndex].count = 0;
+        nodes.push_back(GPULightNode{});
+        nodes.push_back(GPULightNode{});
+        buildNode(left, order, begin, mid, input);
+        buildNode(left + 1, order, mid, end, input);
+    }
+};
+
+#endif
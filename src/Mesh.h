@@ -4,9 +4,13 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "Hash.h"
 #include "Shader.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 
 #define MAX_BONE_INFLUENCE 4
@@ -43,31 +47,127 @@ store them as std::unique_ptr<Mesh> */
     std::vector<Texture> textures;
     unsigned int VAO;
 
+    // One per texture, worked out at load so drawing never builds a name or
+    // looks one up. location is the sampler uniform in the last program this
+    // mesh was drawn with, -1 if that program doesn't use it.
+    struct TextureBinding {
+        int location;
+        unsigned int unit;
+        unsigned int id;
+    };
+    std::vector<TextureBinding> bindings;
+    uint64_t materialKey = 0; // hash of the texture ids, equal keys draw with the same textures
+
+    // object space box around the vertices, for culling
+    glm::vec3 boundsMin = glm::vec3(0.0f), boundsMax = glm::vec3(0.0f);
+
+    // Index ranges in the EBO, lods[0] is indices itself and each addLod()
+    // appends a coarser one. error is how far (object space) a level strays
+    // from the full mesh, the culler turns it into pixels to pick a level.
+    struct LodLevel {
+        unsigned int firstIndex;
+        unsigned int count;
+        float error;
+    };
+    std::vector<LodLevel> lods;
+
     // constructor
     Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indicies, std::vector<Texture> textures)
     {
-        this->vertices = vertices;
-        this->indices = indicies;
-        this->textures = textures;
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indicies);
+        this->textures = std::move(textures);
 
         // now with all data, set up vertex buffer and attribute pointers
         setUpMesh();
+        setUpBindings();
+        setUpBounds();
+        lods.push_back({0, (unsigned int)this->indices.size(), 0.0f});
+    }
+
+    // Appends a coarser level over the same vertices, errors have to grow
+    // level to level. Load time only, it re-sends the whole index buffer.
+    void addLod(const std::vector<unsigned int> &lodIndices, float error)
+    {
+        lods.push_back({(unsigned int)(indices.size() + lodIndexData.size()), (unsigned int)lodIndices.size(), error});
+        lodIndexData.insert(lodIndexData.end(), lodIndices.begin(), lodIndices.end());
+        std::vector<unsigned int> all(indices);
+        all.insert(all.end(), lodIndexData.begin(), lodIndexData.end());
+        glBindVertexArray(VAO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, all.size() * sizeof(unsigned int), all.data(), GL_STATIC_DRAW);
+        glBindVertexArray(0);
     }
 
     // render the mesh
     void Draw(Shader &shader)
     {
-        // bind appropiate textures
+        bindMaterial(shader);
+        drawGeometry();
+        glBindVertexArray(0); // unbind
+        // sets back to default
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // sets the samplers to their units and binds the textures
+    void bindMaterial(const Shader &shader)
+    {
+        if (shader.ID != boundProgram) resolveLocations(shader);
+        for (const TextureBinding& binding : bindings)
+        {
+            glActiveTexture(GL_TEXTURE0 + binding.unit); // active proper texture unit before binding
+            if (binding.location >= 0) glUniform1i(binding.location, (int)binding.unit);
+            glBindTexture(GL_TEXTURE_2D, binding.id);
+        }
+    }
+
+    // leaves the VAO bound, the caller unbinds after the last mesh
+    void drawGeometry(unsigned int lod = 0) const
+    {
+        const LodLevel& level = lods[std::min<size_t>(lod, lods.size() - 1)];
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(level.count), GL_UNSIGNED_INT,
+                       (void*)(sizeof(unsigned int) * level.firstIndex));
+    }
+
+    // same textures under the same sampler names, so drawing other after this needs no rebinds
+    bool sameMaterial(const Mesh &other) const
+    {
+        if (materialKey != other.materialKey || bindings.size() != other.bindings.size()) return false;
+        for (size_t i = 0; i < bindings.size(); i++)
+            if (bindings[i].id != other.bindings[i].id || samplerNames[i] != other.samplerNames[i]) return false;
+        return true;
+    }
+
+private:
+    // rendering data
+    unsigned int VBO, EBO;
+    std::vector<std::string> samplerNames; // "texture_diffuse1"..., parallel to bindings
+    unsigned int boundProgram = 0;
+    std::vector<unsigned int> lodIndexData; // lods[1..] back to back, after indices in the EBO
+
+    void setUpBounds()
+    {
+        if (vertices.empty()) return;
+        boundsMin = boundsMax = vertices[0].Position;
+        for (const Vertex& vertex : vertices)
+        {
+            boundsMin = glm::min(boundsMin, vertex.Position);
+            boundsMax = glm::max(boundsMax, vertex.Position);
+        }
+    }
+
+    // the N in diffuse_textureN counts per type, in the order the textures came in
+    void setUpBindings()
+    {
         unsigned int diffuseNr = 1;
         unsigned int specularNr = 1;
         unsigned int normalNr = 1;
         unsigned int heighNr = 1;
+        materialKey = FNV_OFFSET_BASIS; // FNV-1a over the ids
         for (unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
             std::string number;
-            std::string name = textures[i].type;
+            const std::string& name = textures[i].type;
             if(name == "texture_diffuse")
                 number = std::to_string(diffuseNr++);
             else if(name == "texture_specular")
@@ -76,25 +176,19 @@ store them as std::unique_ptr<Mesh> */
                 number = std::to_string(normalNr++); // transfer unsigned int to string
             else if(name == "texture_height")
                 number = std::to_string(heighNr++); // transfer unsigned int to string
-            
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // finally bind texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            samplerNames.push_back(name + number);
+            bindings.push_back({-1, i, textures[i].id});
+            materialKey = fnv1a(&textures[i].id, sizeof(textures[i].id), materialKey);
         }
-
-        // draw the mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0); // unbind
-
-        // sets back to default
-        glActiveTexture(GL_TEXTURE0);
     }
 
-private:
-    // rendering data
-    unsigned int VBO, EBO;
+    // once per program, not per draw
+    void resolveLocations(const Shader &shader)
+    {
+        for (size_t i = 0; i < bindings.size(); i++)
+            bindings[i].location = shader.location(samplerNames[i]);
+        boundProgram = shader.ID;
+    }
 
     void setUpMesh()
     {
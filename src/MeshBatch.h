@@ -0,0 +1,358 @@
+#ifndef MESH_BATCH_H
+#define MESH_BATCH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+#include "Shader.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+// glMultiDrawElementsIndirect is GL 4.3 / ARB_multi_draw_indirect and glad
+// is 3.3, so it's loaded by hand like GLCompute::load. Without it MeshBatch
+// still draws from the shared buffers, one glDrawElementsBaseVertex a mesh.
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+namespace MultiDraw {
+
+typedef void (APIENTRYP PFNMULTIDRAWELEMENTSINDIRECT)(GLenum mode, GLenum type, const void* indirect,
+                                                      GLsizei drawcount, GLsizei stride);
+
+inline PFNMULTIDRAWELEMENTSINDIRECT& entryPoint()
+{
+    static PFNMULTIDRAWELEMENTSINDIRECT multiDrawElementsIndirect = nullptr;
+    return multiDrawElementsIndirect;
+}
+
+// Call after gladLoadGLLoader. False on contexts older than 4.3 (macOS tops
+// out at 4.1), MeshBatch falls back to a draw per mesh then.
+inline bool load(GLADloadproc loader)
+{
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    entryPoint() = nullptr;
+    if (major < 4 || (major == 4 && minor < 3)) return false;
+    entryPoint() = (PFNMULTIDRAWELEMENTSINDIRECT)loader("glMultiDrawElementsIndirect");
+    return entryPoint() != nullptr;
+}
+
+inline bool loaded() { return entryPoint() != nullptr; }
+
+} // namespace MultiDraw
+
+// Layout glMultiDrawElementsIndirect reads
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance; // = the draw index, feeds aDrawID
+};
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "indirect commands are 5 tightly packed uints");
+
+// Many meshes (a model, or everything in the scene) packed into one vertex
+// buffer, one index buffer and one texture array, drawn with a single
+// glMultiDrawElementsIndirect. Needs the BATCHED variant of basic.vert /
+// basic.frag:
+//
+//   Shader batched("../shaders/basic.vert", "../shaders/basic.frag", "#define BATCHED\n");
+//
+// Per draw data (model matrix, diffuse + specular layer) lives in a buffer
+// texture indexed by aDrawID. Every texture gets scaled into a layerSize^2
+// layer of the array, layer 0 is white (no diffuse map), layer 1 black (no
+// specular map). add() copies what it needs, the meshes can go away after.
+class MeshBatch {
+public:
+    static constexpr int ARRAY_UNIT = 0; // materialTextures
+    static constexpr int DATA_UNIT = 1;  // drawData
+    static constexpr GLuint DRAW_ID_ATTRIBUTE = 7;
+
+    int layerSize = 512;
+    bool useIndirect = true; // false forces the per mesh fallback (for comparisons)
+
+    void add(const Mesh& mesh, const glm::mat4& model = glm::mat4(1.0f))
+    {
+        DrawElementsIndirectCommand command;
+        command.count = (GLuint)mesh.indices.size();
+        command.instanceCount = 1;
+        command.firstIndex = (GLuint)indices.size();
+        command.baseVertex = (GLint)vertices.size();
+        command.baseInstance = (GLuint)commands.size();
+        commands.push_back(command);
+        vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+        indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+
+        // first map of each kind, the same ones basic.frag samples
+        PendingMaterial material = {0, 0};
+        for (const Texture& texture : mesh.textures) {
+            if (texture.type == "texture_diffuse" && !material.diffuse) material.diffuse = texture.id;
+            if (texture.type == "texture_specular" && !material.specular) material.specular = texture.id;
+        }
+        materials.push_back(material);
+        models.push_back(model);
+    }
+
+    size_t size() const { return commands.size(); }
+    bool indirect() const { return useIndirect && indirectBuffer != 0; }
+    int getTextureLayers() const { return textureLayers; }
+
+    // Uploads everything added so far, once. The CPU copies of the geometry
+    // are dropped afterwards.
+    bool build()
+    {
+        if (commands.empty()) {
+            std::cout << "ERROR::MESH_BATCH::EMPTY" << std::endl;
+            return false;
+        }
+        if (vao) {
+            std::cout << "ERROR::MESH_BATCH::ALREADY_BUILT" << std::endl;
+            return false;
+        }
+        GLint maxTexels = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+        if (commands.size() * TEXELS_PER_DRAW > (size_t)maxTexels) {
+            std::cout << "ERROR::MESH_BATCH::TOO_MANY_DRAWS " << commands.size() << " (buffer textures hold "
+                      << maxTexels / TEXELS_PER_DRAW << ")" << std::endl;
+            return false;
+        }
+
+        buildTextureArray();
+        buildGeometry();
+
+        drawData.resize(commands.size() * TEXELS_PER_DRAW);
+        for (size_t i = 0; i < commands.size(); i++) writeDrawData(i);
+        glGenBuffers(1, &dataBuffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, dataBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::vec4) * drawData.size(), drawData.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        glGenTextures(1, &dataTexture);
+        glBindTexture(GL_TEXTURE_BUFFER, dataTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, dataBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+        if (MultiDraw::loaded()) {
+            glGenBuffers(1, &indirectBuffer);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawElementsIndirectCommand) * commands.size(),
+                         commands.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
+
+        std::vector<Vertex>().swap(vertices);
+        std::vector<unsigned int>().swap(indices);
+        return true;
+    }
+
+    // moves one draw, only its four texels get re-sent
+    void setModel(size_t draw, const glm::mat4& model)
+    {
+        if (draw >= models.size()) return;
+        models[draw] = model;
+        writeDrawData(draw);
+        glBindBuffer(GL_TEXTURE_BUFFER, dataBuffer);
+        glBufferSubData(GL_TEXTURE_BUFFER, sizeof(glm::vec4) * draw * TEXELS_PER_DRAW, sizeof(glm::mat4),
+                        &drawData[draw * TEXELS_PER_DRAW]);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // Expects the BATCHED shader in use with FrameData attached
+    void draw(const Shader& shader)
+    {
+        if (!vao) return;
+        if (shader.ID != boundProgram) {
+            arrayLocation = shader.location("materialTextures");
+            dataLocation = shader.location("drawData");
+            boundProgram = shader.ID;
+        }
+        glUniform1i(arrayLocation, ARRAY_UNIT);
+        glUniform1i(dataLocation, DATA_UNIT);
+        glActiveTexture(GL_TEXTURE0 + ARRAY_UNIT);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray);
+        glActiveTexture(GL_TEXTURE0 + DATA_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, dataTexture);
+
+        glBindVertexArray(vao);
+        if (indirect()) {
+            glEnableVertexAttribArray(DRAW_ID_ATTRIBUTE);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+            MultiDraw::entryPoint()(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)commands.size(), 0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        } else {
+            // no base instance before 4.2, the draw index goes in as the attribute's current value
+            glDisableVertexAttribArray(DRAW_ID_ATTRIBUTE);
+            for (const DrawElementsIndirectCommand& command : commands) {
+                glVertexAttribI4i(DRAW_ID_ATTRIBUTE, (GLint)command.baseInstance, 0, 0, 0);
+                glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)command.count, GL_UNSIGNED_INT,
+                                         (void*)(sizeof(unsigned int) * command.firstIndex), command.baseVertex);
+            }
+        }
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    void cleanup()
+    {
+        if (vao) glDeleteVertexArrays(1, &vao);
+        GLuint buffers[] = {vertexBuffer, indexBuffer, drawIdBuffer, dataBuffer, indirectBuffer};
+        for (GLuint buffer : buffers)
+            if (buffer) glDeleteBuffers(1, &buffer);
+        if (textureArray) glDeleteTextures(1, &textureArray);
+        if (dataTexture) glDeleteTextures(1, &dataTexture);
+        vao = vertexBuffer = indexBuffer = drawIdBuffer = dataBuffer = indirectBuffer = 0;
+        textureArray = dataTexture = 0;
+        boundProgram = 0;
+        textureLayers = 0;
+    }
+
+private:
+    static constexpr size_t TEXELS_PER_DRAW = 5; // model columns + layers, see basic.vert
+
+    struct PendingMaterial {
+        GLuint diffuse, specular; // GL texture ids, 0 for none
+    };
+
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<PendingMaterial> materials;
+    std::vector<glm::mat4> models;
+    std::vector<glm::vec2> layers; // diffuse, specular per draw
+    std::vector<glm::vec4> drawData;
+
+    GLuint vao = 0, vertexBuffer = 0, indexBuffer = 0, drawIdBuffer = 0, dataBuffer = 0, indirectBuffer = 0;
+    GLuint textureArray = 0, dataTexture = 0;
+    GLuint boundProgram = 0;
+    GLint arrayLocation = -1, dataLocation = -1;
+    int textureLayers = 0;
+
+    void writeDrawData(size_t draw)
+    {
+        glm::vec4* texels = &drawData[draw * TEXELS_PER_DRAW];
+        for (int column = 0; column < 4; column++) texels[column] = models[draw][column];
+        texels[4] = glm::vec4(layers[draw], 0.0f, 0.0f);
+    }
+
+    // Every distinct texture scaled into one layer with glBlitFramebuffer
+    // (works from 3.0, any source size), then mipmapped as a whole
+    void buildTextureArray()
+    {
+        std::unordered_map<GLuint, int> layerOf;
+        std::vector<GLuint> sources;
+        GLint maxLayers = 0;
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+        auto layerFor = [&](GLuint id, int fallback) {
+            if (!id) return fallback;
+            auto found = layerOf.find(id);
+            if (found != layerOf.end()) return found->second;
+            int layer = 2 + (int)sources.size();
+            if (layer >= maxLayers) {
+                std::cout << "ERROR::MESH_BATCH::TOO_MANY_TEXTURES texture " << id << " (max " << maxLayers
+                          << " layers)" << std::endl;
+                layer = fallback;
+            } else {
+                sources.push_back(id);
+            }
+            layerOf.emplace(id, layer);
+            return layer;
+        };
+        layers.resize(materials.size());
+        for (size_t i = 0; i < materials.size(); i++)
+            layers[i] = glm::vec2((float)layerFor(materials[i].diffuse, 0), (float)layerFor(materials[i].specular, 1));
+        textureLayers = 2 + (int)sources.size();
+
+        glGenTextures(1, &textureArray);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, layerSize, layerSize, textureLayers, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, nullptr);
+        std::vector<unsigned char> fill((size_t)layerSize * layerSize * 4, 255);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, layerSize, layerSize, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                        fill.data());
+        for (size_t i = 0; i < fill.size(); i++) fill[i] = (i % 4 == 3) ? 255 : 0;
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 1, layerSize, layerSize, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                        fill.data());
+
+        GLint previousRead = 0, previousDraw = 0;
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousRead);
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousDraw);
+        GLuint framebuffers[2];
+        glGenFramebuffers(2, framebuffers);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers[0]);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[1]);
+        for (size_t i = 0; i < sources.size(); i++) {
+            GLint width = 0, height = 0;
+            glBindTexture(GL_TEXTURE_2D, sources[i]);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+            glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, sources[i], 0);
+            glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textureArray, 0, (GLint)(2 + i));
+            if (width <= 0 || height <= 0 || glCheckFramebufferStatus(GL_READ_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE ||
+                glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+                std::cout << "ERROR::MESH_BATCH::TEXTURE_COPY_FAILED texture " << sources[i] << std::endl;
+                continue;
+            }
+            glBlitFramebuffer(0, 0, width, height, 0, 0, layerSize, layerSize, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, previousRead);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousDraw);
+        glDeleteFramebuffers(2, framebuffers);
+
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+
+    // same attribute layout as Mesh::setUpMesh, plus the per draw index
+    void buildGeometry()
+    {
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vertexBuffer);
+        glGenBuffers(1, &indexBuffer);
+        glGenBuffers(1, &drawIdBuffer);
+
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+        glEnableVertexAttribArray(5);
+        glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
+        glEnableVertexAttribArray(6);
+        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
+
+        // 0..N-1, one per instance: baseInstance = draw index picks the right one
+        std::vector<GLint> drawIds(commands.size());
+        for (size_t i = 0; i < drawIds.size(); i++) drawIds[i] = (GLint)i;
+        glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+        glBufferData(GL_ARRAY_BUFFER, drawIds.size() * sizeof(GLint), drawIds.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(DRAW_ID_ATTRIBUTE);
+        glVertexAttribIPointer(DRAW_ID_ATTRIBUTE, 1, GL_INT, sizeof(GLint), (void*)0);
+        glVertexAttribDivisor(DRAW_ID_ATTRIBUTE, 1);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+};
+
+#endif
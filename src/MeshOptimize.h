@@ -0,0 +1,272 @@
+#ifndef MESH_OPTIMIZE_H
+#define MESH_OPTIMIZE_H
+
+#include "Hash.h"
+#include "MeshSimplify.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+// Import optimisation for one mesh in engine format, before it becomes a
+// Mesh (or Scene triangles). assimp hands over every face corner as it sits
+// in the file, without aiProcess_JoinIdenticalVertices, so the same vertex
+// shows up many times and triangles come in whatever order the exporter
+// wrote them. Three passes fix that:
+//
+//   weld    bit for bit equal vertices become one
+//   cache   triangles reordered for the post transform vertex cache (Tipsify,
+//           Sander, Nehab & Barczak 2007)
+//   fetch   vertices renumbered in first use order, so the vertex fetch
+//           walks the buffer front to back and neighbouring triangles sit
+//           close together in memory (BVH leaves too)
+//
+// Templated on the vertex type, it only needs to be trivially copyable with
+// no padding, like Vertex.
+
+struct MeshImportSettings {
+    bool weld = true;          // merge duplicate vertices
+    bool optimizeOrder = true; // triangle order for the vertex cache, vertex order for fetch
+    LodChainSettings lods;     // maxLevels = 0 skips the chain
+};
+
+// Merges vertices whose bytes are equal, indices follow. Returns how many went.
+template <typename VertexT>
+inline size_t weldVertices(std::vector<VertexT>& vertices, std::vector<unsigned int>& indices)
+{
+    static_assert(std::is_trivially_copyable<VertexT>::value, "weldVertices compares raw bytes");
+    PROFILE_SCOPE("weldVertices", "load");
+    const size_t count = vertices.size();
+    if (count == 0) return 0;
+
+    // open addressing over the new vertex ids, at most half full
+    size_t buckets = 1;
+    while (buckets < 2 * count) buckets <<= 1;
+    const uint32_t EMPTY = 0xffffffffu;
+    std::vector<uint32_t> table(buckets, EMPTY);
+    std::vector<uint32_t> remap(count);
+    size_t unique = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t slot = fnv1a(&vertices[i], sizeof(VertexT)) & (buckets - 1);
+        while (table[slot] != EMPTY && std::memcmp(&vertices[table[slot]], &vertices[i], sizeof(VertexT)) != 0)
+            slot = (slot + 1) & (buckets - 1);
+        if (table[slot] == EMPTY) {
+            vertices[unique] = vertices[i]; // unique <= i, the slot's vertex stays where the table points
+            table[slot] = (uint32_t)unique++;
+        }
+        remap[i] = table[slot];
+    }
+    vertices.resize(unique);
+    for (unsigned int& index : indices) index = remap[index];
+    return count - unique;
+}
+
+// Reorders triangles so vertices get reused while they're still in a FIFO
+// cache of cacheSize entries. Linear time, no per vertex scoring tables.
+inline void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, int cacheSize = 16)
+{
+    PROFILE_SCOPE("optimizeVertexCache", "load");
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || vertexCount == 0) return;
+
+    // vertex -> its triangles, CSR
+    std::vector<uint32_t> live(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++) live[indices[i]]++;
+    std::vector<uint32_t> first(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) first[v + 1] = first[v] + live[v];
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    {
+        std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; i++) adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32_t> deadEnd; // recently touched vertices, a way back when a fan runs dry
+    deadEnd.reserve(triangleCount * 3);
+    std::vector<uint32_t> candidates;
+    std::vector<unsigned int> out;
+    out.reserve(triangleCount * 3);
+    uint32_t timeStamp = (uint32_t)cacheSize + 1;
+    size_t cursor = 1;
+    int64_t fanning = 0;
+
+    while (fanning >= 0) {
+        candidates.clear();
+        // every triangle left around the fanning vertex goes out
+        for (uint32_t a = first[fanning]; a < first[fanning + 1]; a++) {
+            const uint32_t t = adjacency[a];
+            if (emitted[t]) continue;
+            emitted[t] = 1;
+            for (int k = 0; k < 3; k++) {
+                const uint32_t v = indices[3 * t + k];
+                out.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (timeStamp - cacheTime[v] > (uint32_t)cacheSize) cacheTime[v] = timeStamp++;
+            }
+        }
+        // next: the candidate that stays in the cache the longest after its
+        // own triangles, else the last vertex still in use, else a new one
+        fanning = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (live[v] == 0) continue;
+            int64_t priority = 0;
+            if (timeStamp - cacheTime[v] + 2 * live[v] <= (uint32_t)cacheSize) priority = timeStamp - cacheTime[v];
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fanning = v;
+            }
+        }
+        if (fanning >= 0) continue;
+        while (!deadEnd.empty()) {
+            const uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0) {
+                fanning = v;
+                break;
+            }
+        }
+        if (fanning >= 0) continue;
+        for (; cursor < vertexCount; cursor++) {
+            if (live[cursor] > 0) {
+                fanning = (int64_t)cursor++;
+                break;
+            }
+        }
+        if (fanning < 0 && live[0] > 0) fanning = 0; // vertex 0 isn't on the cursor's path
+    }
+    indices.swap(out);
+}
+
+// Renumbers vertices in the order the indices first use them and drops the
+// ones nothing uses. Returns how many were dropped.
+template <typename VertexT>
+inline size_t optimizeVertexFetch(std::vector<VertexT>& vertices, std::vector<unsigned int>& indices)
+{
+    PROFILE_SCOPE("optimizeVertexFetch", "load");
+    const uint32_t UNUSED = 0xffffffffu;
+    std::vector<uint32_t> remap(vertices.size(), UNUSED);
+    std::vector<VertexT> ordered;
+    ordered.reserve(vertices.size());
+    for (unsigned int& index : indices) {
+        if (remap[index] == UNUSED) {
+            remap[index] = (uint32_t)ordered.size();
+            ordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    const size_t dropped = vertices.size() - ordered.size();
+    vertices.swap(ordered);
+    return dropped;
+}
+
+// Vertex shader runs per triangle through a FIFO cache of cacheSize entries
+// (ACMR, 3 = no reuse at all, a regular grid tends to 0.5)
+inline double vertexCacheMissRatio(const std::vector<unsigned int>& indices, size_t vertexCount, int cacheSize = 16)
+{
+    if (indices.size() < 3) return 0.0;
+    std::vector<uint32_t> insertedAt(vertexCount, 0); // FIFO position + 1, 0 = never
+    uint32_t clock = 0;
+    size_t misses = 0;
+    for (unsigned int v : indices) {
+        if (insertedAt[v] == 0 || clock - (insertedAt[v] - 1) >= (uint32_t)cacheSize) {
+            insertedAt[v] = ++clock;
+            misses++;
+        }
+    }
+    return (double)misses / (double)(indices.size() / 3);
+}
+
+// Bytes the vertex fetch pulls through a 16 KB direct mapped cache of 64 byte
+// lines, over the size of the vertex buffer (1 = every byte once)
+inline double vertexFetchRatio(const std::vector<unsigned int>& indices, size_t vertexCount, size_t vertexSize)
+{
+    if (vertexCount == 0) return 0.0;
+    const size_t LINE = 64, LINES = 256;
+    std::vector<uint64_t> cached(LINES, ~0ull);
+    size_t fetched = 0;
+    for (unsigned int v : indices) {
+        const uint64_t begin = (uint64_t)v * vertexSize / LINE, end = ((uint64_t)v * vertexSize + vertexSize - 1) / LINE;
+        for (uint64_t line = begin; line <= end; line++) {
+            if (cached[line % LINES] == line) continue;
+            cached[line % LINES] = line;
+            fetched += LINE;
+        }
+    }
+    return (double)fetched / (double)(vertexCount * vertexSize);
+}
+
+// The whole import stage for one mesh: weld, cache + fetch order, then the
+// LOD chain over the result (its levels cache ordered too). CPU only and
+// touches nothing shared, so meshes can go through it on any thread.
+template <typename VertexT>
+inline std::vector<LodLevelData> prepareMesh(std::vector<VertexT>& vertices, std::vector<unsigned int>& indices,
+                                             const MeshImportSettings& settings)
+{
+    if (settings.weld) weldVertices(vertices, indices);
+    if (settings.optimizeOrder) {
+        optimizeVertexCache(indices, vertices.size());
+        optimizeVertexFetch(vertices, indices);
+    }
+    std::vector<LodLevelData> lods = buildLodChain(vertexPositions(vertices), indices, settings.lods);
+    if (settings.optimizeOrder)
+        for (LodLevelData& level : lods) optimizeVertexCache(level.indices, vertices.size());
+    return lods;
+}
+
+// One mesh through the whole import stage, what Mesh (or Scene) is built from
+template <typename VertexT>
+struct PreparedMesh {
+    std::vector<VertexT> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<LodLevelData> lods;
+};
+
+// The CPU half of loading a file: convert(i, mesh) fills mesh i's vertices
+// and indices from wherever they come from (an aiMesh), then prepareMesh runs
+// on it. Spread over pool one whole mesh per grab, biggest first by
+// weight(i) so a large one doesn't end up running alone at the end. Every
+// mesh lands in its own slot of the result, so the order (and the bytes) come
+// out the same whatever the thread count. pool == nullptr does them in order
+// on the calling thread. convert must only read shared data.
+template <typename VertexT, typename Convert, typename Weight>
+inline std::vector<PreparedMesh<VertexT>> prepareMeshes(size_t count, Convert&& convert, Weight&& weight,
+                                                        const MeshImportSettings& settings,
+                                                        ThreadPool* pool = nullptr)
+{
+    PROFILE_SCOPE("prepareMeshes", "load");
+    std::vector<PreparedMesh<VertexT>> meshes(count);
+    std::vector<size_t> order(count);
+    std::iota(order.begin(), order.end(), (size_t)0);
+    if (pool) {
+        std::vector<size_t> weights(count);
+        for (size_t i = 0; i < count; i++) weights[i] = weight(i);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return weights[a] > weights[b]; });
+    }
+
+    std::atomic<size_t> next{0};
+    auto job = [&](int) {
+        while (true) {
+            const size_t n = next.fetch_add(1);
+            if (n >= count) break;
+            PreparedMesh<VertexT>& mesh = meshes[order[n]];
+            convert(order[n], mesh);
+            mesh.lods = prepareMesh(mesh.vertices, mesh.indices, settings);
+        }
+    };
+    if (pool && count > 1) pool->run(std::ref(job));
+    else job(0);
+    return meshes;
+}
+
+#endif
@@ -0,0 +1,232 @@
+#ifndef MESH_SIMPLIFY_H
+#define MESH_SIMPLIFY_H
+
+#include <glm/glm.hpp>
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+// Quadric error metric simplification (Garland & Heckbert) for the LOD
+// chains Model builds at import. Works on plain positions + indices so it
+// doesn't care where the mesh came from (assimp, BenchScenes, a test).
+//
+// It only does half edge collapses, a vertex moves onto one of its
+// neighbours, so every level indexes the original vertex buffer and a Mesh
+// can keep all of them in one EBO (Mesh::addLod). Vertices on an open edge
+// never move, which also keeps UV seams (split vertices, open edges in
+// index space) and outlines intact.
+
+struct LodChainSettings {
+    int maxLevels = 4;         // coarser levels on top of the full mesh
+    float ratio = 0.5f;        // each level keeps about this share of the previous one's triangles
+    size_t minTriangles = 64;  // stop below this many
+};
+
+struct LodLevelData {
+    std::vector<unsigned int> indices;
+    float error; // object space, sqrt of the worst quadric error a collapse into this level cost
+};
+
+// Symmetric 4x4, a^T Q a for a = (x, y, z, 1) is the summed squared distance
+// to every plane added
+struct Quadric {
+    double m[10] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0}; // xx xy xz xw yy yz yw zz zw ww
+
+    void addPlane(const glm::dvec3& n, double d)
+    {
+        m[0] += n.x * n.x; m[1] += n.x * n.y; m[2] += n.x * n.z; m[3] += n.x * d;
+        m[4] += n.y * n.y; m[5] += n.y * n.z; m[6] += n.y * d;
+        m[7] += n.z * n.z; m[8] += n.z * d;
+        m[9] += d * d;
+    }
+    void add(const Quadric& q)
+    {
+        for (int i = 0; i < 10; i++) m[i] += q.m[i];
+    }
+    double error(const glm::vec3& p) const
+    {
+        const double x = p.x, y = p.y, z = p.z;
+        return m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z + 2 * m[3] * x +
+               m[4] * y * y + 2 * m[5] * y * z + 2 * m[6] * y +
+               m[7] * z * z + 2 * m[8] * z + m[9];
+    }
+};
+
+// Collapses edges cheapest first and snapshots the triangle list each time
+// it's down to ratio of the last level. Levels come out coarsest last, each
+// with its accumulated error. Fewer than maxLevels if the mesh runs out of
+// collapses (everything left is on an open edge or would flip a triangle).
+inline std::vector<LodLevelData> buildLodChain(const std::vector<glm::vec3>& positions,
+                                               const std::vector<unsigned int>& indices,
+                                               const LodChainSettings& settings = LodChainSettings())
+{
+    PROFILE_SCOPE("buildLodChain", "load");
+    std::vector<LodLevelData> levels;
+    const size_t vertexCount = positions.size();
+    const size_t triangleCount = indices.size() / 3;
+    if (settings.maxLevels <= 0 || triangleCount <= settings.minTriangles) return levels;
+
+    std::vector<uint32_t> tris(indices.begin(), indices.begin() + triangleCount * 3);
+    std::vector<uint8_t> triangleAlive(triangleCount, 1);
+
+    // per vertex plane quadrics and incident triangles
+    std::vector<Quadric> quadrics(vertexCount);
+    std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+    for (uint32_t t = 0; t < triangleCount; t++) {
+        const glm::dvec3 a(positions[tris[3 * t]]), b(positions[tris[3 * t + 1]]), c(positions[tris[3 * t + 2]]);
+        glm::dvec3 n = glm::cross(b - a, c - a);
+        const double length = glm::length(n);
+        for (int k = 0; k < 3; k++) vertexTriangles[tris[3 * t + k]].push_back(t);
+        if (length <= 0.0) continue; // degenerate, no plane to keep
+        n /= length;
+        Quadric q;
+        q.addPlane(n, -glm::dot(n, a));
+        for (int k = 0; k < 3; k++) quadrics[tris[3 * t + k]].add(q);
+    }
+
+    // open (one triangle) or non-manifold (3+) edges pin both their vertices
+    std::vector<uint8_t> locked(vertexCount, 0);
+    {
+        std::unordered_map<uint64_t, uint32_t> edgeUses;
+        edgeUses.reserve(triangleCount * 3);
+        for (size_t t = 0; t < triangleCount; t++) {
+            for (int k = 0; k < 3; k++) {
+                uint32_t a = tris[3 * t + k], b = tris[3 * t + (k + 1) % 3];
+                if (a > b) std::swap(a, b);
+                edgeUses[((uint64_t)a << 32) | b]++;
+            }
+        }
+        for (const auto& edge : edgeUses) {
+            if (edge.second == 2) continue;
+            locked[edge.first >> 32] = 1;
+            locked[edge.first & 0xffffffffu] = 1;
+        }
+    }
+
+    struct Collapse {
+        double cost;
+        uint32_t from, to;
+        uint32_t fromVersion, toVersion;
+        bool operator<(const Collapse& other) const { return cost > other.cost; } // min heap
+    };
+    std::priority_queue<Collapse> queue;
+    std::vector<uint32_t> version(vertexCount, 0);
+    std::vector<uint8_t> vertexAlive(vertexCount, 1);
+
+    auto push = [&](uint32_t from, uint32_t to) {
+        if (locked[from] || from == to) return;
+        Quadric q = quadrics[from];
+        q.add(quadrics[to]);
+        queue.push({std::max(0.0, q.error(positions[to])), from, to, version[from], version[to]});
+    };
+    auto pushEdgesOf = [&](uint32_t v) {
+        for (uint32_t t : vertexTriangles[v]) {
+            if (!triangleAlive[t]) continue;
+            for (int k = 0; k < 3; k++) push(v, tris[3 * t + k]);
+        }
+    };
+    for (uint32_t v = 0; v < vertexCount; v++) pushEdgesOf(v);
+
+    // no triangle around from may turn over when from moves onto to
+    auto flips = [&](uint32_t from, uint32_t to) {
+        for (uint32_t t : vertexTriangles[from]) {
+            if (!triangleAlive[t]) continue;
+            const uint32_t* tri = &tris[3 * t];
+            if (tri[0] == to || tri[1] == to || tri[2] == to) continue; // collapses away
+            glm::vec3 p[3], q[3];
+            for (int k = 0; k < 3; k++) {
+                p[k] = positions[tri[k]];
+                q[k] = tri[k] == from ? positions[to] : p[k];
+            }
+            const glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+            const glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+            if (glm::dot(before, after) <= 0.0f) return true;
+        }
+        return false;
+    };
+
+    size_t alive = triangleCount;
+    size_t target = std::max(settings.minTriangles, (size_t)(triangleCount * settings.ratio));
+    double worstCost = 0.0;
+    while ((int)levels.size() < settings.maxLevels && !queue.empty()) {
+        const Collapse c = queue.top();
+        queue.pop();
+        if (!vertexAlive[c.from] || !vertexAlive[c.to] || version[c.from] != c.fromVersion ||
+            version[c.to] != c.toVersion)
+            continue; // stale
+        if (flips(c.from, c.to)) continue;
+
+        // from's triangles move to to, the ones on the edge disappear
+        worstCost = std::max(worstCost, c.cost);
+        quadrics[c.to].add(quadrics[c.from]);
+        for (uint32_t t : vertexTriangles[c.from]) {
+            if (!triangleAlive[t]) continue;
+            uint32_t* tri = &tris[3 * t];
+            if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) {
+                triangleAlive[t] = 0;
+                alive--;
+                continue;
+            }
+            for (int k = 0; k < 3; k++)
+                if (tri[k] == c.from) tri[k] = c.to;
+            vertexTriangles[c.to].push_back(t);
+        }
+        vertexTriangles[c.from].clear();
+        vertexAlive[c.from] = 0;
+        version[c.from]++;
+        version[c.to]++;
+
+        // to's quadric grew: its own collapses and everything collapsing into it
+        pushEdgesOf(c.to);
+        for (uint32_t t : vertexTriangles[c.to]) {
+            if (!triangleAlive[t]) continue;
+            for (int k = 0; k < 3; k++) push(tris[3 * t + k], c.to);
+        }
+
+        if (alive <= target) {
+            LodLevelData level;
+            level.indices.reserve(alive * 3);
+            for (size_t t = 0; t < triangleCount; t++)
+                if (triangleAlive[t]) level.indices.insert(level.indices.end(), &tris[3 * t], &tris[3 * t] + 3);
+            level.error = (float)std::sqrt(worstCost);
+            levels.push_back(std::move(level));
+            if (alive <= settings.minTriangles) break;
+            target = std::max(settings.minTriangles, (size_t)(alive * settings.ratio));
+        }
+    }
+    return levels;
+}
+
+// Level for a mesh seen from distance away, for callers without a culler
+// (the tracer has no instances, it takes one level per addMesh): the
+// coarsest whose error stays under pixelError pixels, same rule as
+// FrustumCuller. pixelsAtOne = viewport height / (2 tan(fovY / 2)).
+// 0 = the full mesh, l = chain[l - 1].
+inline size_t lodForDistance(const std::vector<LodLevelData>& chain, float distance, float pixelsAtOne,
+                             float pixelError = 1.0f)
+{
+    if (distance <= 0.0f) return 0;
+    size_t lod = 0;
+    for (size_t l = 0; l < chain.size(); l++) {
+        if (chain[l].error * pixelsAtOne / distance > pixelError) break;
+        lod = l + 1;
+    }
+    return lod;
+}
+
+// Just the positions, what buildLodChain wants out of a vertex array
+template <typename VertexT>
+inline std::vector<glm::vec3> vertexPositions(const std::vector<VertexT>& vertices)
+{
+    std::vector<glm::vec3> positions(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) positions[i] = vertices[i].Position;
+    return positions;
+}
+
+#endif
@@ -1,6 +1,13 @@
 #ifndef METAL_RENDERER_H
 #define METAL_RENDERER_H
 
+#include "GPUScene.h"
+#include "Random.h"
+#include "RenderStats.h"
+
+#include <string>
+#include <vector>
+
 class Camera; // foward declaration of Camera
 
 #ifdef __OBJC__
@@ -25,6 +32,22 @@ public:
     unsigned int getOpenGLTextureID(); // for opengl flow
     void cleanup();
 
+    // counters from the last render() call (all zero with RT_ENABLE_STATS=0)
+    const RenderStats& getFrameStats() const { return frameStats; }
+    // drawn on top of the image before upload, empty string turns it off
+    void setOverlayText(const std::string& text) { overlayText = text; }
+    // builds the light BVH and uploads it, init() starts with the demo light.
+    // lightSamples = lights sampled per hit, 0 = every light
+    void setLights(const std::vector<Light>& lights, int lightSamples = 4);
+    // Spheres + their BVH into buffers 7-9. First call (or a new sphere
+    // count) uploads everything, later ones only the dirty ranges.
+    // init() starts with Scene::demo(), triangles are ignored
+    void setScene(const Scene& scene);
+    // sampler for pixel jitter and light picks, init() starts with the 4 sample grid
+    void setSampler(SamplerType type, int samplesPerPixel = 4);
+    // keys the sample streams, same as CpuRenderer::setFrameIndex
+    void setFrameIndex(uint32_t frame);
+
 private:
     int width, height;
     unsigned int glTextureID;
@@ -36,8 +59,21 @@ private:
     void *metalTexture;
     // Data Buffers
     void *cameraBuffer;
-    // void *lightBuffer;
-    // void *sphereBuffer;
+    void *statsBuffer;
+    void *lightBuffer;
+    void *lightNodeBuffer;
+    void *lightParamsBuffer;
+    void *samplerParamsBuffer;
+    void *blueNoiseBuffer;
+    void *sphereBuffer;
+    void *materialBuffer;
+    void *nodeBuffer;
+    void *sceneParamsBuffer;
+
+    GPUScene gpuScene;
+
+    RenderStats frameStats;
+    std::string overlayText;
 };
 
 #endif
\ No newline at end of file
@@ -8,19 +8,9 @@
 #import "MetalRenderer.h"
 #import "Camera.h"
 #import "Shared.h"
-
-int MAX_SPHERE = 4;
-
-GPUCamera toGPU(const Camera& cam, int width, int height) {
-    return GPUCamera{
-        {cam.Position.x, cam.Position.y, cam.Position.z, 0.0f},
-        {cam.Front.x, cam.Front.y, cam.Front.z, 0.0f},
-        {cam.Up.x, cam.Up.y, cam.Up.z, 0.0f},
-        {cam.Right.x, cam.Right.y, cam.Right.z, 0.0f},
-        glm::radians(cam.Fov),
-        (float)width/(float)height
-    };
-}
+#import "TextOverlay.h"
+#import "Profiler.h"
+#import "Scene.h"
 
 unsigned int MetalRenderer::getOpenGLTextureID() {
     return glTextureID;
@@ -60,8 +50,11 @@ void MetalRenderer::init(int w, int h) {
     // NSLog(@"\nShader Source Success");
 
     // b) compile shader into library
+    // stats switch is forwarded so the kernel drops its counters too
+    MTLCompileOptions *compileOptions = [MTLCompileOptions new];
+    compileOptions.preprocessorMacros = @{ @"RT_ENABLE_STATS" : @(RT_ENABLE_STATS) };
     id<MTLLibrary> library = [deviceObj newLibraryWithSource:shaderSource
-                            options:nil
+                            options:compileOptions
                             error:&error];
     if(!library) {
         NSLog(@"Library Failed: %@", error);
@@ -109,27 +102,137 @@ void MetalRenderer::init(int w, int h) {
     id<MTLBuffer> cameraBuf = [deviceObj newBufferWithLength:sizeof(GPUCamera)
                                     options:MTLResourceStorageModeShared];
     cameraBuffer = (__bridge void*)cameraBuf;
-    // id<MTLBuffer> lightBuf = [device newBufferWithLength:sizeof(GPULight) * MAX_LIGHTS
-    //                                 options:MTLResourceStorageModeShared];
-    // lightBuffer = (__bridge void*)lightBuf;
-        // id<MTLBuffer> sphereBuf = [device newBufferWithLength:sizeof(GPUSphere) * MAX_SPHERE
-    //                                 options:MTLResourceStorageModeShared];
-    // sphereBuffer = (__bridge void*)sphereBuf;
+    // Always bound, only written when the kernel is built with stats
+    id<MTLBuffer> statsBuf = [deviceObj newBufferWithLength:sizeof(GPUStats)
+                                    options:MTLResourceStorageModeShared];
+    statsBuffer = (__bridge void*)statsBuf;
+    id<MTLBuffer> lightParamsBuf = [deviceObj newBufferWithLength:sizeof(GPULightParams)
+                                    options:MTLResourceStorageModeShared];
+    lightParamsBuffer = (__bridge void*)lightParamsBuf;
+    lightBuffer = nullptr;
+    lightNodeBuffer = nullptr;
+    setLights(Scene::demo().lights);
+
+    id<MTLBuffer> samplerParamsBuf = [deviceObj newBufferWithLength:sizeof(GPUSamplerParams)
+                                    options:MTLResourceStorageModeShared];
+    memset([samplerParamsBuf contents], 0, sizeof(GPUSamplerParams));
+    samplerParamsBuffer = (__bridge void*)samplerParamsBuf;
+    const std::vector<float>& tile = blueNoiseTile();
+    id<MTLBuffer> blueNoiseBuf = [deviceObj newBufferWithBytes:tile.data()
+                                    length:sizeof(float) * tile.size()
+                                    options:MTLResourceStorageModeShared];
+    blueNoiseBuffer = (__bridge void*)blueNoiseBuf;
+    setSampler(SamplerType::Grid);
+
+    id<MTLBuffer> sceneParamsBuf = [deviceObj newBufferWithLength:sizeof(GPUSceneParams)
+                                    options:MTLResourceStorageModeShared];
+    sceneParamsBuffer = (__bridge void*)sceneParamsBuf;
+    sphereBuffer = materialBuffer = nodeBuffer = nullptr;
+    setScene(Scene::demo());
+}
+
+// (Re)allocates when the element count changed, otherwise copies the dirty range in place
+template <typename T>
+static void uploadSceneBuffer(id<MTLDevice> deviceObj, void*& buffer, const std::vector<T>& data,
+                              const DirtyRange& range, bool resized) {
+    if (resized || !buffer) {
+        // Buffers can't be empty, an empty scene still gets one zeroed element
+        size_t bytes = sizeof(T) * std::max<size_t>(1, data.size());
+        id<MTLBuffer> buf = [deviceObj newBufferWithLength:bytes options:MTLResourceStorageModeShared];
+        memset([buf contents], 0, bytes);
+        if (!data.empty()) memcpy([buf contents], data.data(), sizeof(T) * data.size());
+        if (buffer) CFRelease(buffer); // no ARC, same as the light buffers
+        buffer = (__bridge void*)buf;
+        return;
+    }
+    if (range.empty()) return;
+    memcpy((T*)[(__bridge id<MTLBuffer>)buffer contents] + range.begin, data.data() + range.begin,
+           sizeof(T) * (range.end - range.begin));
+}
+
+void MetalRenderer::setScene(const Scene& scene) {
+    PROFILE_SCOPE("MetalRenderer::setScene");
+    id<MTLDevice> deviceObj = (__bridge id<MTLDevice>)device;
+    if (gpuScene.nodes.empty()) gpuScene.build(scene);
+    else gpuScene.update(scene);
+
+    // shared storage, so a dirty range is a memcpy; render() waits for every
+    // frame, nothing is reading these while we write
+    uploadSceneBuffer(deviceObj, sphereBuffer, gpuScene.spheres, gpuScene.sphereDirty, gpuScene.resized);
+    uploadSceneBuffer(deviceObj, materialBuffer, gpuScene.materials, gpuScene.materialDirty,
+                      gpuScene.resized || gpuScene.materialsResized);
+    uploadSceneBuffer(deviceObj, nodeBuffer, gpuScene.nodes, gpuScene.nodeDirty, gpuScene.resized);
+    gpuScene.clearDirty();
+
+    GPUSceneParams params = gpuScene.params();
+    memcpy([(__bridge id<MTLBuffer>)sceneParamsBuffer contents], &params, sizeof(params));
+}
+
+void MetalRenderer::setLights(const std::vector<Light>& lights, int lightSamples) {
+    id<MTLDevice> deviceObj = (__bridge id<MTLDevice>)device;
+    LightBVH lightBVH;
+    lightBVH.build(lights);
+
+    // Buffers can't be empty, keep one zeroed entry around when there are no lights
+    size_t lightBytes = sizeof(GPULight) * std::max<size_t>(1, lightBVH.lights.size());
+    size_t nodeBytes = sizeof(GPULightNode) * std::max<size_t>(1, lightBVH.nodes.size());
+    id<MTLBuffer> lightBuf = [deviceObj newBufferWithLength:lightBytes options:MTLResourceStorageModeShared];
+    id<MTLBuffer> nodeBuf = [deviceObj newBufferWithLength:nodeBytes options:MTLResourceStorageModeShared];
+    memset([lightBuf contents], 0, lightBytes);
+    memset([nodeBuf contents], 0, nodeBytes);
+    if (!lightBVH.lights.empty()) {
+        memcpy([lightBuf contents], lightBVH.lights.data(), sizeof(GPULight) * lightBVH.lights.size());
+        memcpy([nodeBuf contents], lightBVH.nodes.data(), sizeof(GPULightNode) * lightBVH.nodes.size());
+    }
+    // new* hands back owned objects (no ARC here), drop the previous ones
+    if (lightBuffer) CFRelease(lightBuffer);
+    if (lightNodeBuffer) CFRelease(lightNodeBuffer);
+    lightBuffer = (__bridge void*)lightBuf;
+    lightNodeBuffer = (__bridge void*)nodeBuf;
+
+    GPULightParams params = {};
+    params.count = (uint32_t)lightBVH.lights.size();
+    params.samples = lightSamples > 0 ? (uint32_t)lightSamples : params.count;
+    memcpy([(__bridge id<MTLBuffer>)lightParamsBuffer contents], &params, sizeof(params));
+}
+
+void MetalRenderer::setSampler(SamplerType type, int samplesPerPixel) {
+    GPUSamplerParams params = {};
+    params.type = (uint32_t)type;
+    params.samplesPerPixel = (uint32_t)std::max(1, samplesPerPixel);
+    params.frame = ((GPUSamplerParams*)[(__bridge id<MTLBuffer>)samplerParamsBuffer contents])->frame;
+    memcpy([(__bridge id<MTLBuffer>)samplerParamsBuffer contents], &params, sizeof(params));
+}
+
+void MetalRenderer::setFrameIndex(uint32_t frame) {
+    ((GPUSamplerParams*)[(__bridge id<MTLBuffer>)samplerParamsBuffer contents])->frame = frame;
 }
 
 void MetalRenderer::render(const Camera& camera) {
     id<MTLCommandQueue> queue = (__bridge id<MTLCommandQueue>)commandQueue;
     id<MTLComputePipelineState> pipeline = (__bridge id<MTLComputePipelineState>)computePipeline;
     id<MTLTexture> texture = (__bridge id<MTLTexture>)metalTexture;
-    // id<MTLBuffer> sphereBuf = (__bridge id<MTLBuffer>)sphereBuffer;
-    // id<MTLBuffer> lightBuf = (__bridge id<MTLBuffer>)cameraBuffer;
+    id<MTLBuffer> sphereBuf = (__bridge id<MTLBuffer>)sphereBuffer;
+    id<MTLBuffer> materialBuf = (__bridge id<MTLBuffer>)materialBuffer;
+    id<MTLBuffer> nodeBuf = (__bridge id<MTLBuffer>)nodeBuffer;
+    id<MTLBuffer> sceneParamsBuf = (__bridge id<MTLBuffer>)sceneParamsBuffer;
+    id<MTLBuffer> lightBuf = (__bridge id<MTLBuffer>)lightBuffer;
+    id<MTLBuffer> lightNodeBuf = (__bridge id<MTLBuffer>)lightNodeBuffer;
+    id<MTLBuffer> lightParamsBuf = (__bridge id<MTLBuffer>)lightParamsBuffer;
+    id<MTLBuffer> samplerParamsBuf = (__bridge id<MTLBuffer>)samplerParamsBuffer;
+    id<MTLBuffer> blueNoiseBuf = (__bridge id<MTLBuffer>)blueNoiseBuffer;
     id<MTLBuffer> cameraBuf = (__bridge id<MTLBuffer>)cameraBuffer;
+    id<MTLBuffer> statsBuf = (__bridge id<MTLBuffer>)statsBuffer;
 
     GPUCamera gpuCam = toGPU(camera, width, height);
     memcpy([cameraBuf contents], &gpuCam, sizeof(GPUCamera));
+#if RT_ENABLE_STATS
+    memset([statsBuf contents], 0, sizeof(GPUStats));
+#endif
 
     // Step 1: Create command buffer
     id<MTLCommandBuffer> commandBuffer = [queue commandBuffer];
+    uint64_t encodeStart = Profiler::get().nowUs();
     
     // Step 2: Create compute encoder
     id<MTLComputeCommandEncoder> encoder = [commandBuffer computeCommandEncoder];
@@ -139,8 +242,16 @@ void MetalRenderer::render(const Camera& camera) {
     [encoder setTexture:texture atIndex:0]; // bind texture
 
     [encoder setBuffer:cameraBuf offset:0 atIndex:0]; // bind camera
-    // [encoder setBuffer:lightBuffer offset:0 atIndex:2]; // bind light
-    // [encoder setBuffer:sphereBuffer offset:0 atIndex:0]; // bind sphere buffer
+    [encoder setBuffer:statsBuf offset:0 atIndex:1]; // bind counters
+    [encoder setBuffer:lightBuf offset:0 atIndex:2]; // bind lights
+    [encoder setBuffer:lightNodeBuf offset:0 atIndex:3]; // bind light BVH
+    [encoder setBuffer:lightParamsBuf offset:0 atIndex:4]; // bind light count / samples
+    [encoder setBuffer:samplerParamsBuf offset:0 atIndex:5]; // bind sampler type / spp
+    [encoder setBuffer:blueNoiseBuf offset:0 atIndex:6]; // bind blue noise tile
+    [encoder setBuffer:sphereBuf offset:0 atIndex:7]; // bind spheres (BVH leaf order)
+    [encoder setBuffer:materialBuf offset:0 atIndex:8]; // bind materials
+    [encoder setBuffer:nodeBuf offset:0 atIndex:9]; // bind sphere BVH
+    [encoder setBuffer:sceneParamsBuf offset:0 atIndex:10]; // bind sphere / node counts
 
     // Step 4: Dispatch threads
     MTLSize gridSize = MTLSizeMake(width, height, 1);
@@ -150,19 +261,54 @@ void MetalRenderer::render(const Camera& camera) {
     
     // Step 5: End encoding and execute
     [encoder endEncoding]; // ends encoding
-    [commandBuffer commit]; // Executes buffer
+    if (Profiler::get().isRecording())
+        Profiler::get().record("encode", "frame", encodeStart, Profiler::get().nowUs());
+    {
+        PROFILE_SCOPE("commit");
+        [commandBuffer commit]; // Executes buffer
+    }
     
     // Step 6: Wait for completion
-    [commandBuffer waitUntilCompleted];
+    {
+        PROFILE_SCOPE("waitUntilCompleted");
+        [commandBuffer waitUntilCompleted];
+    }
     
+#if RT_ENABLE_STATS
+    // Counters are summed on the GPU, read back once per frame
+    const GPUStats* gpuStats = (const GPUStats*)[statsBuf contents];
+    frameStats = RenderStats();
+    frameStats.primaryRays       = statTotal(*gpuStats, STAT_PRIMARY_RAYS);
+    frameStats.shadowRays        = statTotal(*gpuStats, STAT_SHADOW_RAYS);
+    frameStats.reflectionRays    = statTotal(*gpuStats, STAT_REFLECTION_RAYS);
+    frameStats.primitiveTests    = statTotal(*gpuStats, STAT_PRIMITIVE_TESTS);
+    frameStats.shadowEarlyOuts   = statTotal(*gpuStats, STAT_SHADOW_EARLY_OUTS);
+    frameStats.throughputCutoffs = statTotal(*gpuStats, STAT_THROUGHPUT_CUTOFFS);
+    frameStats.samples           = statTotal(*gpuStats, STAT_SAMPLES);
+    frameStats.occluderCacheLookups = statTotal(*gpuStats, STAT_OCCLUDER_CACHE_LOOKUPS);
+    frameStats.occluderCacheHits    = statTotal(*gpuStats, STAT_OCCLUDER_CACHE_HITS);
+    frameStats.nodesVisited         = statTotal(*gpuStats, STAT_NODES_VISITED);
+    frameStats.pixels            = (uint64_t)width * height;
+#endif
+
     // Step 7: Copy to OpenGL texture
     std::vector<uint8_t> pixelData(width * height * 4);  // RGBA = 4 bytes per pixel
-    [texture getBytes:pixelData.data()
-            bytesPerRow:width * 4
-            fromRegion:MTLRegionMake2D(0, 0, width, height)
-            mipmapLevel:0];
+    {
+        PROFILE_SCOPE("getBytes");
+        [texture getBytes:pixelData.data()
+                bytesPerRow:width * 4
+                fromRegion:MTLRegionMake2D(0, 0, width, height)
+                mipmapLevel:0];
+    }
+    if (!overlayText.empty()) {
+        PROFILE_SCOPE("overlay");
+        TextOverlay::drawText(pixelData.data(), width, height, 8, 8, overlayText);
+    }
     // Bind data to openGL Texture
-    glBindTexture(GL_TEXTURE_2D, glTextureID);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height,
-                    GL_RGBA, GL_UNSIGNED_BYTE, pixelData.data());
+    {
+        PROFILE_SCOPE("glTexSubImage2D");
+        glBindTexture(GL_TEXTURE_2D, glTextureID);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height,
+                        GL_RGBA, GL_UNSIGNED_BYTE, pixelData.data());
+    }
 }
\ No newline at end of file
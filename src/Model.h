@@ -7,9 +7,16 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
+#include "Camera.h"
 #include "Shader.h"
 #include "Mesh.h"
+#include "DrawList.h"
+#include "FrustumCuller.h"
+#include "MeshBatch.h"
+#include "MeshOptimize.h"
+#include "Profiler.h"
 
 #include <string>
 #include <vector>
@@ -25,22 +32,66 @@ public:
     std::string directory;
     std::vector<Texture> textures_loaded;
     bool gammaCorrection;
+    // what every mesh goes through at import: weld, reorder, LOD chain
+    MeshImportSettings importSettings;
 
-    // constructor, expects a file path to a 3D model
-    Model (std::string const &path, bool gamma =false) : gammaCorrection(gamma)
+    // constructor, expects a file path to a 3D model. pool converts the meshes
+    // in parallel (GL objects still get made on this thread), nullptr = all here
+    Model (std::string const &path, bool gamma =false, const MeshImportSettings &import = MeshImportSettings(),
+           ThreadPool *pool = nullptr)
+        : gammaCorrection(gamma), importSettings(import)
     {
-        loadModel(path);
+        loadModel(path, pool);
+        // sorted once here, so drawing binds each material once and allocates nothing
+        drawList.reserve(meshes.size());
+        for(Mesh &mesh : meshes)
+            drawList.add(mesh);
+        drawList.sort();
+        culler.build(drawList);
     }
+    // the draw list points into meshes
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+
     // draws the model and all its meshes
     void Draw(Shader &shader)
     {
-        for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+        drawList.submit(shader);
+    }
+
+    // only the meshes inside the camera's frustum, each at the LOD its size
+    // on screen calls for. Same projection as FrameUniforms::update.
+    void Draw(Shader &shader, const Camera &camera, float aspect, int viewportHeight, ThreadPool *pool = nullptr)
+    {
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Fov), aspect, 0.1f, 100.0f);
+        culler.cull(camera.GetViewMatrix(), projection, glm::radians(camera.Fov), viewportHeight, pool);
+        drawList.submit(shader, culler.getLods());
+    }
+    // visible meshes, drawn triangles and cull time of the last culled Draw
+    const CullStats& getCullStats() const { return culler.getStats(); }
+
+    // packs every mesh into shared buffers + a texture array (MeshBatch.h),
+    // for DrawBatched with the BATCHED variant of the shader
+    bool BuildBatch(int layerSize = 512)
+    {
+        batch.layerSize = layerSize;
+        for(const Mesh &mesh : meshes)
+            batch.add(mesh);
+        return batch.build();
+    }
+    void DrawBatched(Shader &shader)
+    {
+        batch.draw(shader);
     }
 private:
+    DrawList drawList;
+    FrustumCuller culler;
+    MeshBatch batch;
+
     // loads a model with ASSIMP extensions and stores meshes in mesh vector
-    void loadModel(std::string const &path) 
+    void loadModel(std::string const &path, ThreadPool *pool)
     {
+        PROFILE_SCOPE("Model::loadModel", "load");
         // read file via ASSIMP
         Assimp::Importer import;
         const aiScene *scene = import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
@@ -55,37 +106,50 @@ private:
         }
         // Gets the directory path of the filepath
         directory = path.substr(0, path.find_last_of('/'));
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        // walk ASSIMP's nodes recursively for the meshes, in the order they get drawn
+        std::vector<const aiMesh*> order;
+        processNode(scene->mRootNode, scene, order);
+
+        // vertices, indices, weld, reorder and LOD chains for every mesh, on the
+        // pool. Only reads the aiScene, every mesh comes back in its own slot.
+        std::vector<PreparedMesh<Vertex>> prepared = prepareMeshes<Vertex>(
+            order.size(),
+            [&](size_t i, PreparedMesh<Vertex> &mesh) { convertMesh(order[i], mesh.vertices, mesh.indices); },
+            [&](size_t i) { return (size_t)order[i]->mNumFaces; },
+            importSettings, pool);
+
+        // textures and buffers are GL, so they stay on the context thread
+        meshes.reserve(order.size());
+        for(size_t i = 0; i < order.size(); i++)
+            meshes.push_back(processMesh(order[i], prepared[i], scene));
     }
 
-    void processNode(aiNode *node, const aiScene *scene) 
+    void processNode(aiNode *node, const aiScene *scene, std::vector<const aiMesh*> &order)
     {
         // process all the node's meshes (if any)
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
         {
             // the node object only contains indices to index the actual object in the scene
             // the scene contains all the data, node is just to keep stuff organized
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            order.push_back(scene->mMeshes[node->mMeshes[i]]);
         }
         // then do the same for each of its children
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene); // recursively process
+            processNode(node->mChildren[i], scene, order); // recursively process
         }
     }
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene) 
+    // assimp's vertices and faces in engine format. Runs on any thread, so it
+    // touches nothing but the mesh and what it fills.
+    static void convertMesh(const aiMesh *mesh, std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
     {
-        // data to fill
-        std::vector<Vertex> vertices;
-        std::vector<unsigned int> indices;
-        std::vector<Texture> textures;
+        vertices.reserve(mesh->mNumVertices);
+        indices.reserve((size_t)mesh->mNumFaces * 3);
 
         // walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
-            Vertex vertex;
+            Vertex vertex = {}; // zeroed, welding compares every byte
             glm::vec3 vector; // we declare a placeholder vector since assimp uses its own
             // vector class that doesn't directly convert to glm's vec3 class so we transfer
             // the data to placeholder glm::vec3 first
@@ -134,11 +198,17 @@ private:
         // now walk through each of the mesh's faces(its triangles) and get correspond vertex indices
         for(unsigned int i = 0; i < mesh->mNumFaces; i++)
         {
-            aiFace face = mesh->mFaces[i];
+            const aiFace &face = mesh->mFaces[i];
             // retrieve all indices of the face and store them in indices vertex
             for(unsigned int j = 0; j < face.mNumIndices; j++)
                 indices.push_back(face.mIndices[j]);
         }
+    }
+    // the GL half: material textures, then the Mesh over the prepared data
+    Mesh processMesh(const aiMesh *mesh, PreparedMesh<Vertex> &prepared, const aiScene *scene)
+    {
+        std::vector<Texture> textures;
+
         // process materials
         aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
 
@@ -159,8 +229,13 @@ private:
                                                             "texture_height");
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        // return a mesh object created from the extracted mesh data: welded,
+        // cache + fetch ordered, with its coarser levels over the same vertices
+        // (MeshOptimize.h, MeshSimplify.h)
+        Mesh result(std::move(prepared.vertices), std::move(prepared.indices), std::move(textures));
+        for(const LodLevelData &level : prepared.lods)
+            result.addLod(level.indices, level.error);
+        return result;
     }
     // checks all material textures of a given type and loads the textures if not alr loaded.
     // the required info is returned as a Texture struct
@@ -201,6 +276,7 @@ private:
 };
 unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamma)
 {
+    PROFILE_SCOPE("TextureFromFile", "load");
     std::string filename = std::string(path);
     filename = directory + '/' + filename;
 
@@ -0,0 +1,89 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+// Hardware cache reference/miss counters for the calling thread around a
+// block of code. Linux only (perf_event_open); everywhere else, or when the
+// kernel won't hand out the counters (containers, perf_event_paranoid),
+// available() is false and the reads stay 0.
+class CacheMissCounter {
+public:
+    CacheMissCounter()
+    {
+#ifdef __linux__
+        refsFd = open(PERF_COUNT_HW_CACHE_REFERENCES, -1);
+        if (refsFd >= 0) missesFd = open(PERF_COUNT_HW_CACHE_MISSES, refsFd);
+        if (missesFd < 0) close();
+#endif
+    }
+    ~CacheMissCounter() { close(); }
+
+    CacheMissCounter(const CacheMissCounter&) = delete;
+    CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+    bool available() const { return refsFd >= 0 && missesFd >= 0; }
+
+    void start()
+    {
+#ifdef __linux__
+        if (!available()) return;
+        ioctl(refsFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(refsFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    void stop()
+    {
+#ifdef __linux__
+        if (!available()) return;
+        ioctl(refsFd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        uint64_t value = 0;
+        if (::read(refsFd, &value, sizeof(value)) == sizeof(value)) references = value;
+        if (::read(missesFd, &value, sizeof(value)) == sizeof(value)) misses = value;
+#endif
+    }
+
+    uint64_t references = 0;
+    uint64_t misses = 0;
+
+    double missRate() const { return references ? (double)misses / (double)references : 0.0; }
+
+private:
+    int refsFd = -1;
+    int missesFd = -1;
+
+#ifdef __linux__
+    static int open(uint64_t config, int groupFd)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = config;
+        attr.disabled = groupFd < 0 ? 1 : 0; // the group leader starts everything
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return (int)syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+    }
+#endif
+
+    void close()
+    {
+#ifdef __linux__
+        if (missesFd >= 0) ::close(missesFd);
+        if (refsFd >= 0) ::close(refsFd);
+#endif
+        missesFd = refsFd = -1;
+    }
+};
+
+#endif
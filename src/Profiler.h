@@ -0,0 +1,166 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Scoped timing markers written as a Chrome trace-event JSON file
+// (open in chrome://tracing or ui.perfetto.dev).
+//
+//   Profiler::get().configure("trace.json", 100, 200); // frames [100, 200)
+//   Profiler::get().beginFrame(frame);                 // once per frame, main thread
+//   { PROFILE_SCOPE("render"); ... }                   // any thread
+//
+// Outside the frame range a scope costs one relaxed atomic load.
+class Profiler {
+public:
+    static Profiler& get() {
+        static Profiler instance;
+        return instance;
+    }
+
+    void configure(const std::string& path, uint64_t first, uint64_t last) {
+        outPath = path;
+        firstFrame = first;
+        lastFrame = last;
+        enabled = true;
+    }
+
+    // Turns recording on/off based on the frame range, writes the file once
+    // the range has been captured
+    void beginFrame(uint64_t frame) {
+        if (!enabled) return;
+        if (frame == firstFrame) recording.store(true, std::memory_order_relaxed);
+        if (frame == lastFrame) {
+            recording.store(false, std::memory_order_relaxed);
+            write();
+            enabled = false;
+        }
+    }
+
+    // Flushes whatever was captured (e.g. window closed before lastFrame)
+    void finish() {
+        if (!enabled) return;
+        recording.store(false, std::memory_order_relaxed);
+        write();
+        enabled = false;
+    }
+
+    bool isRecording() const { return recording.load(std::memory_order_relaxed); }
+
+    // Shows up as the thread's row label in the viewer
+    void setThreadName(const std::string& name) {
+        ThreadBuffer& buf = threadBuffer();
+        std::lock_guard<std::mutex> lock(buf.mutex);
+        buf.name = name;
+    }
+
+    uint64_t nowUs() const {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    void record(const char* name, const char* category, uint64_t startUs, uint64_t endUs) {
+        ThreadBuffer& buf = threadBuffer();
+        std::lock_guard<std::mutex> lock(buf.mutex); // only contended while writing the file
+        buf.events.push_back({name, category, startUs, endUs - startUs});
+    }
+
+private:
+    struct Event {
+        const char* name;     // string literals only, stored by pointer
+        const char* category;
+        uint64_t startUs;
+        uint64_t durUs;
+    };
+    struct ThreadBuffer {
+        std::mutex mutex;
+        std::vector<Event> events;
+        std::string name;
+        uint32_t tid = 0;
+    };
+
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    std::atomic<bool> recording{false};
+    bool enabled = false;
+    std::string outPath;
+    uint64_t firstFrame = 0, lastFrame = 0;
+
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+    // Each thread appends to its own buffer, registered on first use
+    ThreadBuffer& threadBuffer() {
+        thread_local ThreadBuffer* local = nullptr;
+        if (!local) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            buffers.push_back(std::make_unique<ThreadBuffer>());
+            local = buffers.back().get();
+            local->tid = (uint32_t)buffers.size();
+            local->name = local->tid == 1 ? "main" : "worker " + std::to_string(local->tid - 1);
+        }
+        return *local;
+    }
+
+    void write() {
+        std::ofstream out(outPath);
+        if (!out) {
+            std::cout << "ERROR::PROFILER::COULD_NOT_OPEN " << outPath << std::endl;
+            return;
+        }
+        size_t count = 0;
+        out << "{\"traceEvents\":[\n";
+        bool first = true;
+        std::lock_guard<std::mutex> registryLock(registryMutex);
+        for (auto& buf : buffers) {
+            std::lock_guard<std::mutex> lock(buf->mutex);
+            out << (first ? "" : ",\n")
+                << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buf->tid
+                << ",\"args\":{\"name\":\"" << buf->name << "\"}}";
+            first = false;
+            for (const Event& e : buf->events) {
+                out << ",\n{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category
+                    << "\",\"ph\":\"X\",\"ts\":" << e.startUs << ",\"dur\":" << e.durUs
+                    << ",\"pid\":1,\"tid\":" << buf->tid << "}";
+            }
+            count += buf->events.size();
+            buf->events.clear();
+        }
+        out << "\n]}\n";
+        std::cout << "Wrote " << count << " trace events to " << outPath << std::endl;
+    }
+};
+
+class ProfileScope {
+public:
+    ProfileScope(const char* name, const char* category = "frame")
+        : name(name), category(category) {
+        active = Profiler::get().isRecording();
+        if (active) start = Profiler::get().nowUs();
+    }
+    ~ProfileScope() {
+        if (active) Profiler::get().record(name, category, start, Profiler::get().nowUs());
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name;
+    const char* category;
+    uint64_t start = 0;
+    bool active;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(...) ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(__VA_ARGS__)
+
+#endif
@@ -0,0 +1,234 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Stateless samplers, same functions are mirrored in rayTracer.metal.
+// Every number is a function of (pixel, sample, frame, bounce, dimension)
+// only, so the result doesn't depend on which thread or tile order rendered
+// the pixel.
+
+// PCG-style integer hash
+inline uint32_t pcgHash(uint32_t v)
+{
+    uint32_t state = v * 747796405u + 2891336453u;
+    uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+// Where the per-sample numbers (pixel jitter, light picks, roulette) come from
+enum class SamplerType : uint32_t {
+    Grid = 0,  // fixed sqrt(n) x sqrt(n) pixel offsets, hashed random for everything else
+    Random,    // hashed random everywhere
+    Sobol,     // Owen-scrambled Sobol, shuffled per pixel
+    BlueNoise  // 64x64 blue noise tile, stepped along the R2 sequence per sample
+};
+
+inline const char* samplerTypeName(SamplerType type) {
+    switch (type) {
+        case SamplerType::Random:    return "random";
+        case SamplerType::Sobol:     return "sobol";
+        case SamplerType::BlueNoise: return "bluenoise";
+        default:                     return "grid";
+    }
+}
+
+inline bool parseSamplerType(const std::string& name, SamplerType& type) {
+    if (name == "grid")           type = SamplerType::Grid;
+    else if (name == "random")    type = SamplerType::Random;
+    else if (name == "sobol")     type = SamplerType::Sobol;
+    else if (name == "bluenoise") type = SamplerType::BlueNoise;
+    else return false;
+    return true;
+}
+
+// ============ Sobol ============
+// Generator matrices for the first 4 dimensions (Joe & Kuo direction
+// numbers). Higher dimensions reuse them with a different shuffle per
+// 4D chunk, like Burley's "Practical Hash-based Owen Scrambling".
+static const uint32_t SOBOL_MATRICES[4][32] = {
+    {0x80000000u, 0x40000000u, 0x20000000u, 0x10000000u, 0x08000000u, 0x04000000u, 0x02000000u, 0x01000000u,
+     0x00800000u, 0x00400000u, 0x00200000u, 0x00100000u, 0x00080000u, 0x00040000u, 0x00020000u, 0x00010000u,
+     0x00008000u, 0x00004000u, 0x00002000u, 0x00001000u, 0x00000800u, 0x00000400u, 0x00000200u, 0x00000100u,
+     0x00000080u, 0x00000040u, 0x00000020u, 0x00000010u, 0x00000008u, 0x00000004u, 0x00000002u, 0x00000001u},
+    {0x80000000u, 0xc0000000u, 0xa0000000u, 0xf0000000u, 0x88000000u, 0xcc000000u, 0xaa000000u, 0xff000000u,
+     0x80800000u, 0xc0c00000u, 0xa0a00000u, 0xf0f00000u, 0x88880000u, 0xcccc0000u, 0xaaaa0000u, 0xffff0000u,
+     0x80008000u, 0xc000c000u, 0xa000a000u, 0xf000f000u, 0x88008800u, 0xcc00cc00u, 0xaa00aa00u, 0xff00ff00u,
+     0x80808080u, 0xc0c0c0c0u, 0xa0a0a0a0u, 0xf0f0f0f0u, 0x88888888u, 0xccccccccu, 0xaaaaaaaau, 0xffffffffu},
+    {0x80000000u, 0xc0000000u, 0x60000000u, 0x90000000u, 0xe8000000u, 0x5c000000u, 0x8e000000u, 0xc5000000u,
+     0x68800000u, 0x9cc00000u, 0xee600000u, 0x55900000u, 0x80680000u, 0xc09c0000u, 0x60ee0000u, 0x90550000u,
+     0xe8808000u, 0x5cc0c000u, 0x8e606000u, 0xc5909000u, 0x6868e800u, 0x9c9c5c00u, 0xeeee8e00u, 0x5555c500u,
+     0x8000e880u, 0xc0005cc0u, 0x60008e60u, 0x9000c590u, 0xe8006868u, 0x5c009c9cu, 0x8e00eeeeu, 0xc5005555u},
+    {0x80000000u, 0xc0000000u, 0x20000000u, 0x50000000u, 0xf8000000u, 0x74000000u, 0xa2000000u, 0x93000000u,
+     0xd8800000u, 0x25400000u, 0x59e00000u, 0xe6d00000u, 0x78080000u, 0xb40c0000u, 0x82020000u, 0xc3050000u,
+     0x208f8000u, 0x51474000u, 0xfbea2000u, 0x75d93000u, 0xa0858800u, 0x914e5400u, 0xdbe79e00u, 0x25db6d00u,
+     0x58800080u, 0xe54000c0u, 0x79e00020u, 0xb6d00050u, 0x800800f8u, 0xc00c0074u, 0x200200a2u, 0x50050093u}
+};
+
+// The matrix product a byte of the index at a time out of tables, the
+// shuffled indices are random 32 bit numbers so a loop over the set bits
+// would mispredict half the time. The kernel just loops.
+inline uint32_t sobol(uint32_t index, uint32_t dimension)
+{
+    static const std::vector<uint32_t> tables = [] {
+        std::vector<uint32_t> t(4 * 4 * 256, 0u);
+        for (int d = 0; d < 4; d++)
+            for (int byte = 0; byte < 4; byte++)
+                for (int v = 0; v < 256; v++)
+                    for (int bit = 0; bit < 8; bit++)
+                        if (v & (1 << bit)) t[(d * 4 + byte) * 256 + v] ^= SOBOL_MATRICES[d][byte * 8 + bit];
+        return t;
+    }();
+    const uint32_t* t = &tables[dimension * 4 * 256];
+    return t[index & 0xffu] ^ t[256 + ((index >> 8) & 0xffu)] ^
+           t[512 + ((index >> 16) & 0xffu)] ^ t[768 + (index >> 24)];
+}
+
+inline uint32_t reverseBits(uint32_t x)
+{
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+    x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+// Hash that only lets bits flow from low to high, reversed around it that's
+// a random nested uniform (Owen) scramble: stratification survives, the
+// structure between pixels doesn't
+inline uint32_t owenScramble(uint32_t x, uint32_t seed)
+{
+    x = reverseBits(x);
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return reverseBits(x);
+}
+
+// [0, 1)
+inline float sobolOwen(uint32_t pixelSeed, uint32_t sample, uint32_t dimension)
+{
+    uint32_t chunkSeed = pcgHash(pixelSeed ^ pcgHash(dimension / 4u));
+    uint32_t index = owenScramble(sample, chunkSeed);
+    uint32_t x = owenScramble(sobol(index, dimension % 4u), pcgHash(chunkSeed + dimension));
+    return (x >> 8) * (1.0f / 16777216.0f);
+}
+
+// ============ Blue noise ============
+// 64x64 tile built once by always filling the emptiest pixel next (the
+// second half of void-and-cluster), the rank of each pixel is its value.
+// Uploaded as is to the kernel.
+static const int BLUE_NOISE_SIZE = 64;
+
+inline const std::vector<float>& blueNoiseTile()
+{
+    static const std::vector<float> tile = [] {
+        const int n = BLUE_NOISE_SIZE, count = n * n, radius = 8;
+        const float sigma2 = 2.0f * 1.9f * 1.9f;
+        std::vector<float> values(count, 0.0f), energy(count, 0.0f);
+        std::vector<bool> filled(count, false);
+        for (int rank = 0; rank < count; rank++) {
+            int best = -1;
+            for (int i = 0; i < count; i++)
+                if (!filled[i] && (best < 0 || energy[i] < energy[best])) best = i;
+            filled[best] = true;
+            values[best] = (rank + 0.5f) / count;
+            const int bx = best % n, by = best / n;
+            for (int dy = -radius; dy <= radius; dy++)
+                for (int dx = -radius; dx <= radius; dx++) {
+                    int x = (bx + dx + n) % n, y = (by + dy + n) % n;
+                    energy[y * n + x] += std::exp(-(float)(dx * dx + dy * dy) / sigma2);
+                }
+        }
+        return values;
+    }();
+    return tile;
+}
+
+// [0, 1). Each dimension (and frame) looks at the tile through its own
+// toroidal shift, each sample steps it along the R2 sequence (the 2D golden
+// ratio, x and y of a pair get different steps) so a pixel's samples stay
+// well spread.
+inline float blueNoise(uint32_t x, uint32_t y, uint32_t sample, uint32_t dimension, uint32_t frame = 0)
+{
+    const uint32_t shift = pcgHash((dimension + 0x68bc21ebu) ^ pcgHash(frame));
+    const uint32_t tx = (x + shift) & (BLUE_NOISE_SIZE - 1);
+    const uint32_t ty = (y + (shift >> 8)) & (BLUE_NOISE_SIZE - 1);
+    const float step = (dimension & 1u) ? 0.569840291f : 0.754877666f;
+    float v = blueNoiseTile()[ty * BLUE_NOISE_SIZE + tx] + (float)sample * step;
+    return std::min(v - std::floor(v), 0.99999994f);
+}
+
+// ============ Per-sample stream ============
+// Counter based: every number is a hash of its full key
+// (pixel, sample, frame, bounce, dimension), nothing carries over from the
+// previous call. Splitting a frame over threads, tiles or machines can't
+// change a single value.
+static const uint32_t DIMS_PER_BOUNCE = 64; // Sobol/blue noise dimensions per bounce, more spill into the next
+
+// pcg4d from Jarzynski & Olano, "Hash Functions for GPU Rendering"
+inline uint32_t pcg4d(uint32_t x, uint32_t y, uint32_t z, uint32_t w)
+{
+    x = x * 1664525u + 1013904223u;
+    y = y * 1664525u + 1013904223u;
+    z = z * 1664525u + 1013904223u;
+    w = w * 1664525u + 1013904223u;
+    x += y * w; y += z * x; z += x * y; w += y * z;
+    x ^= x >> 16; y ^= y >> 16; z ^= z >> 16; w ^= w >> 16;
+    x += y * w; y += z * x; z += x * y; w += y * z;
+    return x ^ w;
+}
+
+struct SampleRng {
+    uint32_t pixel = 0;     // y * width + x
+    uint32_t pixelSeed = 0; // pixel and frame hashed, seeds the Sobol scramble
+    uint32_t x = 0, y = 0;
+    uint32_t sample = 0;
+    uint32_t frame = 0;
+    uint32_t bounce = 0;
+    uint32_t dimension = 0; // next dimension within the bounce
+    SamplerType type = SamplerType::Random;
+
+    SampleRng(uint32_t pixel, uint32_t sample, uint32_t frame = 0)
+        : pixel(pixel), pixelSeed(pcgHash(pixel ^ pcgHash(frame + 0x9e3779b9u))), sample(sample), frame(frame) {}
+
+    // Pixel (x, y) of a width wide image
+    SampleRng(uint32_t x, uint32_t y, uint32_t width, uint32_t sample, SamplerType type, uint32_t frame = 0)
+        : SampleRng(y * width + x, sample, frame)
+    {
+        this->x = x;
+        this->y = y;
+        this->type = type;
+    }
+
+    // Each bounce starts its own dimension range, so how many numbers one
+    // bounce draws (light count, roulette) never shifts the next one's
+    void setBounce(uint32_t newBounce)
+    {
+        if (newBounce == bounce) return;
+        bounce = newBounce;
+        dimension = 0;
+    }
+
+    // [0, 1)
+    float next()
+    {
+        const uint32_t d = dimension++;
+        switch (type) {
+            case SamplerType::Sobol:
+                return sobolOwen(pixelSeed, sample, bounce * DIMS_PER_BOUNCE + d);
+            case SamplerType::BlueNoise:
+                return blueNoise(x, y, sample, bounce * DIMS_PER_BOUNCE + d, frame);
+            default:
+                return (pcg4d(pixel, sample, frame, (bounce << 16) | (d & 0xffffu)) >> 8) * (1.0f / 16777216.0f);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,418 @@
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+#include <glm/glm.hpp>
+
+#include "Profiler.h"
+#include "Scene.h"
+#include "Shared.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Visibility buffer for the hybrid mode: what each camera sample sees first,
+// found by rasterising the scene instead of tracing the camera rays. One
+// layer per sample of a pixel, each layer at its own fixed sub-pixel offset.
+// Only the primitive and where on it get stored, the hit is rebuilt from
+// those when the pixel is shaded (visibilityHit).
+struct VisibilityBuffer {
+    static constexpr uint32_t NO_PRIM = 0xffffffffu; // sky
+
+    int width = 0, height = 0, layers = 0;
+    std::vector<uint32_t> prim;  // Scene primitive index
+    std::vector<float> invDepth; // 1 / view space z, 0 = nothing drawn yet
+    std::vector<float> b1, b2;   // barycentrics of v1 and v2, triangles only
+
+    void resize(int w, int h, int layerCount)
+    {
+        width = w;
+        height = h;
+        layers = layerCount;
+        // 4 floats of slack so the 4-wide loads at the end of a row never run off
+        const size_t count = (size_t)w * h * layerCount + 4;
+        prim.resize(count);
+        invDepth.resize(count);
+        b1.resize(count);
+        b2.resize(count);
+    }
+
+    size_t index(int layer, int x, int y) const { return ((size_t)layer * height + y) * width + x; }
+};
+
+// Multithreaded scanline-free rasteriser for the visibility buffer. Runs in
+// two passes over the thread pool: every worker projects a slice of the
+// primitives into screen space and bins them into 32x32 tiles, then workers
+// pull tiles and test 4 samples at a time with edge functions. Triangles are
+// clipped against a near plane, spheres are impostors: their projected box
+// gets covered and each sample solves the ray-sphere quadratic.
+class Rasterizer {
+public:
+    static constexpr int TILE = 32;
+
+    double setupMs = 0.0;  // last render: projection + binning
+    double rasterMs = 0.0; // last render: tiles
+
+    // offsets[k] is layer k's sub-pixel offset, same meaning as in generateRay.
+    // Only pixels inside [x0, x1) x [y0, y1) get written.
+    void render(const Scene& scene, const GPUCamera& cam, int width, int height,
+                const std::vector<glm::vec2>& offsets, int x0, int y0, int x1, int y1,
+                ThreadPool& pool, VisibilityBuffer& vis)
+    {
+        PROFILE_SCOPE("Rasterizer::render");
+        using Clock = std::chrono::steady_clock;
+        const Clock::time_point start = Clock::now();
+        vis.resize(width, height, (int)offsets.size());
+
+        view.origin = glm::vec3(cam.position);
+        view.right = glm::vec3(cam.right);
+        view.up = glm::vec3(cam.up);
+        view.front = glm::vec3(cam.front);
+        const float scale = std::tan(cam.fov * 0.5f);
+        view.kx = 0.5f * width / (cam.aspectRatio * scale);
+        view.ky = 0.5f * height / scale;
+        view.cx = 0.5f * width;
+        view.cy = 0.5f * height;
+
+        rx0 = x0; ry0 = y0; rx1 = x1; ry1 = y1;
+        tilesX = std::max(0, (x1 - x0 + TILE - 1) / TILE);
+        tilesY = std::max(0, (y1 - y0 + TILE - 1) / TILE);
+        const int tileCount = tilesX * tilesY;
+        const int workerCount = pool.size();
+        workers.resize(workerCount);
+        for (WorkerBins& w : workers) {
+            w.triangles.clear();
+            w.spheres.clear();
+            w.bins.resize(tileCount);
+            for (std::vector<uint32_t>& bin : w.bins) bin.clear();
+        }
+
+        // ============ Setup + binning ============
+        const uint32_t sphereCount = (uint32_t)scene.spheres.size();
+        const uint32_t primCount = scene.primitiveCount();
+        pool.run([&](int worker) {
+            WorkerBins& w = workers[worker];
+            const uint32_t first = (uint32_t)((uint64_t)primCount * worker / workerCount);
+            const uint32_t last = (uint32_t)((uint64_t)primCount * (worker + 1) / workerCount);
+            for (uint32_t prim = first; prim < last; prim++) {
+                if (prim < sphereCount) setupSphere(scene.spheres[prim], prim, w);
+                else setupTriangle(scene.triangles[prim - sphereCount], prim, w);
+            }
+        });
+        const Clock::time_point setupEnd = Clock::now();
+
+        // ============ Tiles ============
+        std::atomic<int> nextTile{0};
+        pool.run([&](int) {
+            for (int tile = nextTile.fetch_add(1); tile < tileCount; tile = nextTile.fetch_add(1))
+                rasterTile(tile, offsets, vis);
+        });
+
+        setupMs = std::chrono::duration<double, std::milli>(setupEnd - start).count();
+        rasterMs = std::chrono::duration<double, std::milli>(Clock::now() - setupEnd).count();
+    }
+
+private:
+    static constexpr float Z_NEAR = 1e-4f;
+    static constexpr uint32_t SPHERE_BIT = 0x80000000u; // bin entries: sphere or triangle list
+
+    // Camera space is (right, up, front), screen x = x / z * kx + cx like generateRay
+    struct View {
+        glm::vec3 origin, right, up, front;
+        float kx, ky, cx, cy;
+
+        glm::vec3 toView(const glm::vec3& p) const
+        {
+            glm::vec3 d = p - origin;
+            return glm::vec3(glm::dot(d, right), glm::dot(d, up), glm::dot(d, front));
+        }
+    };
+
+    // Everything linear in screen space is a plane a * sx + b * sy + c
+    struct Plane {
+        float a, b, c;
+    };
+
+    struct ScreenTriangle {
+        Plane lambda[3];  // screen space barycentrics, all >= 0 inside
+        Plane invZ;       // 1 / z
+        Plane b1z, b2z;   // the original triangle's barycentrics over z
+        float minX, minY, maxX, maxY;
+        uint32_t prim;
+    };
+
+    struct ScreenSphere {
+        glm::vec3 center; // view space
+        float radius2;
+        float minX, minY, maxX, maxY;
+        uint32_t prim;
+    };
+
+    struct WorkerBins {
+        std::vector<ScreenTriangle> triangles;
+        std::vector<ScreenSphere> spheres;
+        std::vector<std::vector<uint32_t>> bins; // per tile, index into triangles | SPHERE_BIT spheres
+    };
+
+    View view;
+    int rx0 = 0, ry0 = 0, rx1 = 0, ry1 = 0;
+    int tilesX = 0, tilesY = 0;
+    std::vector<WorkerBins> workers;
+
+    // Adds the primitive to every tile its screen box can reach. A pixel's
+    // samples sit within half a pixel of its centre, hence the 1 pixel slack.
+    void bin(float minX, float minY, float maxX, float maxY, uint32_t entry, WorkerBins& w) const
+    {
+        // clamped near the region first so far off screen boxes stay inside int range
+        const int px0 = std::max(rx0, (int)std::floor(glm::clamp(minX, rx0 - 2.0f, rx1 + 2.0f) - 1.0f));
+        const int py0 = std::max(ry0, (int)std::floor(glm::clamp(minY, ry0 - 2.0f, ry1 + 2.0f) - 1.0f));
+        const int px1 = std::min(rx1 - 1, (int)std::ceil(glm::clamp(maxX, rx0 - 2.0f, rx1 + 2.0f)));
+        const int py1 = std::min(ry1 - 1, (int)std::ceil(glm::clamp(maxY, ry0 - 2.0f, ry1 + 2.0f)));
+        if (px0 > px1 || py0 > py1) return;
+        for (int ty = (py0 - ry0) / TILE; ty <= (py1 - ry0) / TILE; ty++)
+            for (int tx = (px0 - rx0) / TILE; tx <= (px1 - rx0) / TILE; tx++)
+                w.bins[ty * tilesX + tx].push_back(entry);
+    }
+
+    void setupSphere(const Sphere& sphere, uint32_t prim, WorkerBins& w) const
+    {
+        ScreenSphere s;
+        s.center = view.toView(sphere.center);
+        s.radius2 = sphere.radius * sphere.radius;
+        s.prim = prim;
+        const float r = sphere.radius;
+        if (s.center.z - r <= Z_NEAR) {
+            if (s.center.z + r <= Z_NEAR) return; // all of it behind the camera
+            // reaches past the near plane, could cover anything
+            s.minX = (float)rx0; s.minY = (float)ry0;
+            s.maxX = (float)rx1; s.maxY = (float)ry1;
+        } else {
+            // the projected corners of its view space box enclose the projected sphere
+            s.minX = s.minY = 1e30f;
+            s.maxX = s.maxY = -1e30f;
+            for (int corner = 0; corner < 8; corner++) {
+                glm::vec3 p = s.center + glm::vec3(corner & 1 ? r : -r, corner & 2 ? r : -r, corner & 4 ? r : -r);
+                float sx = p.x / p.z * view.kx + view.cx;
+                float sy = p.y / p.z * view.ky + view.cy;
+                s.minX = std::min(s.minX, sx); s.maxX = std::max(s.maxX, sx);
+                s.minY = std::min(s.minY, sy); s.maxY = std::max(s.maxY, sy);
+            }
+        }
+        w.spheres.push_back(s);
+        bin(s.minX, s.minY, s.maxX, s.maxY, (uint32_t)(w.spheres.size() - 1) | SPHERE_BIT, w);
+    }
+
+    struct ClipVertex {
+        glm::vec3 p;  // view space
+        glm::vec2 b;  // barycentrics of v1, v2 in the original triangle
+    };
+
+    void setupTriangle(const Triangle& tri, uint32_t prim, WorkerBins& w) const
+    {
+        ClipVertex in[3] = {{view.toView(tri.v0), {0.0f, 0.0f}},
+                            {view.toView(tri.v1), {1.0f, 0.0f}},
+                            {view.toView(tri.v2), {0.0f, 1.0f}}};
+        if (in[0].p.z < Z_NEAR && in[1].p.z < Z_NEAR && in[2].p.z < Z_NEAR) return;
+
+        // Clip against z >= Z_NEAR, one plane cuts a triangle into at most 4 vertices
+        ClipVertex poly[4];
+        int count = 0;
+        for (int i = 0; i < 3; i++) {
+            const ClipVertex& a = in[i];
+            const ClipVertex& b = in[(i + 1) % 3];
+            const bool aIn = a.p.z >= Z_NEAR, bIn = b.p.z >= Z_NEAR;
+            if (aIn) poly[count++] = a;
+            if (aIn != bIn) {
+                float t = (Z_NEAR - a.p.z) / (b.p.z - a.p.z);
+                poly[count++] = {glm::mix(a.p, b.p, t), glm::mix(a.b, b.b, t)};
+            }
+        }
+        for (int i = 1; i + 1 < count; i++) addScreenTriangle(poly[0], poly[i], poly[i + 1], prim, w);
+    }
+
+    void addScreenTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, uint32_t prim,
+                           WorkerBins& w) const
+    {
+        const ClipVertex* v[3] = {&v0, &v1, &v2};
+        float sx[3], sy[3], iz[3];
+        for (int i = 0; i < 3; i++) {
+            iz[i] = 1.0f / v[i]->p.z;
+            sx[i] = v[i]->p.x * iz[i] * view.kx + view.cx;
+            sy[i] = v[i]->p.y * iz[i] * view.ky + view.cy;
+        }
+        float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sy[1] - sy[0]) * (sx[2] - sx[0]);
+        if (std::fabs(area) < 1e-12f) return; // edge on
+        if (area < 0.0f) { // two sided, wind everything the same way
+            std::swap(v[1], v[2]);
+            std::swap(sx[1], sx[2]);
+            std::swap(sy[1], sy[2]);
+            std::swap(iz[1], iz[2]);
+            area = -area;
+        }
+
+        ScreenTriangle t;
+        t.minX = std::min(sx[0], std::min(sx[1], sx[2]));
+        t.maxX = std::max(sx[0], std::max(sx[1], sx[2]));
+        t.minY = std::min(sy[0], std::min(sy[1], sy[2]));
+        t.maxY = std::max(sy[0], std::max(sy[1], sy[2]));
+        if (t.maxX < rx0 - 1 || t.minX > rx1 + 1 || t.maxY < ry0 - 1 || t.minY > ry1 + 1) return;
+
+        // lambda_i is the edge function of the edge opposite vertex i over the area
+        const float invArea = 1.0f / area;
+        for (int i = 0; i < 3; i++) {
+            const int a = (i + 1) % 3, b = (i + 2) % 3;
+            t.lambda[i].a = -(sy[b] - sy[a]) * invArea;
+            t.lambda[i].b = (sx[b] - sx[a]) * invArea;
+            t.lambda[i].c = ((sy[b] - sy[a]) * sx[a] - (sx[b] - sx[a]) * sy[a]) * invArea;
+        }
+        // attributes over z interpolate linearly in screen space
+        auto attribute = [&](float f0, float f1, float f2) {
+            Plane p;
+            p.a = f0 * t.lambda[0].a + f1 * t.lambda[1].a + f2 * t.lambda[2].a;
+            p.b = f0 * t.lambda[0].b + f1 * t.lambda[1].b + f2 * t.lambda[2].b;
+            p.c = f0 * t.lambda[0].c + f1 * t.lambda[1].c + f2 * t.lambda[2].c;
+            return p;
+        };
+        t.invZ = attribute(iz[0], iz[1], iz[2]);
+        t.b1z = attribute(v[0]->b.x * iz[0], v[1]->b.x * iz[1], v[2]->b.x * iz[2]);
+        t.b2z = attribute(v[0]->b.y * iz[0], v[1]->b.y * iz[1], v[2]->b.y * iz[2]);
+        t.prim = prim;
+
+        w.triangles.push_back(t);
+        bin(t.minX, t.minY, t.maxX, t.maxY, (uint32_t)(w.triangles.size() - 1), w);
+    }
+
+    // Columns of pixels whose sample (at x + 0.5 + offset) can land inside [lo, hi]
+    static void sampleRange(float lo, float hi, float offset, int clipLo, int clipHi, int& first, int& last)
+    {
+        lo = std::max(lo, clipLo - 1.0f); // keeps far off screen boxes inside int range
+        hi = std::min(hi, clipHi + 1.0f);
+        first = std::max(clipLo, (int)std::ceil(lo - 0.5f - offset));
+        last = std::min(clipHi, (int)std::floor(hi - 0.5f - offset) + 1);
+    }
+
+    // Writes the lanes of mask that are in front of what's there. Equal
+    // depths go to the lower primitive index so the order the bins come in
+    // doesn't matter.
+    static void writeLanes(VisibilityBuffer& vis, size_t base, i32x4 mask, f32x4 iz, f32x4 b1, f32x4 b2,
+                           uint32_t prim)
+    {
+        for (int lane = 0; lane < 4; lane++) {
+            if (!mask[lane]) continue;
+            const size_t i = base + lane;
+            if (iz[lane] == vis.invDepth[i] && prim >= vis.prim[i]) continue;
+            vis.invDepth[i] = iz[lane];
+            vis.prim[i] = prim;
+            vis.b1[i] = b1[lane];
+            vis.b2[i] = b2[lane];
+        }
+    }
+
+    void rasterTile(int tile, const std::vector<glm::vec2>& offsets, VisibilityBuffer& vis) const
+    {
+        const int tx0 = rx0 + (tile % tilesX) * TILE, ty0 = ry0 + (tile / tilesX) * TILE;
+        const int tx1 = std::min(tx0 + TILE, rx1), ty1 = std::min(ty0 + TILE, ry1);
+        for (int layer = 0; layer < vis.layers; layer++)
+            for (int y = ty0; y < ty1; y++) {
+                const size_t row = vis.index(layer, 0, y);
+                std::fill(vis.prim.begin() + row + tx0, vis.prim.begin() + row + tx1, VisibilityBuffer::NO_PRIM);
+                std::fill(vis.invDepth.begin() + row + tx0, vis.invDepth.begin() + row + tx1, 0.0f);
+            }
+
+        const f32x4 laneOffset = {0.0f, 1.0f, 2.0f, 3.0f};
+        for (const WorkerBins& w : workers) {
+            for (uint32_t entry : w.bins[tile]) {
+                for (int layer = 0; layer < vis.layers; layer++) {
+                    const glm::vec2 off = offsets[layer];
+                    if (entry & SPHERE_BIT) {
+                        const ScreenSphere& s = w.spheres[entry & ~SPHERE_BIT];
+                        int xs, xe, ys, ye;
+                        sampleRange(s.minX, s.maxX, off.x, tx0, tx1, xs, xe);
+                        sampleRange(s.minY, s.maxY, off.y, ty0, ty1, ys, ye);
+                        const float c2 = glm::dot(s.center, s.center) - s.radius2;
+                        for (int y = ys; y < ye; y++) {
+                            const float dy = (y + 0.5f + off.y - view.cy) / view.ky;
+                            for (int x = xs; x < xe; x += 4) {
+                                // view space direction with z = 1, so the ray parameter is the depth
+                                const f32x4 dx = (simd::splat(x + 0.5f + off.x - view.cx) + laneOffset) / view.kx;
+                                const f32x4 dd = dx * dx + (dy * dy + 1.0f);
+                                const f32x4 dc = dx * s.center.x + (dy * s.center.y + s.center.z);
+                                const f32x4 disc = dc * dc - dd * c2;
+                                i32x4 mask = (disc >= 0.0f) & (laneOffset < (float)(xe - x));
+                                if (!simd::any(mask)) continue;
+                                const f32x4 root = simd::sqrt(simd::max(disc, simd::splat(0.0f)));
+                                const f32x4 len = simd::sqrt(dd);
+                                const f32x4 t0 = (dc - root) / dd, t1 = (dc + root) / dd;
+                                // same window as the traced camera ray, in distance along it
+                                const i32x4 t0Ok = (t0 * len >= 0.001f) & (t0 * len <= 9999.9f);
+                                const i32x4 t1Ok = (t1 * len >= 0.001f) & (t1 * len <= 9999.9f);
+                                const f32x4 t = simd::select(t0Ok, t0, t1);
+                                mask &= t0Ok | t1Ok;
+                                const f32x4 iz = 1.0f / simd::max(t, simd::splat(1e-30f));
+                                const size_t base = vis.index(layer, x, y);
+                                mask &= iz >= simd::load(&vis.invDepth[base]);
+                                if (!simd::any(mask)) continue;
+                                writeLanes(vis, base, mask, iz, simd::splat(0.0f), simd::splat(0.0f), s.prim);
+                            }
+                        }
+                    } else {
+                        const ScreenTriangle& t = w.triangles[entry];
+                        int xs, xe, ys, ye;
+                        sampleRange(t.minX, t.maxX, off.x, tx0, tx1, xs, xe);
+                        sampleRange(t.minY, t.maxY, off.y, ty0, ty1, ys, ye);
+                        for (int y = ys; y < ye; y++) {
+                            const float sy = y + 0.5f + off.y;
+                            const float r0 = t.lambda[0].b * sy + t.lambda[0].c;
+                            const float r1 = t.lambda[1].b * sy + t.lambda[1].c;
+                            const float r2 = t.lambda[2].b * sy + t.lambda[2].c;
+                            for (int x = xs; x < xe; x += 4) {
+                                const f32x4 sx = simd::splat(x + 0.5f + off.x) + laneOffset;
+                                i32x4 mask = (t.lambda[0].a * sx + r0 >= 0.0f) & (t.lambda[1].a * sx + r1 >= 0.0f) &
+                                             (t.lambda[2].a * sx + r2 >= 0.0f) & (laneOffset < (float)(xe - x));
+                                if (!simd::any(mask)) continue;
+                                const f32x4 iz = t.invZ.a * sx + (t.invZ.b * sy + t.invZ.c);
+                                const size_t base = vis.index(layer, x, y);
+                                mask &= iz >= simd::load(&vis.invDepth[base]);
+                                if (!simd::any(mask)) continue;
+                                const f32x4 b1 = (t.b1z.a * sx + (t.b1z.b * sy + t.b1z.c)) / iz;
+                                const f32x4 b2 = (t.b2z.a * sx + (t.b2z.b * sy + t.b2z.c)) / iz;
+                                writeLanes(vis, base, mask, iz, b1, b2, t.prim);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+};
+
+// Camera hit of a visibility buffer sample, rebuilt for the sample's own ray.
+// Spheres get their quadratic solved again for just that sphere, triangles
+// come straight from the barycentrics. Returns false for the odd sample
+// right on a silhouette where the rebuilt hit doesn't hold up, those get
+// traced instead. A sky sample returns true with hit.hit = false.
+inline bool visibilityHit(const Scene& scene, const VisibilityBuffer& vis, size_t index, const Ray& ray,
+                          float tMin, float tMax, Hit& hit)
+{
+    const uint32_t prim = vis.prim[index];
+    hit = Hit();
+    if (prim == VisibilityBuffer::NO_PRIM) return true;
+    if (prim < scene.spheres.size()) {
+        if (!scene.spheres[prim].intersect(ray, tMin, tMax, hit)) return false;
+    } else {
+        const Triangle& tri = scene.triangles[prim - scene.spheres.size()];
+        const glm::vec3 p = tri.v0 + vis.b1[index] * (tri.v1 - tri.v0) + vis.b2[index] * (tri.v2 - tri.v0);
+        const float t = glm::dot(p - ray.origin, ray.direction);
+        if (t < tMin || t > tMax) return false;
+        tri.fillHit(ray, t, hit);
+    }
+    hit.primID = (int)prim;
+    return true;
+}
+
+#endif
@@ -0,0 +1,220 @@
+#ifndef RENDER_BACKEND_H
+#define RENDER_BACKEND_H
+
+#include "Camera.h"
+#include "CpuRenderer.h"
+#include "ImageIO.h"
+#include "Random.h"
+#include "RenderStats.h"
+#include "Scene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// What main.cpp (and the compare mode) talks to, one per way of producing a
+// frame. The GL ones live in GLBackends.h since they need a context; this
+// header stays headless so the tools can compare the CPU backends too.
+
+enum class BackendType {
+    Metal,      // rayTracer.metal, copied into a GL texture (macOS)
+    GLCompute,  // rayTracer.comp writing into the GL texture directly
+    Cpu,        // CpuRenderer on every core
+    CpuScalar   // CpuRenderer on one thread, one path at a time
+};
+
+inline const char* backendTypeName(BackendType type) {
+    switch (type) {
+        case BackendType::Metal:     return "metal";
+        case BackendType::GLCompute: return "gl-compute";
+        case BackendType::CpuScalar: return "cpu-scalar";
+        default:                     return "cpu";
+    }
+}
+
+inline bool parseBackendType(const std::string& name, BackendType& type) {
+    if (name == "metal")           type = BackendType::Metal;
+    else if (name == "gl-compute") type = BackendType::GLCompute;
+    else if (name == "cpu")        type = BackendType::Cpu;
+    else if (name == "cpu-scalar") type = BackendType::CpuScalar;
+    else return false;
+    return true;
+}
+
+class RenderBackend {
+public:
+    virtual ~RenderBackend() = default;
+
+    virtual BackendType type() const = 0;
+    const char* name() const { return backendTypeName(type()); }
+
+    // false if the backend can't run here (no device, old context, shader errors)
+    virtual bool init(int w, int h) = 0;
+    virtual void render(const Camera& camera) = 0;
+    // texture ray.frag samples, 0 for headless backends
+    virtual unsigned int getOpenGLTextureID() { return 0; }
+    virtual void cleanup() {}
+
+    // counters from the last render() call (all zero with RT_ENABLE_STATS=0)
+    virtual const RenderStats& getFrameStats() const = 0;
+    // drawn on top of the image, empty string turns it off (not every backend can)
+    virtual void setOverlayText(const std::string&) {}
+    // lightSamples = lights sampled per hit, 0 = every light
+    virtual void setLights(const std::vector<Light>& lights, int lightSamples = 4) = 0;
+    // spheres (+ triangles on the CPU ones) to trace, lights stay as set by
+    // setLights. The GPU ones only upload what changed since the last call.
+    virtual void setScene(const Scene& scene) = 0;
+    virtual void setSampler(SamplerType type, int samplesPerPixel = 4) = 0;
+    // keys the sample streams, same frame index = same image on every backend
+    virtual void setFrameIndex(uint32_t frame) = 0;
+
+    // Blocks until the last render() is done, for timing the GPU ones
+    virtual void finish() {}
+    // Last frame as RGBA8, first row = bottom. Reads the GPU ones back, so
+    // it's for comparisons and screenshots, not the frame loop.
+    virtual void readPixels(std::vector<uint8_t>& rgba) = 0;
+};
+
+// ============ CPU ============
+class CpuBackend : public RenderBackend {
+public:
+    // scalar: one thread, per path megakernel (the original CPU tracer's
+    // shape); otherwise settings as given, threads = 0 takes every core
+    CpuBackend(bool scalar, const CpuRenderSettings& cpuSettings = CpuRenderSettings())
+        : scalar(scalar), settings(cpuSettings)
+    {
+        if (scalar) {
+            settings.threads = 1;
+            settings.wavefront = settings.binSecondary = settings.hybrid = false;
+        }
+    }
+
+    BackendType type() const override { return scalar ? BackendType::CpuScalar : BackendType::Cpu; }
+
+    bool init(int w, int h) override
+    {
+        renderer.init(w, h, settings);
+        renderer.setScene(scene);
+        return true;
+    }
+    void render(const Camera& camera) override { renderer.render(camera); }
+
+    const RenderStats& getFrameStats() const override { return renderer.getFrameStats(); }
+    void setOverlayText(const std::string& text) override { renderer.setOverlayText(text); }
+    void setLights(const std::vector<Light>& lights, int lightSamples = 4) override
+    {
+        scene.lights = lights;
+        settings.lightSamples = lightSamples;
+        renderer.setLightSamples(lightSamples);
+        renderer.setScene(scene);
+    }
+    void setScene(const Scene& newScene) override
+    {
+        scene.spheres = newScene.spheres;
+        scene.triangles = newScene.triangles;
+        renderer.setScene(scene);
+    }
+    void setSampler(SamplerType type, int samplesPerPixel = 4) override
+    {
+        settings.sampler = type;
+        settings.samplesPerPixel = samplesPerPixel;
+        renderer.setSampler(type, samplesPerPixel);
+    }
+    void setFrameIndex(uint32_t frame) override { renderer.setFrameIndex(frame); }
+    void readPixels(std::vector<uint8_t>& rgba) override { rgba = renderer.getPixels(); }
+
+    // heatmap modes, timings etc.
+    CpuRenderer& getRenderer() { return renderer; }
+
+protected:
+    bool scalar;
+    CpuRenderSettings settings;
+    Scene scene = Scene::demo(); // same start as the GPU backends
+    CpuRenderer renderer;
+};
+
+// Headless backends only, nullptr for the GPU ones (GLBackends.h has those)
+inline std::unique_ptr<RenderBackend> createCpuBackend(BackendType type,
+                                                       const CpuRenderSettings& settings = CpuRenderSettings())
+{
+    if (type == BackendType::Cpu) return std::make_unique<CpuBackend>(false, settings);
+    if (type == BackendType::CpuScalar) return std::make_unique<CpuBackend>(true, settings);
+    return nullptr;
+}
+
+// ============ Compare mode ============
+struct BackendComparison {
+    double msA = 0.0, msB = 0.0; // mean per timed frame
+    double psnr = 0.0;           // A vs B, infinity if identical
+    size_t differingPixels = 0;
+    int maxDiff = 0;             // largest channel difference, 0..255
+    RenderStats statsA, statsB;  // of the compared frame
+};
+
+// Same camera, frame index and settings on both: one frame to compare (also
+// warms up shader compiles and caches), then frames timed frames each, A and B
+// interleaved so clock or thermal drift hits both the same.
+inline BackendComparison compareBackends(RenderBackend& a, RenderBackend& b, const Camera& camera, int frames)
+{
+    BackendComparison result;
+    std::vector<uint8_t> pixelsA, pixelsB;
+    a.render(camera);
+    a.readPixels(pixelsA);
+    result.statsA = a.getFrameStats();
+    b.render(camera);
+    b.readPixels(pixelsB);
+    result.statsB = b.getFrameStats();
+
+    auto timeFrame = [&](RenderBackend& backend) {
+        auto start = std::chrono::steady_clock::now();
+        backend.render(camera);
+        backend.finish();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    for (int frame = 0; frame < frames; frame++) {
+        result.msA += timeFrame(a);
+        result.msB += timeFrame(b);
+    }
+    if (frames > 0) {
+        result.msA /= frames;
+        result.msB /= frames;
+    }
+
+    if (pixelsA.size() != pixelsB.size() || pixelsA.empty()) {
+        std::cout << "ERROR::BACKEND::FRAME_SIZE_MISMATCH" << std::endl;
+        return result;
+    }
+    const int pixelCount = (int)(pixelsA.size() / 4);
+    result.psnr = ImageIO::psnr(pixelsA.data(), pixelsB.data(), pixelCount, 1);
+    for (size_t i = 0; i < pixelsA.size(); i += 4) {
+        int diff = 0;
+        for (int c = 0; c < 3; c++) diff = std::max(diff, std::abs((int)pixelsA[i + c] - (int)pixelsB[i + c]));
+        if (diff > 0) result.differingPixels++;
+        result.maxDiff = std::max(result.maxDiff, diff);
+    }
+    return result;
+}
+
+inline void printComparison(const RenderBackend& a, const RenderBackend& b, const BackendComparison& result)
+{
+    std::cout << a.name() << " vs " << b.name() << ":\n"
+              << "  " << a.name() << " " << result.msA << " ms/frame, " << b.name() << " " << result.msB
+              << " ms/frame";
+    if (result.msA > 0.0 && result.msB > 0.0)
+        std::cout << " (" << b.name() << " is " << result.msA / result.msB << "x the speed)";
+    std::cout << "\n  PSNR " << result.psnr << " dB, " << result.differingPixels << " pixels differ, max "
+              << result.maxDiff << " levels" << std::endl;
+#if RT_ENABLE_STATS
+    std::cout << "  rays (primary/shadow/reflection): " << result.statsA.primaryRays << "/"
+              << result.statsA.shadowRays << "/" << result.statsA.reflectionRays << " vs "
+              << result.statsB.primaryRays << "/" << result.statsB.shadowRays << "/"
+              << result.statsB.reflectionRays << std::endl;
+#endif
+}
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+// Per-frame counters for the tracing path.
+// Build with -DRT_ENABLE_STATS=0 (CMake option RT_ENABLE_STATS=OFF) and every
+// counter compiles away, on both the C++ side and the Metal kernel, except
+// the CPU ray counts (see RT_RAY_STAT).
+#ifndef RT_ENABLE_STATS
+#define RT_ENABLE_STATS 1
+#endif
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+struct RenderStats {
+    uint64_t primaryRays = 0;
+    uint64_t visibilityHits = 0;    // camera samples read from the rasterised visibility buffer instead
+    uint64_t shadowRays = 0;
+    uint64_t reflectionRays = 0;
+    uint64_t nodesVisited = 0;      // BVH nodes stepped into, every backend
+    uint64_t primitiveTests = 0;    // ray-sphere tests
+    uint64_t shadowEarlyOuts = 0;   // shadow rays that stopped at the first occluder
+    uint64_t throughputCutoffs = 0; // bounces killed by length(throughPut) < 0.001
+    uint64_t occluderCacheLookups = 0; // shadow rays that had a cached occluder to try first
+    uint64_t occluderCacheHits = 0;    // ...and that occluder still blocked them
+    uint64_t rouletteKills = 0;     // paths ended by Russian roulette
+    uint64_t budgetCutoffs = 0;     // paths ended early by the frame ray budget
+    uint64_t bouncesSaved = 0;      // bounces those two skipped (up to maxBounces)
+    uint64_t samples = 0;           // camera samples over the whole frame
+    uint64_t pixels = 0;
+
+    RenderStats& operator+=(const RenderStats& o) {
+        primaryRays       += o.primaryRays;
+        visibilityHits    += o.visibilityHits;
+        shadowRays        += o.shadowRays;
+        reflectionRays    += o.reflectionRays;
+        nodesVisited      += o.nodesVisited;
+        primitiveTests    += o.primitiveTests;
+        shadowEarlyOuts   += o.shadowEarlyOuts;
+        throughputCutoffs += o.throughputCutoffs;
+        occluderCacheLookups += o.occluderCacheLookups;
+        occluderCacheHits += o.occluderCacheHits;
+        rouletteKills     += o.rouletteKills;
+        budgetCutoffs     += o.budgetCutoffs;
+        bouncesSaved      += o.bouncesSaved;
+        samples           += o.samples;
+        pixels            += o.pixels;
+        return *this;
+    }
+
+    uint64_t totalRays() const { return primaryRays + shadowRays + reflectionRays; }
+    double samplesPerPixel() const { return pixels ? (double)samples / (double)pixels : 0.0; }
+    // Path length is counted in segments, camera ray + reflections
+    double averagePathLength() const {
+        return samples ? (double)(primaryRays + visibilityHits + reflectionRays) / (double)samples : 0.0;
+    }
+    double averageBouncesSaved() const { return samples ? (double)bouncesSaved / (double)samples : 0.0; }
+    double occluderCacheHitRate() const {
+        return occluderCacheLookups ? (double)occluderCacheHits / (double)occluderCacheLookups : 0.0;
+    }
+};
+
+// Hot-path counting goes through this so it disappears with RT_ENABLE_STATS=0.
+// Each worker thread owns its own RenderStats, they get summed once per frame.
+#if RT_ENABLE_STATS
+#define RT_STAT(stats, field, n) ((stats).field += (n))
+#else
+#define RT_STAT(stats, field, n) ((void)(stats))
+#endif
+
+// Primary/shadow/reflection rays on the CPU tracer count either way: the ray
+// budget (CpuRenderSettings::rayBudget, frameTargetMs) paces the frame off
+// them. One add per ray, nothing like the per-node counters.
+#define RT_RAY_STAT(stats, field, n) ((stats).field += (n))
+
+// ============ Output ============
+// Either CSV (one row per frame) or JSON lines (one object per frame),
+// picked from the file extension so it can be piped straight into a notebook.
+class StatsWriter {
+public:
+    bool open(const std::string& path) {
+        json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+        out.open(path);
+        if (!out) {
+            std::cout << "ERROR::STATS::COULD_NOT_OPEN " << path << std::endl;
+            return false;
+        }
+        if (!json) {
+            out << "frame,frame_ms,primary_rays,visibility_hits,shadow_rays,reflection_rays,nodes_visited,"
+                   "primitive_tests,shadow_early_outs,throughput_cutoffs,occluder_cache_hit_rate,roulette_kills,"
+                   "budget_cutoffs,avg_path_length,avg_bounces_saved,samples_per_pixel\n";
+        }
+        return true;
+    }
+    bool isOpen() const { return out.is_open(); }
+
+    void write(uint64_t frame, double frameMs, const RenderStats& s) {
+        if (!out.is_open()) return;
+        if (json) {
+            out << "{\"frame\":" << frame
+                << ",\"frame_ms\":" << frameMs
+                << ",\"primary_rays\":" << s.primaryRays
+                << ",\"visibility_hits\":" << s.visibilityHits
+                << ",\"shadow_rays\":" << s.shadowRays
+                << ",\"reflection_rays\":" << s.reflectionRays
+                << ",\"nodes_visited\":" << s.nodesVisited
+                << ",\"primitive_tests\":" << s.primitiveTests
+                << ",\"shadow_early_outs\":" << s.shadowEarlyOuts
+                << ",\"throughput_cutoffs\":" << s.throughputCutoffs
+                << ",\"occluder_cache_hit_rate\":" << s.occluderCacheHitRate()
+                << ",\"roulette_kills\":" << s.rouletteKills
+                << ",\"budget_cutoffs\":" << s.budgetCutoffs
+                << ",\"avg_path_length\":" << s.averagePathLength()
+                << ",\"avg_bounces_saved\":" << s.averageBouncesSaved()
+                << ",\"samples_per_pixel\":" << s.samplesPerPixel() << "}\n";
+        } else {
+            out << frame << ',' << frameMs << ','
+                << s.primaryRays << ',' << s.visibilityHits << ',' << s.shadowRays << ',' << s.reflectionRays << ','
+                << s.nodesVisited << ',' << s.primitiveTests << ',' << s.shadowEarlyOuts << ','
+                << s.throughputCutoffs << ',' << s.occluderCacheHitRate() << ','
+                << s.rouletteKills << ',' << s.budgetCutoffs << ','
+                << s.averagePathLength() << ',' << s.averageBouncesSaved() << ','
+                << s.samplesPerPixel() << '\n';
+        }
+    }
+
+private:
+    std::ofstream out;
+    bool json = false;
+};
+
+// Short multi-line summary used by the text overlay
+inline std::string statsOverlayText(const RenderStats& s, double frameMs) {
+    std::ostringstream text;
+    text.setf(std::ios::fixed);
+    text.precision(2);
+    text << "FRAME " << frameMs << " MS\n";
+    text << "PRIMARY " << s.primaryRays << "\n";
+    if (s.visibilityHits > 0) text << "RASTERISED " << s.visibilityHits << "\n";
+    text << "SHADOW " << s.shadowRays << " EARLY " << s.shadowEarlyOuts << "\n";
+    if (s.occluderCacheLookups > 0)
+        text << "OCCLUDER CACHE " << 100.0 * s.occluderCacheHitRate() << "%\n";
+    text << "REFLECT " << s.reflectionRays << " CUTOFF " << s.throughputCutoffs << "\n";
+    if (s.rouletteKills + s.budgetCutoffs > 0)
+        text << "PATH " << s.averagePathLength() << " SAVED " << s.averageBouncesSaved() << "\n";
+    text << "PRIM TESTS " << s.primitiveTests << "\n";
+    text << "NODES " << s.nodesVisited << "\n";
+    text << "SPP " << s.samplesPerPixel() << "\n";
+    return text.str();
+}
+
+#endif
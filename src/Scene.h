@@ -0,0 +1,534 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <glm/glm.hpp>
+
+#include "BVH.h"
+#include "LightBVH.h"
+#include "Random.h"
+#include "RenderStats.h"
+#include "Simd.h"
+
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// CPU side scene, same layout and materials as the Metal kernel
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;
+};
+
+// For checking ray hitting
+struct Hit {
+    bool hit = false;
+    float t = 0.0f; // used for how far along until hit
+    glm::vec3 point; // where the light hit
+    glm::vec3 normal;
+    int primID = -1;
+    glm::vec3 color;
+    float reflectivity = 0.0f;
+};
+
+struct Sphere {
+    glm::vec3 center;
+    float radius;
+    glm::vec3 color;
+    float reflectivity;
+
+    bool intersect(const Ray& ray, float tMin, float tMax, Hit& out) const
+    {
+        // oc = o - c
+        glm::vec3 oc = ray.origin - center;
+        glm::vec3 dir = ray.direction;
+
+        float a = glm::dot(dir, dir);
+        float b = 2.0f * glm::dot(oc, dir);
+        float c = glm::dot(oc, oc) - radius * radius;
+
+        float discriminant = b * b - 4 * a * c;
+        if(discriminant < 0) return false;
+
+        float discSqrt = std::sqrt(discriminant);
+        float t0 = (-b - discSqrt) / (2 * a);
+        float t1 = (-b + discSqrt) / (2 * a);
+
+        if(t0 > t1) std::swap(t0, t1);
+        float t = t0;
+
+        if(t < tMin || t > tMax) {
+            t = t1;
+            if(t < tMin || t > tMax) {
+                return false;
+            }
+        }
+
+        fillHit(ray, t, out);
+        return true;
+    }
+
+    // Shadow ray version, no hit record to fill
+    bool occludes(const Ray& ray, float tMin, float tMax) const
+    {
+        glm::vec3 oc = ray.origin - center;
+        float a = glm::dot(ray.direction, ray.direction);
+        float b = 2.0f * glm::dot(oc, ray.direction);
+        float c = glm::dot(oc, oc) - radius * radius;
+        float discriminant = b * b - 4 * a * c;
+        if (discriminant < 0) return false;
+
+        float discSqrt = std::sqrt(discriminant);
+        float t0 = (-b - discSqrt) / (2 * a);
+        float t1 = (-b + discSqrt) / (2 * a);
+        return (t0 >= tMin && t0 <= tMax) || (t1 >= tMin && t1 <= tMax);
+    }
+
+    // Fill hit for referencing
+    void fillHit(const Ray& ray, float t, Hit& out) const
+    {
+        out.t = t;
+        out.point = ray.origin + t * ray.direction;
+        out.normal = glm::normalize(out.point - center);
+        if(glm::dot(out.normal, ray.direction) > 0) // makes normal face against the incoming ray
+            out.normal = -out.normal;
+        out.hit = true;
+        out.color = color;
+        out.reflectivity = reflectivity;
+    }
+
+    AABB bounds() const {
+        AABB box;
+        box.grow(center - glm::vec3(radius));
+        box.grow(center + glm::vec3(radius));
+        return box;
+    }
+};
+
+// Four spheres in SoA layout, one SIMD lane each
+struct alignas(16) SpherePacket {
+    float cx[4], cy[4], cz[4];
+    float r2[4];     // radius squared, padding lanes get a huge negative value so they never hit
+    int32_t ids[4];  // index into Scene::spheres, -1 for padding
+};
+
+// Closest of the packet's four spheres, same math as Sphere::intersect.
+// Returns the lane (-1 on a miss) and its distance in tOut. Only lanes with
+// a root inside [tMin, tMax] can win, so an "infinite" tMax (1e30 or inf)
+// never turns a miss or a padding lane into a hit.
+inline int intersectSpherePacket(const SpherePacket& packet, const Ray& ray,
+                                 float tMin, float tMax, float& tOut)
+{
+    const f32x4 ocx = ray.origin.x - simd::load(packet.cx);
+    const f32x4 ocy = ray.origin.y - simd::load(packet.cy);
+    const f32x4 ocz = ray.origin.z - simd::load(packet.cz);
+    const float a = glm::dot(ray.direction, ray.direction);
+
+    const f32x4 b = 2.0f * (ocx * ray.direction.x + ocy * ray.direction.y + ocz * ray.direction.z);
+    const f32x4 c = ocx * ocx + ocy * ocy + ocz * ocz - simd::load(packet.r2);
+    const f32x4 disc = b * b - 4.0f * a * c;
+    const i32x4 hitMask = disc >= 0.0f;
+    if (!simd::any(hitMask)) return -1;
+
+    const f32x4 discSqrt = simd::sqrt(simd::max(disc, simd::splat(0.0f)));
+    const float inv2a = 0.5f / a;
+    const f32x4 t0 = (-b - discSqrt) * inv2a; // a > 0 so t0 <= t1 already
+    const f32x4 t1 = (-b + discSqrt) * inv2a;
+
+    const i32x4 t0Ok = (t0 >= tMin) & (t0 <= tMax);
+    const i32x4 t1Ok = (t1 >= tMin) & (t1 <= tMax);
+    const i32x4 valid = hitMask & (t0Ok | t1Ok);
+    const f32x4 none = simd::splat(std::numeric_limits<float>::infinity());
+    f32x4 t = simd::select(t0Ok, t0, simd::select(t1Ok, t1, none));
+    t = simd::select(valid, t, none);
+
+    int lane = -1;
+    float best = std::numeric_limits<float>::infinity();
+    for (int i = 0; i < 4; i++) {
+        if (valid[i] && t[i] < best) {
+            best = t[i];
+            lane = i;
+        }
+    }
+    if (lane >= 0) tOut = best;
+    return lane;
+}
+
+// Two sided, the normal gets flipped towards the ray like the spheres
+struct Triangle {
+    glm::vec3 v0, v1, v2;
+    glm::vec3 color;
+    float reflectivity;
+
+    // Moller-Trumbore, distance along the ray or -1 on a miss
+    float hitDistance(const Ray& ray, float tMin, float tMax) const
+    {
+        glm::vec3 e1 = v1 - v0;
+        glm::vec3 e2 = v2 - v0;
+        glm::vec3 p = glm::cross(ray.direction, e2);
+        float det = glm::dot(e1, p);
+        if (std::fabs(det) < 1e-9f) return -1.0f; // parallel to the plane
+
+        float invDet = 1.0f / det;
+        glm::vec3 s = ray.origin - v0;
+        float u = glm::dot(s, p) * invDet;
+        if (u < 0.0f || u > 1.0f) return -1.0f;
+
+        glm::vec3 q = glm::cross(s, e1);
+        float v = glm::dot(ray.direction, q) * invDet;
+        if (v < 0.0f || u + v > 1.0f) return -1.0f;
+
+        float t = glm::dot(e2, q) * invDet;
+        if (t < tMin || t > tMax) return -1.0f;
+        return t;
+    }
+
+    bool occludes(const Ray& ray, float tMin, float tMax) const
+    {
+        return hitDistance(ray, tMin, tMax) >= 0.0f;
+    }
+
+    bool intersect(const Ray& ray, float tMin, float tMax, Hit& out) const
+    {
+        float t = hitDistance(ray, tMin, tMax);
+        if (t < 0.0f) return false;
+        fillHit(ray, t, out);
+        return true;
+    }
+
+    void fillHit(const Ray& ray, float t, Hit& out) const
+    {
+        glm::vec3 e1 = v1 - v0;
+        glm::vec3 e2 = v2 - v0;
+        out.t = t;
+        out.point = ray.origin + t * ray.direction;
+        out.normal = glm::normalize(glm::cross(e1, e2));
+        if (glm::dot(out.normal, ray.direction) > 0)
+            out.normal = -out.normal;
+        out.hit = true;
+        out.color = color;
+        out.reflectivity = reflectivity;
+    }
+
+    AABB bounds() const {
+        AABB box;
+        box.grow(v0);
+        box.grow(v1);
+        box.grow(v2);
+        return box;
+    }
+};
+
+// Last primitive that blocked a shadow ray, one per worker thread with a
+// slot per light. Neighbouring pixels in a tile mostly share their occluder,
+// so it gets tested before walking the BVH at all.
+struct OccluderCache {
+    static constexpr int SLOTS = 8; // lights share slots by index & (SLOTS - 1)
+    int32_t prim[SLOTS] = {-1, -1, -1, -1, -1, -1, -1, -1};
+};
+
+// Which geometry a ray is traced against. Coarse uses the simplified
+// meshes handed to addMesh (the rest as they are), for rays whose hits only
+// reach the image blurred or as a yes/no: reflections and shadows.
+enum class TraceDetail { Full, Coarse };
+
+struct Light {
+    glm::vec3 position;
+    glm::vec3 color;
+    float intensity = 0.0f; // > 0 falls off with 1/d^2, 0 = constant like the kernel's light
+};
+
+class Scene {
+public:
+    std::vector<Sphere> spheres;
+    std::vector<Triangle> triangles;
+    std::vector<Light> lights;
+    BVH bvh; // over spheres then triangles: prim < spheres.size() is a sphere
+    std::vector<SpherePacket> spherePackets; // all spheres, 4 per packet, for the SIMD scan
+    LightBVH lightBVH; // built from lights in buildBVH
+
+    // TraceDetail::Coarse geometry, built in buildBVH when any mesh came
+    // with coarse indices. Same sphere first layout as bvh.
+    std::vector<Triangle> coarseTriangles;
+    BVH coarseBVH;
+    float coarseError = 0.0f; // worst object space error of the coarse meshes
+
+    // Same spheres and light as the rayTrace kernel
+    static Scene demo()
+    {
+        Scene scene;
+        scene.spheres = {
+            {{6.0f, 5.5f, 0.0f}, 0.1f, {1.0f, 1.0f, 1.0f}, 0.0f},       // Small sphere above light
+            {{0.0f, 0.0f, -5.0f}, 1.0f, {1.0f, 0.0f, 0.0f}, 0.0f},      // Red Sphere
+            {{2.2f, 1.0f, -6.0f}, 1.0f, {0.0f, 1.0f, 0.0f}, 0.8f},      // Green Sphere
+            {{4.5f, 0.0f, -5.0f}, 1.0f, {0.9f, 0.9f, 0.9f}, 0.95f},     // Silver
+            {{0.0f, -101.5f, -5.0f}, 100.0f, {0.5f, 0.5f, 0.5f}, 0.3f}  // Ground (gray)
+        };
+        scene.lights = {{{5.0f, 5.0f, 0.0f}, {1.0f, 1.0f, 1.0f}}};
+        return scene;
+    }
+
+    uint32_t primitiveCount() const { return (uint32_t)(spheres.size() + triangles.size()); }
+
+    // Appends an indexed triangle mesh with one material. coarseIndices (a
+    // LOD over the same positions, e.g. from buildLodChain) is what
+    // TraceDetail::Coarse rays see of it, error how far that strays.
+    void addMesh(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices,
+                 const glm::vec3& color, float reflectivity,
+                 const std::vector<unsigned int>* coarseIndices = nullptr, float error = 0.0f)
+    {
+        trackFullOnly();
+        const uint32_t first = (uint32_t)triangles.size();
+        triangles.reserve(triangles.size() + indices.size() / 3);
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            triangles.push_back({positions[indices[i]], positions[indices[i + 1]],
+                                 positions[indices[i + 2]], color, reflectivity});
+        }
+        tracked = (uint32_t)triangles.size();
+        if (!coarseIndices) {
+            fullOnlyRanges.push_back({first, tracked});
+            return;
+        }
+        for (size_t i = 0; i + 2 < coarseIndices->size(); i += 3) {
+            const std::vector<unsigned int>& c = *coarseIndices;
+            lodTriangles.push_back({positions[c[i]], positions[c[i + 1]], positions[c[i + 2]], color, reflectivity});
+        }
+        coarseError = std::max(coarseError, error);
+    }
+
+    void buildBVH(const BVHBuildSettings& settings = BVHBuildSettings())
+    {
+        const uint32_t sphereCount = (uint32_t)spheres.size();
+        bvh.build(primitiveCount(), [&](uint32_t i) {
+            return i < sphereCount ? spheres[i].bounds() : triangles[i - sphereCount].bounds();
+        }, settings);
+        coarseTriangles.clear();
+        if (!lodTriangles.empty()) {
+            trackFullOnly();
+            coarseTriangles = lodTriangles;
+            for (const auto& range : fullOnlyRanges)
+                coarseTriangles.insert(coarseTriangles.end(), triangles.begin() + range.first,
+                                       triangles.begin() + range.second);
+            coarseBVH.build(sphereCount + (uint32_t)coarseTriangles.size(), [&](uint32_t i) {
+                return i < sphereCount ? spheres[i].bounds() : coarseTriangles[i - sphereCount].bounds();
+            }, settings);
+        }
+        packSpheres();
+        lightBVH.build(lights);
+    }
+
+    bool hasCoarse() const { return !coarseTriangles.empty(); }
+
+    bool intersectPrimitive(uint32_t prim, const Ray& ray, float tMin, float tMax, Hit& hit,
+                            TraceDetail detail = TraceDetail::Full) const
+    {
+        if (prim < spheres.size()) return spheres[prim].intersect(ray, tMin, tMax, hit);
+        return trianglesFor(detail)[prim - spheres.size()].intersect(ray, tMin, tMax, hit);
+    }
+
+    // Closest hit along the ray. entry (from frustumEntry) skips the top of
+    // the BVH, only valid for rays that start at the frustum's apex and stay
+    // inside it, and only with the full detail BVH. Coarse rays start
+    // coarseError further out so they clear the coarse copy of the surface
+    // they leave; primID then indexes the coarse set.
+    bool intersect(const Ray& ray, float tMin, float tMax, Hit& hit, RenderStats& stats,
+                   const BVHEntrySet* entry = nullptr, TraceDetail detail = TraceDetail::Full) const
+    {
+        if (detail == TraceDetail::Coarse && !hasCoarse()) detail = TraceDetail::Full;
+        if (detail == TraceDetail::Coarse) {
+            tMin = std::max(tMin, coarseError);
+            entry = nullptr;
+        }
+        return bvhFor(detail).closestHit(ray.origin, ray.direction, tMin, tMax,
+            [&](uint32_t prim, float tFar) {
+                RT_STAT(stats, primitiveTests, 1);
+                if (!intersectPrimitive(prim, ray, tMin, tFar, hit, detail)) return -1.0f;
+                hit.primID = (int)prim;
+                return hit.t;
+            }, stats, entry);
+    }
+
+    // Where rays inside the frustum start walking the BVH. Spheres get an
+    // exact test, so the ground sphere drops out of tiles above the horizon.
+    void frustumEntry(const Frustum& frustum, BVHEntrySet& entry) const
+    {
+        bvh.findEntryNodes(frustum, entry, [&](uint32_t prim) {
+            if (prim < spheres.size()) return frustum.overlapsSphere(spheres[prim].center, spheres[prim].radius);
+            AABB box = triangles[prim - spheres.size()].bounds();
+            return frustum.overlaps(box.min, box.max);
+        });
+    }
+
+    bool occludesPrimitive(uint32_t prim, const Ray& ray, float tMin, float tMax,
+                           TraceDetail detail = TraceDetail::Full) const
+    {
+        if (prim < spheres.size()) return spheres[prim].occludes(ray, tMin, tMax);
+        return trianglesFor(detail)[prim - spheres.size()].occludes(ray, tMin, tMax);
+    }
+
+    // Anything between tMin and tMax, stops at the first hit. With a cache
+    // the slot's last occluder is tried first and replaced by whatever blocks
+    // this ray. Coarse works like it does for intersect.
+    bool occluded(const Ray& ray, float tMin, float tMax, RenderStats& stats,
+                  OccluderCache* cache = nullptr, int slot = 0, TraceDetail detail = TraceDetail::Full) const
+    {
+        if (detail == TraceDetail::Coarse && !hasCoarse()) detail = TraceDetail::Full;
+        if (detail == TraceDetail::Coarse) tMin = std::max(tMin, coarseError);
+        const uint32_t count = (uint32_t)(spheres.size() + trianglesFor(detail).size());
+        int32_t* cached = cache ? &cache->prim[slot & (OccluderCache::SLOTS - 1)] : nullptr;
+        // the cached id may be from the other detail level, only its range is guarded
+        if (cached && *cached >= 0 && (uint32_t)*cached < count) {
+            RT_STAT(stats, occluderCacheLookups, 1);
+            RT_STAT(stats, primitiveTests, 1);
+            if (occludesPrimitive((uint32_t)*cached, ray, tMin, tMax, detail)) {
+                RT_STAT(stats, occluderCacheHits, 1);
+                return true;
+            }
+        }
+        int32_t blocker = -1;
+        bool blocked = bvhFor(detail).anyHit(ray.origin, ray.direction, tMin, tMax,
+            [&](uint32_t prim) {
+                RT_STAT(stats, primitiveTests, 1);
+                if (!occludesPrimitive(prim, ray, tMin, tMax, detail)) return false;
+                blocker = (int32_t)prim;
+                return true;
+            }, stats);
+        if (cached && blocked) *cached = blocker;
+        return blocked;
+    }
+
+    // Brute force over every sphere, four at a time. For the handful of
+    // spheres in the demo this beats walking the BVH.
+    bool intersectSpheresSimd(const Ray& ray, float tMin, float tMax, Hit& hit, RenderStats& stats) const
+    {
+        int bestSphere = -1;
+        for (const SpherePacket& packet : spherePackets) {
+            RT_STAT(stats, primitiveTests, 4);
+            float t;
+            int lane = intersectSpherePacket(packet, ray, tMin, tMax, t);
+            if (lane >= 0) {
+                tMax = t;
+                bestSphere = packet.ids[lane];
+            }
+        }
+        if (bestSphere < 0) return false;
+        spheres[bestSphere].fillHit(ray, tMax, hit);
+        hit.primID = bestSphere;
+        return true;
+    }
+
+    // Diffuse + specular from one light, before its shadow ray is traced.
+    // lit / shadowed are the two possible results, same terms as the kernel.
+    struct LightSample {
+        Ray shadowRay;
+        float distance;
+        glm::vec3 lit;
+        glm::vec3 shadowed;
+    };
+
+    // norm divides the result, pdf * lightSamples for picked lights, 1 otherwise
+    LightSample prepareLight(const Hit& hit, const glm::vec3& viewDir, const GPULight& light, float norm = 1.0f) const
+    {
+        const glm::vec3 lightPos(light.position);
+        glm::vec3 lightDir = glm::normalize(lightPos - hit.point);
+        float diffuse = std::max(glm::dot(hit.normal, lightDir), 0.0f);
+
+        glm::vec3 reflectDir = glm::reflect(-lightDir, hit.normal);
+        float spec = std::pow(std::max(glm::dot(viewDir, reflectDir), 0.0f), 32.0f);
+
+        LightSample sample;
+        sample.shadowRay.direction = lightDir;
+        sample.shadowRay.origin = hit.point;
+        sample.distance = glm::distance(hit.point, lightPos);
+
+        const float intensity = light.position.w;
+        const float falloff = intensity > 0.0f ? intensity / (sample.distance * sample.distance) : 1.0f;
+        const glm::vec3 lightColor(light.color);
+        const glm::vec3 specular = glm::vec3(1.0f) * spec * 0.2f;
+        sample.lit = (hit.color * diffuse * lightColor + specular) * falloff / norm;
+        sample.shadowed = (hit.color * (diffuse * 0.2f) * lightColor + specular) * falloff / norm;
+        return sample;
+    }
+
+    // Calls fn(lightIndex, norm) for every light a hit at p should shade. Up
+    // to lightSamples lights are all shaded, past that lightSamples of them
+    // are picked through the light BVH with norm = pdf * lightSamples, so the
+    // cost stays flat as lights are added.
+    template <typename Fn>
+    void forEachLightSample(const glm::vec3& p, int lightSamples, SampleRng& rng, Fn fn) const
+    {
+        const int count = lightBVH.size();
+        if (lightSamples <= 0 || count <= lightSamples) {
+            for (int i = 0; i < count; i++) fn(i, 1.0f);
+            return;
+        }
+        for (int s = 0; s < lightSamples; s++) {
+            float pdf;
+            int light = lightBVH.sample(p, rng.next(), pdf);
+            if (light < 0 || pdf <= 0.0f) continue;
+            fn(light, pdf * (float)lightSamples);
+        }
+    }
+
+    // Direct light at a hit, shadow rays traced right away (against detail)
+    glm::vec3 directLight(const Hit& hit, const glm::vec3& viewDir, int lightSamples,
+                          SampleRng& rng, RenderStats& stats, OccluderCache* cache = nullptr,
+                          TraceDetail detail = TraceDetail::Full) const
+    {
+        glm::vec3 result(0.0f);
+        forEachLightSample(hit.point, lightSamples, rng, [&](int light, float norm) {
+            LightSample sample = prepareLight(hit, viewDir, lightBVH.lights[light], norm);
+            RT_RAY_STAT(stats, shadowRays, 1);
+            if (occluded(sample.shadowRay, 0.001f, sample.distance, stats, cache, light, detail)) {
+                RT_STAT(stats, shadowEarlyOuts, 1);
+                result += sample.shadowed;
+            } else {
+                result += sample.lit;
+            }
+        });
+        return result;
+    }
+
+private:
+    std::vector<Triangle> lodTriangles;                        // coarse versions of the meshes that came with one
+    std::vector<std::pair<uint32_t, uint32_t>> fullOnlyRanges; // [first, end) in triangles of the ones that didn't
+    uint32_t tracked = 0;                                      // triangles already in one of the two
+
+    // triangles pushed straight into the vector (no addMesh) have no coarse version either
+    void trackFullOnly()
+    {
+        if (triangles.size() > tracked) fullOnlyRanges.push_back({tracked, (uint32_t)triangles.size()});
+        tracked = (uint32_t)triangles.size();
+    }
+
+    const BVH& bvhFor(TraceDetail detail) const
+    {
+        return detail == TraceDetail::Coarse && hasCoarse() ? coarseBVH : bvh;
+    }
+    const std::vector<Triangle>& trianglesFor(TraceDetail detail) const
+    {
+        return detail == TraceDetail::Coarse && hasCoarse() ? coarseTriangles : triangles;
+    }
+
+    void packSpheres()
+    {
+        spherePackets.assign((spheres.size() + 3) / 4, SpherePacket());
+        for (size_t i = 0; i < spherePackets.size() * 4; i++) {
+            SpherePacket& packet = spherePackets[i / 4];
+            int lane = (int)(i % 4);
+            if (i < spheres.size()) {
+                packet.cx[lane] = spheres[i].center.x;
+                packet.cy[lane] = spheres[i].center.y;
+                packet.cz[lane] = spheres[i].center.z;
+                packet.r2[lane] = spheres[i].radius * spheres[i].radius;
+                packet.ids[lane] = (int32_t)i;
+            } else {
+                packet.cx[lane] = packet.cy[lane] = packet.cz[lane] = 0.0f;
+                packet.r2[lane] = -1e30f;
+                packet.ids[lane] = -1;
+            }
+        }
+    }
+};
+
+#endif
@@ -6,35 +6,111 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "Hash.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+#include <vector>
+
+// Program binaries are GL 4.1 / ARB_get_program_binary, glad here is 3.3,
+// so the three entry points get loaded by hand (same as GLCompute::load).
+// Call ShaderCache::load() after gladLoadGLLoader; without it, or on a
+// driver with no binary formats, Shader just compiles every time.
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+namespace ShaderCache {
+
+typedef void (APIENTRYP PFNGETPROGRAMBINARY)(GLuint program, GLsizei bufSize, GLsizei* length,
+                                             GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNPROGRAMBINARY)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNPROGRAMPARAMETERI)(GLuint program, GLenum pname, GLint value);
+
+struct State {
+    PFNGETPROGRAMBINARY getProgramBinary = nullptr;
+    PFNPROGRAMBINARY programBinary = nullptr;
+    PFNPROGRAMPARAMETERI programParameteri = nullptr;
+    std::string dir = "shader_cache"; // relative to the working (build) directory
+    std::string driver;               // part of the key, a driver update invalidates everything
+};
+
+inline State& state()
+{
+    static State cache;
+    return cache;
+}
+
+inline bool enabled() { return state().programBinary != nullptr; }
+
+// False if the context can't hand out program binaries, Shader compiles then
+inline bool load(GLADloadproc loader, const std::string& dir = "shader_cache")
+{
+    State& cache = state();
+    cache = State();
+    cache.dir = dir;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    glGetError(); // a 3.3 context without the extension flags the enum
+    if (formats <= 0) return false;
+    cache.getProgramBinary = (PFNGETPROGRAMBINARY)loader("glGetProgramBinary");
+    cache.programBinary = (PFNPROGRAMBINARY)loader("glProgramBinary");
+    cache.programParameteri = (PFNPROGRAMPARAMETERI)loader("glProgramParameteri");
+    if (!cache.getProgramBinary || !cache.programBinary || !cache.programParameteri) {
+        cache = State();
+        return false;
+    }
+    cache.driver = std::string((const char*)glGetString(GL_VENDOR)) + "|" + (const char*)glGetString(GL_RENDERER) +
+                   "|" + (const char*)glGetString(GL_VERSION);
+    return true;
+}
+
+} // namespace ShaderCache
 
 class Shader
 {
 public:
     unsigned int ID;
+    bool fromCache = false; // linked from a cached binary instead of compiled
+    bool linked = false;    // false if a source file couldn't be read or compile/link failed
+    double loadMs = 0.0;    // read + compile/link (or binary load) + reflection
 
     // Shader(const char* vertexPath, const char* fragmentPath);
 
     // void use();
 
     // void setBool(const std::string &name, bool value) const;
-    // void setInt(const std::string &name, int value) const;   
+    // void setInt(const std::string &name, int value) const;
     // void setFloat(const std::string &name, float value) const;
 
-Shader(const char* vertexPath, const char* fragmentPath)
+// defines (e.g. "#define BATCHED\n") goes in after the #version line of both
+// stages, so one file can build several variants
+Shader(const char* vertexPath, const char* fragmentPath, const char* defines = nullptr)
 {
+    auto start = std::chrono::steady_clock::now();
     // 1. retrieve the vertex/fragment source from the given filepath
     std::string vertexCode;
     std::string fragmentCode;
     std::ifstream vShaderFile;
     std::ifstream fShaderFile;
+    bool sourcesRead = true;
     // ensure ifstream objects can throw exceptions:
     vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
     fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-    try 
+    try
     {
         // open files
         vShaderFile.open(vertexPath);
@@ -42,108 +118,237 @@ Shader(const char* vertexPath, const char* fragmentPath)
         std::stringstream vShaderStream, fShaderStream;
         // read file's buffer contents into streams
         vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();		
+        fShaderStream << fShaderFile.rdbuf();
         // close file handlers
         vShaderFile.close();
         fShaderFile.close();
         // convert stream into string
         vertexCode   = vShaderStream.str();
-        fragmentCode = fShaderStream.str();		
+        fragmentCode = fShaderStream.str();
     }
     catch(const std::ifstream::failure& e)
     {
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+        sourcesRead = false;
+    }
+    if (defines) {
+        for (std::string* code : {&vertexCode, &fragmentCode}) {
+            size_t versionEnd = code->find('\n', code->find("#version"));
+            if (versionEnd != std::string::npos) code->insert(versionEnd + 1, defines);
+        }
+    }
+
+    // 2. linked binary from an earlier run, keyed by both sources + the driver
+    std::string cachePath;
+    if (ShaderCache::enabled()) {
+        uint64_t key = fnv1a(fragmentCode, fnv1a(vertexCode + '\0', fnv1a(ShaderCache::state().driver + '\0')));
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+        cachePath = ShaderCache::state().dir + "/" + name;
+        fromCache = loadBinary(cachePath);
+    }
+
+    // 3. otherwise compile shaders
+    if (!fromCache) {
+        compile(vertexCode.c_str(), fragmentCode.c_str());
+        if (!cachePath.empty()) saveBinary(cachePath);
     }
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
-
-    // 2. compile shaders
-    unsigned int vertex, fragment;
-    
-    // vertex Shader
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
-    // fragment Shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
-    
-    // shader Program
-    ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
-    glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+    GLint status = 0;
+    glGetProgramiv(ID, GL_LINK_STATUS, &status);
+    linked = sourcesRead && status == GL_TRUE;
+    reflect();
+    loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
 void use() {
     glUseProgram(ID);
 }
+
+// Location from the table built at link time, -1 (ignored by glUniform*) if
+// the program has no such uniform. A hash lookup instead of a GL call per set.
+int location(const std::string &name) const
+{
+    auto found = uniforms.find(name);
+    return found != uniforms.end() ? found->second : -1;
+}
+// every active uniform outside a block, arrays under "name", "name[0]", "name[1]"...
+const std::unordered_map<std::string, int>& getUniforms() const { return uniforms; }
+
+// Points a uniform block (e.g. FrameData, see FrameUniforms.h) at a binding
+// point. False if the program doesn't use the block.
+bool bindUniformBlock(const std::string &name, unsigned int binding) const
+{
+    GLuint index = glGetUniformBlockIndex(ID, name.c_str());
+    if (index == GL_INVALID_INDEX) return false;
+    glUniformBlockBinding(ID, index, binding);
+    return true;
+}
+
 void setMat4(const std::string &name, const glm::mat4 &mat) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()),
-                       1, GL_FALSE, glm::value_ptr(mat));
+    glUniformMatrix4fv(location(name), 1, GL_FALSE, glm::value_ptr(mat));
 }
 void setBool(const std::string &name, bool value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    glUniform1i(location(name), (int)value);
 }
 void setInt(const std::string &name, int value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1i(location(name), value);
 }
 void setFloat(const std::string &name, float value) const
 {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1f(location(name), value);
 }
 // ------------------------------------------------------------------------
 void setVec2(const std::string &name, const glm::vec2 &value) const
 {
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform2fv(location(name), 1, &value[0]);
 }
 void setVec2(const std::string &name, float x, float y) const
 {
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+    glUniform2f(location(name), x, y);
 }
 // ------------------------------------------------------------------------
 void setVec3(const std::string &name, const glm::vec3 &value) const
 {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform3fv(location(name), 1, &value[0]);
 }
 void setVec3(const std::string &name, float x, float y, float z) const
 {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+    glUniform3f(location(name), x, y, z);
 }
 // ------------------------------------------------------------------------
 void setVec4(const std::string &name, const glm::vec4 &value) const
 {
-    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform4fv(location(name), 1, &value[0]);
 }
 void setVec4(const std::string &name, float x, float y, float z, float w) const
 {
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+    glUniform4f(location(name), x, y, z, w);
 }
 // ------------------------------------------------------------------------
 void setMat2(const std::string &name, const glm::mat2 &mat) const
 {
-    glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix2fv(location(name), 1, GL_FALSE, &mat[0][0]);
 }
 // ------------------------------------------------------------------------
 void setMat3(const std::string &name, const glm::mat3 &mat) const
 {
-    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix3fv(location(name), 1, GL_FALSE, &mat[0][0]);
 }
 // ------------------------------------------------------------------------
 void setTexture(const std::string &name, int texture) {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), 0);
+    glUniform1i(location(name), 0);
 }
 
 private:
+    std::unordered_map<std::string, int> uniforms; // name -> location, filled by reflect()
+
+    void compile(const char* vShaderCode, const char* fShaderCode)
+    {
+        unsigned int vertex, fragment;
+
+        // vertex Shader
+        vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, 1, &vShaderCode, NULL);
+        glCompileShader(vertex);
+        checkCompileErrors(vertex, "VERTEX");
+        // fragment Shader
+        fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment, 1, &fShaderCode, NULL);
+        glCompileShader(fragment);
+        checkCompileErrors(fragment, "FRAGMENT");
+
+        // shader Program
+        ID = glCreateProgram();
+        if (ShaderCache::enabled())
+            ShaderCache::state().programParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glAttachShader(ID, vertex);
+        glAttachShader(ID, fragment);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+    }
+
+    // [format][length][binary], false if missing or the driver won't take it
+    bool loadBinary(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) return false;
+        const std::streamoff fileSize = file.tellg();
+        file.seekg(0);
+        uint32_t format = 0, length = 0;
+        file.read((char*)&format, sizeof(format));
+        file.read((char*)&length, sizeof(length));
+        // a truncated or garbage header would have us allocate whatever length says
+        if (!file || length == 0 || (std::streamoff)length > fileSize - file.tellg()) return false;
+        std::vector<char> binary(length);
+        file.read(binary.data(), length);
+        if (!file) return false;
+
+        ID = glCreateProgram();
+        ShaderCache::state().programBinary(ID, format, binary.data(), (GLsizei)length);
+        GLint status = 0;
+        glGetProgramiv(ID, GL_LINK_STATUS, &status);
+        if (!status) {
+            // stale or from another driver build, recompile and overwrite it
+            glDeleteProgram(ID);
+            ID = 0;
+            return false;
+        }
+        return true;
+    }
+
+    void saveBinary(const std::string& path)
+    {
+        GLint status = 0, length = 0;
+        glGetProgramiv(ID, GL_LINK_STATUS, &status);
+        glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (!status || length <= 0) return;
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        ShaderCache::state().getProgramBinary(ID, length, nullptr, &format, binary.data());
+
+        std::error_code error;
+        std::filesystem::create_directories(ShaderCache::state().dir, error);
+        std::ofstream file(path, std::ios::binary);
+        uint32_t header[2] = {(uint32_t)format, (uint32_t)length};
+        file.write((const char*)header, sizeof(header));
+        file.write(binary.data(), length);
+        if (!file)
+            std::cout << "ERROR::SHADER::CACHE_WRITE_FAILED " << path << std::endl;
+    }
+
+    // One pass over the active uniforms after linking, the setters never ask GL again
+    void reflect()
+    {
+        uniforms.clear();
+        GLint count = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        char name[256];
+        for (GLint i = 0; i < count; i++) {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, (GLuint)i, sizeof(name), &length, &size, &type, name);
+            GLint location = glGetUniformLocation(ID, name);
+            if (location < 0) continue; // lives in a uniform block
+            std::string key(name, length);
+            uniforms[key] = location;
+            // "lights[0]" also answers to "lights", and the other elements get their own entries
+            if (key.size() > 3 && key.compare(key.size() - 3, 3, "[0]") == 0) {
+                std::string base = key.substr(0, key.size() - 3);
+                uniforms[base] = location;
+                for (GLint element = 1; element < size; element++) {
+                    std::string elementName = base + "[" + std::to_string(element) + "]";
+                    uniforms[elementName] = glGetUniformLocation(ID, elementName.c_str());
+                }
+            }
+        }
+    }
+
     void checkCompileErrors(unsigned int shader, std::string type)
     {
         int success;
@@ -168,4 +373,4 @@ private:
         }
     }
 };
-#endif
\ No newline at end of file
+#endif
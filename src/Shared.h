@@ -6,6 +6,8 @@
 #define float4 float4
 #else
 #include <glm/glm.hpp>
+#include <cstdint>
+#include "Camera.h"
 using float3 = glm::vec3;
 using float4 = glm::vec3;
 #endif
@@ -19,16 +21,103 @@ struct GPUCamera {
     float aspectRatio;
 };
 
-// struct GPUSphere {
-//     float3 center;
-//     float radius;
-//     int matID;
-//     float3 color;
-// };
-// struct GPULight {
-//     float3 position;
-//     float3 color;
-//     float intensity;
-// };
+#ifndef __METAL_VERSION__
+// Packs the camera the way the kernels read it (CPU renderer uses it too)
+inline GPUCamera toGPU(const Camera& cam, int width, int height) {
+    return GPUCamera{
+        {cam.Position.x, cam.Position.y, cam.Position.z, 0.0f},
+        {cam.Front.x, cam.Front.y, cam.Front.z, 0.0f},
+        {cam.Up.x, cam.Up.y, cam.Up.z, 0.0f},
+        {cam.Right.x, cam.Right.y, cam.Right.z, 0.0f},
+        glm::radians(cam.Fov),
+        (float)width/(float)height
+    };
+}
+#endif
+
+// Counter slots the kernel adds into (atomic_uint on the Metal side).
+// Order has to match the STAT_* constants in rayTracer.metal and .comp
+enum GPUStatSlot {
+    STAT_PRIMARY_RAYS = 0,
+    STAT_SHADOW_RAYS,
+    STAT_REFLECTION_RAYS,
+    STAT_PRIMITIVE_TESTS,
+    STAT_SHADOW_EARLY_OUTS,
+    STAT_THROUGHPUT_CUTOFFS,
+    STAT_SAMPLES,
+    STAT_OCCLUDER_CACHE_LOOKUPS,
+    STAT_OCCLUDER_CACHE_HITS,
+    STAT_NODES_VISITED,
+    STAT_COUNT
+};
+
+// Each slot is a 64 bit total as two 32 bit words, the kernels have no 64 bit
+// atomics everywhere: whoever's add wraps lo carries one into hi. A 1080p
+// frame at high spp over 1e5 spheres passes 2^32 primitive tests.
+struct GPUCounter {
+    uint32_t lo;
+    uint32_t hi;
+};
+
+struct GPUStats {
+    GPUCounter counters[STAT_COUNT];
+};
+
+#ifndef __METAL_VERSION__
+inline uint64_t statTotal(const GPUStats& stats, GPUStatSlot slot) {
+    return ((uint64_t)stats.counters[slot].hi << 32) | stats.counters[slot].lo;
+}
+#endif
+
+// Scene spheres (buffer 7), in BVH leaf order so leaves index them directly
+struct GPUSphere {
+    glm::vec3 center;
+    float radius;
+    uint32_t material; // index into the material buffer
+    uint32_t pad[3];
+};
+
+// Buffer 8, shared by every sphere with the same colour + reflectivity
+struct GPUMaterial {
+    glm::vec3 color;
+    float reflectivity;
+};
+
+// Buffer 9 holds the sphere BVH as plain BVHNodes (32 bytes, packed float3 + uint)
+struct GPUSceneParams {
+    uint32_t sphereCount;
+    uint32_t nodeCount; // 0 = empty scene, every ray misses
+    uint32_t pad[2];
+};
+
+// Lights as the kernel reads them (buffer 2), in light BVH leaf order
+struct GPULight {
+    glm::vec4 position; // w = intensity, 0 = no falloff (the original single light)
+    glm::vec4 color;    // w unused
+};
+
+// Light BVH node (buffer 3). One light per leaf, children are adjacent.
+struct GPULightNode {
+    glm::vec4 boundsMin; // w = summed power of the lights below
+    glm::vec4 boundsMax; // w unused
+    int32_t first;       // leaf: index into the light array, interior: left child (right = first + 1)
+    int32_t count;       // 1 = leaf, 0 = interior
+    int32_t pad[2];
+};
+
+// Buffer 4
+struct GPULightParams {
+    uint32_t count;   // lights in the buffer
+    uint32_t samples; // light samples per shading point, count <= samples loops over all of them
+    uint32_t pad[2];
+};
+
+// Buffer 5, buffer 6 holds the blue noise tile (BLUE_NOISE_SIZE^2 floats)
+struct GPUSamplerParams {
+    uint32_t type;            // SamplerType
+    uint32_t samplesPerPixel;
+    uint32_t frame;           // keys the sample streams
+    uint32_t pad;
+};
 
 #endif
\ No newline at end of file
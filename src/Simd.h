@@ -0,0 +1,64 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE__) || defined(__x86_64__)
+#include <immintrin.h>
+#define RT_SIMD_SSE 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define RT_SIMD_NEON 1
+#endif
+
+// 4-wide float/int lanes using the GCC/Clang vector extension, so the same
+// code compiles to SSE on x86 and NEON on Apple Silicon. Arithmetic and
+// comparisons work lane-wise with the normal operators, comparisons give
+// all-ones / all-zero int masks.
+typedef float f32x4 __attribute__((vector_size(16)));
+typedef int32_t i32x4 __attribute__((vector_size(16)));
+
+namespace simd {
+
+inline f32x4 splat(float v) { return f32x4{v, v, v, v}; }
+
+inline f32x4 load(const float* p) {
+    f32x4 r;
+    std::memcpy(&r, p, sizeof(r));
+    return r;
+}
+
+inline f32x4 sqrt(f32x4 v) {
+#if RT_SIMD_SSE
+    return (f32x4)_mm_sqrt_ps((__m128)v);
+#elif RT_SIMD_NEON
+    return (f32x4)vsqrtq_f32((float32x4_t)v);
+#else
+    return f32x4{std::sqrt(v[0]), std::sqrt(v[1]), std::sqrt(v[2]), std::sqrt(v[3])};
+#endif
+}
+
+inline f32x4 min(f32x4 a, f32x4 b) {
+    i32x4 m = a < b;
+    return (f32x4)((m & (i32x4)a) | (~m & (i32x4)b));
+}
+
+inline f32x4 max(f32x4 a, f32x4 b) {
+    i32x4 m = a > b;
+    return (f32x4)((m & (i32x4)a) | (~m & (i32x4)b));
+}
+
+// mask ? a : b per lane
+inline f32x4 select(i32x4 mask, f32x4 a, f32x4 b) {
+    return (f32x4)((mask & (i32x4)a) | (~mask & (i32x4)b));
+}
+
+inline bool any(i32x4 mask) {
+    return (mask[0] | mask[1] | mask[2] | mask[3]) != 0;
+}
+
+} // namespace simd
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef TEXT_OVERLAY_H
+#define TEXT_OVERLAY_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Tiny 3x5 bitmap font blitted straight into an RGBA8 pixel buffer.
+// No font textures or extra draw calls, the text rides along with the
+// ray traced image when it gets uploaded.
+namespace TextOverlay {
+
+struct Glyph {
+    char c;
+    const char* rows; // 5 rows of 3 columns, '#' = lit
+};
+
+static const Glyph FONT[] = {
+    {'0', "###" "# #" "# #" "# #" "###"},
+    {'1', " # " "## " " # " " # " "###"},
+    {'2', "###" "  #" "###" "#  " "###"},
+    {'3', "###" "  #" " ##" "  #" "###"},
+    {'4', "# #" "# #" "###" "  #" "  #"},
+    {'5', "###" "#  " "###" "  #" "###"},
+    {'6', "###" "#  " "###" "# #" "###"},
+    {'7', "###" "  #" " # " " # " " # "},
+    {'8', "###" "# #" "###" "# #" "###"},
+    {'9', "###" "# #" "###" "  #" "###"},
+    {'A', " # " "# #" "###" "# #" "# #"},
+    {'B', "## " "# #" "## " "# #" "## "},
+    {'C', " ##" "#  " "#  " "#  " " ##"},
+    {'D', "## " "# #" "# #" "# #" "## "},
+    {'E', "###" "#  " "## " "#  " "###"},
+    {'F', "###" "#  " "## " "#  " "#  "},
+    {'G', " ##" "#  " "# #" "# #" " ##"},
+    {'H', "# #" "# #" "###" "# #" "# #"},
+    {'I', "###" " # " " # " " # " "###"},
+    {'J', "  #" "  #" "  #" "# #" " # "},
+    {'K', "# #" "# #" "## " "# #" "# #"},
+    {'L', "#  " "#  " "#  " "#  " "###"},
+    {'M', "# #" "###" "###" "# #" "# #"},
+    {'N', "## " "# #" "# #" "# #" "# #"},
+    {'O', " # " "# #" "# #" "# #" " # "},
+    {'P', "## " "# #" "## " "#  " "#  "},
+    {'Q', " # " "# #" "# #" "## " " ##"},
+    {'R', "## " "# #" "## " "# #" "# #"},
+    {'S', " ##" "#  " " # " "  #" "## "},
+    {'T', "###" " # " " # " " # " " # "},
+    {'U', "# #" "# #" "# #" "# #" "###"},
+    {'V', "# #" "# #" "# #" "# #" " # "},
+    {'W', "# #" "# #" "###" "###" "# #"},
+    {'X', "# #" "# #" " # " "# #" "# #"},
+    {'Y', "# #" "# #" " # " " # " " # "},
+    {'Z', "###" "  #" " # " "#  " "###"},
+    {'.', "   " "   " "   " "   " " # "},
+    {':', "   " " # " "   " " # " "   "},
+    {'-', "   " "   " "###" "   " "   "},
+    {'/', "  #" "  #" " # " "#  " "#  "},
+    {'%', "# #" "  #" " # " "#  " "# #"},
+    {'=', "   " "###" "   " "###" "   "},
+    {'<', "  #" " # " "#  " " # " "  #"},
+    {'>', "#  " " # " "  #" " # " "#  "},
+};
+
+inline const char* findGlyph(char c) {
+    if (c >= 'a' && c <= 'z') c = (char)(c - 'a' + 'A');
+    for (const Glyph& g : FONT)
+        if (g.c == c) return g.rows;
+    return nullptr; // unknown characters draw as blanks
+}
+
+// Draws text with its top-left corner at (x, y), y measured from the top of
+// the image. flipY is for buffers whose first row is the bottom of the screen
+// (the Metal readback and GL textures are both stored that way).
+inline void drawText(uint8_t* rgba, int width, int height, int x, int y,
+                     const std::string& text, int scale = 2, bool flipY = true,
+                     uint8_t r = 255, uint8_t g = 255, uint8_t b = 0)
+{
+    const int advance = 4 * scale;
+    const int lineHeight = 7 * scale;
+    int penX = x, penY = y;
+
+    for (char c : text) {
+        if (c == '\n') {
+            penX = x;
+            penY += lineHeight;
+            continue;
+        }
+        const char* rows = findGlyph(c);
+        if (rows) {
+            // dark backing box first so the text reads on bright skies
+            for (int py = -1; py < 5 * scale + 1; py++) {
+                for (int px = -1; px < 4 * scale; px++) {
+                    int sx = penX + px, sy = penY + py;
+                    if (sx < 0 || sy < 0 || sx >= width || sy >= height) continue;
+                    int row = flipY ? height - 1 - sy : sy;
+                    uint8_t* p = rgba + 4 * (row * width + sx);
+                    p[0] /= 4; p[1] /= 4; p[2] /= 4;
+                }
+            }
+            for (int gy = 0; gy < 5; gy++) {
+                for (int gx = 0; gx < 3; gx++) {
+                    if (rows[gy * 3 + gx] != '#') continue;
+                    for (int sy = 0; sy < scale; sy++) {
+                        for (int sx = 0; sx < scale; sx++) {
+                            int px = penX + gx * scale + sx;
+                            int py = penY + gy * scale + sy;
+                            if (px < 0 || py < 0 || px >= width || py >= height) continue;
+                            int row = flipY ? height - 1 - py : py;
+                            uint8_t* p = rgba + 4 * (row * width + px);
+                            p[0] = r; p[1] = g; p[2] = b; p[3] = 255;
+                        }
+                    }
+                }
+            }
+        }
+        penX += advance;
+    }
+}
+
+} // namespace TextOverlay
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Persistent workers for the CPU renderer. run() hands the same job to every
+// worker (job(workerIndex)) and blocks until all of them return, the job
+// itself decides how to split the work (e.g. pulling tiles off an atomic).
+class ThreadPool {
+public:
+    explicit ThreadPool(int threadCount = 0)
+    {
+        if (threadCount <= 0)
+            threadCount = (int)std::max(1u, std::thread::hardware_concurrency());
+        for (int i = 0; i < threadCount; i++)
+            workers.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : workers) t.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return (int)workers.size(); }
+
+    void run(const std::function<void(int)>& job)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        currentJob = &job;
+        pending = (int)workers.size();
+        generation++;
+        wake.notify_all();
+        done.wait(lock, [this] { return pending == 0; });
+        currentJob = nullptr;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(int)>* currentJob = nullptr;
+    int pending = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+
+    void workerLoop(int index)
+    {
+        Profiler::get().setThreadName("worker " + std::to_string(index));
+        uint64_t seen = 0;
+        while (true) {
+            const std::function<void(int)>* job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+                job = currentJob;
+            }
+            (*job)(index);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--pending == 0) done.notify_one();
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef WAVEFRONT_H
+#define WAVEFRONT_H
+
+#include <glm/glm.hpp>
+
+#include "Random.h"
+#include "RenderStats.h"
+#include "Scene.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Stream version of CpuRenderer::traceRay. Instead of running one path's
+// whole bounce loop before starting the next, every path of a tile batch sits
+// in a queue and each stage (extend, shade, shadow, reflect) runs over the
+// whole queue before the next one starts. Finished paths get compacted out
+// between bounces, so later bounces only loop over live paths.
+
+// How deep a path may go. Shared by the megakernel and the wavefront loop.
+struct PathLimits {
+    int maxBounces = 4;
+    int bounceLimit = 4;    // <= maxBounces, lowered by the frame ray budget
+    int rouletteDepth = 0;  // Russian roulette from this bounce on, 0 = off
+};
+
+// Called once a path has its new throughput and is about to reflect. Decides
+// whether it keeps going: Russian roulette past rouletteDepth (survivors are
+// divided by their survival probability so the image stays unbiased), then
+// the budget's bounce limit. Counts what was cut and the bounces that saved.
+inline bool continuePath(glm::vec3& throughput, int bounce, const PathLimits& limits, SampleRng& rng,
+                         RenderStats& stats)
+{
+    const int bouncesLeft = limits.maxBounces - (bounce + 1);
+    if (bouncesLeft <= 0) return false;
+
+    if (limits.rouletteDepth > 0 && bounce + 1 >= limits.rouletteDepth) {
+        float survive = std::min(1.0f, std::max(throughput.r, std::max(throughput.g, throughput.b)));
+        if (rng.next() >= survive) {
+            RT_STAT(stats, rouletteKills, 1);
+            RT_STAT(stats, bouncesSaved, bouncesLeft);
+            return false;
+        }
+        throughput /= survive;
+    }
+
+    if (bounce + 1 >= limits.bounceLimit) {
+        RT_STAT(stats, budgetCutoffs, 1);
+        RT_STAT(stats, bouncesSaved, bouncesLeft);
+        return false;
+    }
+    return true;
+}
+
+struct PathState {
+    Ray ray;
+    glm::vec3 throughput;
+    SampleRng rng;
+    uint32_t id; // index into WavefrontQueues::radiance
+};
+
+// A shadow ray with the two results it can add to its path
+struct ShadowRequest {
+    Ray ray;
+    float distance;
+    glm::vec3 lit;       // already multiplied by the path throughput
+    glm::vec3 shadowed;
+    uint32_t id;
+    int32_t light;       // occluder cache slot
+};
+
+// Camera rays of one tile share an entry set, they're q.paths[firstPath,
+// next tile's firstPath) until the first bounce compacts the queue
+struct TileEntry {
+    uint32_t firstPath;
+    BVHEntrySet entry;
+};
+
+// Reused between batches so the vectors keep their capacity
+struct WavefrontQueues {
+    std::vector<PathState> paths;
+    std::vector<PathState> next;
+    std::vector<Hit> hits;
+    std::vector<ShadowRequest> shadows;
+    std::vector<glm::vec3> radiance; // one per path id
+    std::vector<uint64_t> sortKeys;
+    std::vector<TileEntry> tileEntries; // empty = camera rays start at the BVH root
+    std::vector<Hit> primaryHits;       // hybrid mode: bounce 0 hits already known, one per path
+};
+
+// Spreads the low 10 bits of v out to every third bit
+inline uint32_t expandBits10(uint32_t v)
+{
+    v &= 0x3ffu;
+    v = (v | (v << 16)) & 0x030000ffu;
+    v = (v | (v << 8)) & 0x0300f00fu;
+    v = (v | (v << 4)) & 0x030c30c3u;
+    v = (v | (v << 2)) & 0x09249249u;
+    return v;
+}
+
+// Direction octant in the top 3 bits, 30 bit Morton code of the origin
+// (quantised inside the scene bounds) below it. Rays with the same key start
+// close together and head the same way, so they walk the same BVH nodes.
+inline uint32_t rayBinKey(const Ray& ray, const glm::vec3& boundsMin, const glm::vec3& invExtent)
+{
+    uint32_t octant = (ray.direction.x < 0.0f ? 1u : 0u) | (ray.direction.y < 0.0f ? 2u : 0u) |
+                      (ray.direction.z < 0.0f ? 4u : 0u);
+    glm::vec3 cell = glm::clamp((ray.origin - boundsMin) * invExtent, 0.0f, 1.0f) * 1023.0f;
+    uint32_t morton = (expandBits10((uint32_t)cell.x) << 2) | (expandBits10((uint32_t)cell.y) << 1) |
+                      expandBits10((uint32_t)cell.z);
+    return (octant << 30) | morton;
+}
+
+// Reorders q.paths by rayBinKey. Only the order changes, each path still
+// writes to its own radiance slot so the image doesn't.
+inline void binPaths(const Scene& scene, WavefrontQueues& q)
+{
+    if (q.paths.size() < 2 || scene.bvh.nodes.empty()) return;
+    const glm::vec3 boundsMin = scene.bvh.nodes[0].boundsMin;
+    const glm::vec3 extent = glm::max(scene.bvh.nodes[0].boundsMax - boundsMin, glm::vec3(1e-6f));
+    const glm::vec3 invExtent = 1.0f / extent;
+
+    // key in the high half, index in the low half: one sort of plain integers
+    q.sortKeys.resize(q.paths.size());
+    for (size_t i = 0; i < q.paths.size(); i++)
+        q.sortKeys[i] = ((uint64_t)rayBinKey(q.paths[i].ray, boundsMin, invExtent) << 32) | (uint64_t)i;
+    std::sort(q.sortKeys.begin(), q.sortKeys.end());
+
+    q.next.clear();
+    for (uint64_t key : q.sortKeys) q.next.push_back(q.paths[(uint32_t)key]);
+    std::swap(q.paths, q.next);
+}
+
+// Traces everything in q.paths within limits, same shading as the
+// megakernel. Results land in q.radiance[path.id]. binSecondary sorts the
+// reflection rays with binPaths before each bounce after the first,
+// coarseSecondary traces them and every shadow ray with TraceDetail::Coarse.
+inline void traceWavefront(const Scene& scene, WavefrontQueues& q, const glm::vec3& camPos,
+                           const PathLimits& limits, int lightSamples, RenderStats& stats, OccluderCache* cache,
+                           bool binSecondary = false, bool coarseSecondary = false)
+{
+    const TraceDetail secondaryDetail = coarseSecondary ? TraceDetail::Coarse : TraceDetail::Full;
+    const float tMin = 0.001f; // Removes too close
+    const float tMax = 9999.9f;
+
+    for (int bounce = 0; bounce < limits.maxBounces && !q.paths.empty(); bounce++) {
+        const size_t count = q.paths.size();
+        if (bounce > 0) RT_RAY_STAT(stats, reflectionRays, count);
+
+        // ============ Extend ============
+        if (bounce == 0 && !q.primaryHits.empty()) {
+            std::swap(q.hits, q.primaryHits);
+        } else if (bounce == 0 && !q.tileEntries.empty()) {
+            q.hits.assign(count, Hit());
+            for (size_t t = 0; t < q.tileEntries.size(); t++) {
+                const size_t end = t + 1 < q.tileEntries.size() ? q.tileEntries[t + 1].firstPath : count;
+                for (size_t i = q.tileEntries[t].firstPath; i < end; i++)
+                    scene.intersect(q.paths[i].ray, tMin, tMax, q.hits[i], stats, &q.tileEntries[t].entry);
+            }
+        } else {
+            q.hits.assign(count, Hit());
+            for (size_t i = 0; i < count; i++)
+                scene.intersect(q.paths[i].ray, tMin, tMax, q.hits[i], stats, nullptr,
+                                bounce > 0 ? secondaryDetail : TraceDetail::Full);
+        }
+
+        // ============ Shade ============
+        // misses pick up the sky, hits queue one shadow ray per light sample
+        q.shadows.clear();
+        for (size_t i = 0; i < count; i++) {
+            PathState& path = q.paths[i];
+            const Hit& hit = q.hits[i];
+            path.rng.setBounce((uint32_t)bounce);
+            if (!hit.hit) {
+                float a = 0.5f * (glm::normalize(path.ray.direction).y + 1.0f);
+                glm::vec3 skyColor = (1.0f - a) * glm::vec3(1.0f) + a * glm::vec3(0.5f, 0.7f, 1.0f);
+                q.radiance[path.id] += skyColor * path.throughput;
+                continue;
+            }
+            glm::vec3 viewDir = glm::normalize(camPos - hit.point);
+            scene.forEachLightSample(hit.point, lightSamples, path.rng, [&](int light, float norm) {
+                Scene::LightSample sample = scene.prepareLight(hit, viewDir, scene.lightBVH.lights[light], norm);
+                q.shadows.push_back({sample.shadowRay, sample.distance, path.throughput * sample.lit,
+                                     path.throughput * sample.shadowed, path.id, light});
+            });
+        }
+
+        // ============ Shadow ============
+        RT_RAY_STAT(stats, shadowRays, q.shadows.size());
+        for (const ShadowRequest& shadow : q.shadows) {
+            if (scene.occluded(shadow.ray, tMin, shadow.distance, stats, cache, shadow.light, secondaryDetail)) {
+                RT_STAT(stats, shadowEarlyOuts, 1);
+                q.radiance[shadow.id] += shadow.shadowed;
+            } else {
+                q.radiance[shadow.id] += shadow.lit;
+            }
+        }
+
+        // ============ Reflect + compact ============
+        q.next.clear();
+        for (size_t i = 0; i < count; i++) {
+            const Hit& hit = q.hits[i];
+            if (!hit.hit || hit.reflectivity < 0.001f) continue;
+
+            PathState path = q.paths[i];
+            path.throughput *= hit.color * hit.reflectivity;
+            if (glm::length(path.throughput) < 0.001f) {
+                RT_STAT(stats, throughputCutoffs, 1);
+                continue;
+            }
+            if (!continuePath(path.throughput, bounce, limits, path.rng, stats)) continue;
+            path.ray.origin = hit.point;
+            path.ray.direction = glm::reflect(path.ray.direction, hit.normal);
+            q.next.push_back(path);
+        }
+        std::swap(q.paths, q.next);
+        if (binSecondary) binPaths(scene, q);
+    }
+    q.paths.clear();
+}
+
+#endif
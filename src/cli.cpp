@@ -0,0 +1,227 @@
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+#include "CpuRenderer.h"
+#include "ImageIO.h"
+#include "Profiler.h"
+#include "RenderBackend.h"
+#include "RenderStats.h"
+#include "BenchScenes.h"
+#include "Scene.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+/*
+---------- Headless CPU renderer ----------
+No window or GPU needed, renders the demo scene with the CPU backend and
+writes the last frame to disk.
+
+./ray_tracer_cli --out frame.ppm
+./ray_tracer_cli --mode nodes --out heat.ppm --cost-dump cost.pfm
+./ray_tracer_cli --compare cpu-scalar,cpu
+*/
+
+static void printUsage() {
+    std::cout <<
+        "Usage: ray_tracer_cli [options]\n"
+        "  --width N --height N     image size (default 800x600)\n"
+        "  --threads N              worker threads, 0 = all cores (default 0)\n"
+        "  --tile N                 tile size in pixels (default 16)\n"
+        "  --schedule S             dynamic | static | interleaved tile hand-out (default dynamic)\n"
+        "  --frames N               frames to render (default 1)\n"
+        "  --mode M                 shaded | nodes | prims | time (default shaded)\n"
+        "  --heat-scale X           cost at the top of the heat ramp, 0 = frame max\n"
+        "  --lights N               replace the demo light with N random falloff lights\n"
+        "  --light-samples N        lights sampled per hit via the light BVH, 0 = all (default 4)\n"
+        "  --no-occluder-cache      don't try the last shadow occluder before the BVH\n"
+        "  --no-frustum-cull        start every camera ray at the BVH root\n"
+        "  --hybrid                 rasterise the camera hits into a visibility buffer, trace from there\n"
+        "  --bounces N              max path length (default 4)\n"
+        "  --spp N                  samples per pixel (default 4)\n"
+        "  --sampler S              grid | random | sobol | bluenoise (default grid)\n"
+        "  --frame-index N          frame number the sample streams are keyed by (default 0,\n"
+        "                           counts up with --frames)\n"
+        "  --region X0,Y0,X1,Y1     only trace this pixel rectangle, y = 0 at the bottom\n"
+        "  --roulette D             Russian roulette from bounce D on, 0 = off (default 0)\n"
+        "  --ray-budget N           rays per frame before paths get shortened, 0 = no limit\n"
+        "  --frame-target MS        ray budget from the last frame's rays/ms\n"
+        "  --wavefront              trace tile batches stage by stage instead of per path\n"
+        "  --bin-rays               wavefront: sort reflection rays by direction + origin\n"
+        "  --leaf-size N            BVH max primitives per leaf (default 2)\n"
+        "  --sah-bins N             BVH SAH bins (default 12)\n"
+        "  --out FILE               write the last frame as PPM\n"
+        "  --cost-dump FILE         write the raw per pixel cost as PFM\n"
+        "  --stats FILE             per-frame counters, .json = JSON lines, else CSV\n"
+        "  --trace FILE             Chrome trace of the frame range below\n"
+        "  --trace-frames A:B       frames to capture (default 0:frames)\n"
+        "  --compare A,B            same frame on two CPU backends (cpu | cpu-scalar): speed ratio\n"
+        "                           and image difference, timed over --frames frames\n";
+}
+
+int main(int argc, char** argv) {
+    int width = 800, height = 600, frames = 1, lightCount = 0;
+    uint32_t frameIndex = 0;
+    CpuRenderSettings settings;
+    BVHBuildSettings bvhSettings;
+    std::string outPath, costPath, tracePath;
+    uint64_t traceFirst = 0, traceLast = 0;
+    bool traceRangeSet = false;
+    StatsWriter statsWriter;
+    std::vector<BackendType> compareTypes;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--width" && hasValue)            width = std::stoi(argv[++i]);
+        else if (arg == "--height" && hasValue)      height = std::stoi(argv[++i]);
+        else if (arg == "--threads" && hasValue)     settings.threads = std::stoi(argv[++i]);
+        else if (arg == "--tile" && hasValue)        settings.tileSize = std::stoi(argv[++i]);
+        else if (arg == "--frames" && hasValue)      frames = std::stoi(argv[++i]);
+        else if (arg == "--heat-scale" && hasValue)  settings.heatScale = std::stof(argv[++i]);
+        else if (arg == "--lights" && hasValue)      lightCount = std::stoi(argv[++i]);
+        else if (arg == "--light-samples" && hasValue) settings.lightSamples = std::stoi(argv[++i]);
+        else if (arg == "--no-occluder-cache")       settings.occluderCache = false;
+        else if (arg == "--no-frustum-cull")         settings.frustumCull = false;
+        else if (arg == "--hybrid")                  settings.hybrid = true;
+        else if (arg == "--bounces" && hasValue)     settings.maxBounces = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--spp" && hasValue)         settings.samplesPerPixel = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--frame-index" && hasValue) frameIndex = (uint32_t)std::stoul(argv[++i]);
+        else if (arg == "--region" && hasValue) {
+            RenderRegion& r = settings.region;
+            if (std::sscanf(argv[++i], "%d,%d,%d,%d", &r.x0, &r.y0, &r.x1, &r.y1) != 4 || r.empty()) {
+                std::cout << "Bad region: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--sampler" && hasValue) {
+            if (!parseSamplerType(argv[++i], settings.sampler)) {
+                std::cout << "Unknown sampler: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--roulette" && hasValue)    settings.rouletteDepth = std::stoi(argv[++i]);
+        else if (arg == "--ray-budget" && hasValue)  settings.rayBudget = std::stoull(argv[++i]);
+        else if (arg == "--frame-target" && hasValue) settings.frameTargetMs = std::stof(argv[++i]);
+        else if (arg == "--wavefront")               settings.wavefront = true;
+        else if (arg == "--bin-rays")                settings.binSecondary = settings.wavefront = true;
+        else if (arg == "--leaf-size" && hasValue)   bvhSettings.maxLeafSize = std::stoi(argv[++i]);
+        else if (arg == "--sah-bins" && hasValue)    bvhSettings.sahBins = std::stoi(argv[++i]);
+        else if (arg == "--out" && hasValue)         outPath = argv[++i];
+        else if (arg == "--cost-dump" && hasValue)   costPath = argv[++i];
+        else if (arg == "--stats" && hasValue)       statsWriter.open(argv[++i]);
+        else if (arg == "--trace" && hasValue)       tracePath = argv[++i];
+        else if (arg == "--mode" && hasValue) {
+            if (!parseRenderMode(argv[++i], settings.mode)) {
+                std::cout << "Unknown mode: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--compare" && hasValue) {
+            std::string pair = argv[++i];
+            size_t comma = pair.find(',');
+            BackendType a, b;
+            if (comma == std::string::npos || !parseBackendType(pair.substr(0, comma), a) ||
+                !parseBackendType(pair.substr(comma + 1), b) || !createCpuBackend(a) || !createCpuBackend(b)) {
+                std::cout << "Bad backend pair (headless: cpu, cpu-scalar): " << pair << std::endl;
+                return 1;
+            }
+            compareTypes = {a, b};
+        }
+        else if (arg == "--schedule" && hasValue) {
+            if (!parseTileSchedule(argv[++i], settings.schedule)) {
+                std::cout << "Unknown schedule: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--trace-frames" && hasValue) {
+            std::string range = argv[++i];
+            size_t colon = range.find(':');
+            try {
+                if (colon == std::string::npos) throw std::invalid_argument(range);
+                traceFirst = std::stoull(range.substr(0, colon));
+                traceLast = std::stoull(range.substr(colon + 1));
+                traceRangeSet = true;
+            } catch (const std::logic_error&) { // invalid_argument, out_of_range
+                std::cout << "Bad --trace-frames " << range << ", expected A:B (frame numbers)" << std::endl;
+                printUsage();
+                return 1;
+            }
+        }
+        else {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+    if (frames < 1) frames = 1;
+    if (settings.hybrid && (settings.sampler != SamplerType::Grid || settings.mode != RenderMode::Shaded))
+        std::cout << "--hybrid needs --sampler grid and the shaded mode, tracing the camera rays" << std::endl;
+
+#if !RT_ENABLE_STATS
+    if (settings.mode == RenderMode::HeatNodes || settings.mode == RenderMode::HeatPrims)
+        std::cout << "Built with RT_ENABLE_STATS=0, node/prim heatmaps will be empty" << std::endl;
+#endif
+
+    Profiler::get().setThreadName("main");
+    if (!tracePath.empty())
+        Profiler::get().configure(tracePath, traceRangeSet ? traceFirst : 0,
+                                  traceRangeSet ? traceLast : (uint64_t)frames);
+
+    Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+
+    if (!compareTypes.empty()) {
+        std::vector<Light> lights = lightCount > 0 ? BenchScenes::randomLights(lightCount) : Scene::demo().lights;
+        std::unique_ptr<RenderBackend> a = createCpuBackend(compareTypes[0], settings);
+        std::unique_ptr<RenderBackend> b = createCpuBackend(compareTypes[1], settings);
+        for (RenderBackend* backend : {a.get(), b.get()}) {
+            backend->init(width, height);
+            backend->setLights(lights, settings.lightSamples);
+            backend->setFrameIndex(frameIndex);
+        }
+        printComparison(*a, *b, compareBackends(*a, *b, camera, frames));
+        return 0;
+    }
+
+    // frame 0 also covers setup so the BVH build shows up in the trace
+    Profiler::get().beginFrame(0);
+    CpuRenderer renderer;
+    renderer.init(width, height, settings);
+    Scene scene = Scene::demo();
+    if (lightCount > 0) scene.lights = BenchScenes::randomLights(lightCount);
+    renderer.setScene(scene, bvhSettings);
+
+    for (int frame = 0; frame < frames; frame++) {
+        if (frame > 0) Profiler::get().beginFrame(frame);
+        auto start = std::chrono::steady_clock::now();
+        renderer.setFrameIndex(frameIndex + (uint32_t)frame);
+        renderer.render(camera);
+        double ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+
+        const RenderStats& stats = renderer.getFrameStats();
+        statsWriter.write(frame, ms, stats);
+        std::cout << "frame " << frame << ": " << ms << " ms";
+        if (stats.totalRays() > 0)
+            std::cout << ", " << stats.totalRays() / (ms * 1000.0) << " Mrays/s";
+        if (stats.visibilityHits > 0)
+            std::cout << ", raster " << renderer.getFrameTiming().rasterMs << " ms";
+        if (stats.rouletteKills + stats.budgetCutoffs > 0)
+            std::cout << ", path " << stats.averagePathLength() << " segments ("
+                      << stats.averageBouncesSaved() << " bounces saved)";
+        std::cout << std::endl;
+    }
+    Profiler::get().finish();
+
+    if (!outPath.empty())
+        ImageIO::writePPM(outPath, renderer.getPixels().data(), width, height);
+    if (!costPath.empty()) {
+        if (settings.mode == RenderMode::Shaded)
+            std::cout << "--cost-dump needs a heat --mode, nothing written" << std::endl;
+        else
+            renderer.dumpCostBuffer(costPath);
+    }
+    return 0;
+}
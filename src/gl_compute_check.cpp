@@ -0,0 +1,215 @@
+#include "Camera.h"
+#include "BenchScenes.h"
+#include "GLBackends.h"
+#include "HeadlessGL.h"
+#include "ImageIO.h"
+#include "Scene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+---------- GL compute parity check ----------
+Runs the OpenGL compute backend without a window (EGL surfaceless context
+from HeadlessGL.h, works on Mesa llvmpipe) and compares its frame against the CPU renderer.
+Both go through RenderBackend / compareBackends like
+ray_tracer --compare; the texture only gets read back for the comparison. Exits non-zero
+if the PSNR is below the threshold or the ray counts differ by more than
+0.1%.
+
+With --spheres N the demo spheres are swapped for N random ones, --sweep
+runs 10 .. 100000 of them and also times the scene upload: the full one and
+the dirty range one after moving a single sphere (checked against the CPU
+again, so a bad refit fails too).
+
+./gl_compute_check
+./gl_compute_check --sampler sobol --lights 64 --out gl.ppm
+./gl_compute_check --sweep --frames 3
+*/
+
+static void printUsage() {
+    std::cout <<
+        "Usage: gl_compute_check [options]\n"
+        "  --width N --height N     image size (default 320x240)\n"
+        "  --spp N                  samples per pixel (default 4)\n"
+        "  --sampler S              grid | random | sobol | bluenoise (default grid)\n"
+        "  --frame-index N          frame number the sample streams are keyed by (default 0)\n"
+        "  --lights N               replace the demo light with N random falloff lights\n"
+        "  --light-samples N        lights sampled per hit via the light BVH, 0 = all (default 4)\n"
+        "  --spheres N              replace the demo spheres with N random ones\n"
+        "  --sweep                  --spheres 10, 100, ... 100000 with upload timings\n"
+        "  --frames N               timed frames per backend after the checked one (default 10)\n"
+        "  --psnr DB                minimum PSNR against the CPU frame (default 40)\n"
+        "  --shader FILE            compute shader (default <repo>/shaders/rayTracer.comp)\n"
+        "  --out FILE               write the GL frame as PPM\n";
+}
+
+static double msSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Compares one frame of each (plus frames timed ones), prints it, false on a mismatch
+static bool checkFrame(GLComputeBackend& gpu, CpuBackend& cpu, const Camera& camera, int frames, double minPsnr)
+{
+    BackendComparison result = compareBackends(gpu, cpu, camera, frames);
+    const RenderStats& gpuStats = result.statsA;
+    const RenderStats& cpuStats = result.statsB;
+    bool ok = result.psnr >= minPsnr;
+
+    std::cout << "PSNR vs CPU: " << result.psnr << " dB (min " << minPsnr << "), " << result.differingPixels
+              << " pixels differ, max " << result.maxDiff << " levels" << std::endl;
+#if RT_ENABLE_STATS
+    // the occluder caches differ (per thread vs per worker and light), the ray counts
+    // shouldn't beyond the odd grazing hit that rounds the other way
+    auto close = [](uint64_t a, uint64_t b) { return std::abs((double)a - (double)b) <= 1e-3 * std::max(a, b); };
+    std::cout << "primary rays " << gpuStats.primaryRays << " / " << cpuStats.primaryRays << ", shadow rays "
+              << gpuStats.shadowRays << " / " << cpuStats.shadowRays << ", reflection rays "
+              << gpuStats.reflectionRays << " / " << cpuStats.reflectionRays << " (GL / CPU)" << std::endl;
+    if (gpuStats.primaryRays != cpuStats.primaryRays || !close(gpuStats.shadowRays, cpuStats.shadowRays) ||
+        !close(gpuStats.reflectionRays, cpuStats.reflectionRays)) {
+        std::cout << "ERROR::GL_COMPUTE::RAY_COUNT_MISMATCH" << std::endl;
+        ok = false;
+    }
+    // the CPU starts camera rays at per tile entry nodes and also walks the triangle
+    // BVH, so the two only roughly compare. Zero means the kernel stopped counting.
+    std::cout << "BVH nodes visited " << gpuStats.nodesVisited << " / " << cpuStats.nodesVisited << " (GL / CPU)"
+              << std::endl;
+    if (cpuStats.nodesVisited > 0 && gpuStats.nodesVisited == 0) {
+        std::cout << "ERROR::GL_COMPUTE::NO_NODE_COUNT" << std::endl;
+        ok = false;
+    }
+#endif
+    if (frames > 0) {
+        std::cout << "GL " << result.msA << " ms/frame, CPU " << result.msB << " ms/frame";
+#if RT_ENABLE_STATS
+        double rays = (double)(gpuStats.primaryRays + gpuStats.shadowRays + gpuStats.reflectionRays);
+        if (result.msA > 0.0) std::cout << ", GL " << rays / (result.msA * 1000.0) << " Mrays/s";
+#endif
+        std::cout << std::endl;
+    }
+    return ok;
+}
+
+// N random spheres: full upload, frame check, then one sphere moved and only its range re-sent
+static bool checkSpheres(GLComputeBackend& gpu, CpuBackend& cpu, const Camera& camera, int sphereCount,
+                         int frames, double minPsnr)
+{
+    Scene scene;
+    scene.spheres = BenchScenes::randomSpheres(sphereCount);
+    std::cout << "---- " << sphereCount << " spheres ----" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    gpu.setScene(scene);
+    glFinish();
+    double fullMs = msSince(start);
+    size_t fullBytes = gpu.getRenderer().getLastUploadBytes();
+    cpu.setScene(scene);
+    bool ok = checkFrame(gpu, cpu, camera, frames, minPsnr);
+
+    scene.spheres[sphereCount / 2].center += glm::vec3(0.25f, 0.0f, 0.0f);
+    start = std::chrono::steady_clock::now();
+    gpu.setScene(scene);
+    glFinish();
+    double dirtyMs = msSince(start);
+    size_t dirtyBytes = gpu.getRenderer().getLastUploadBytes();
+    std::cout << "upload: full " << fullBytes << " bytes " << fullMs << " ms (BVH build included), "
+              << "one sphere moved " << dirtyBytes << " bytes " << dirtyMs << " ms (refit included)" << std::endl;
+    cpu.setScene(scene);
+    ok = checkFrame(gpu, cpu, camera, 0, minPsnr) && ok;
+
+    // an animated colour, a few frames of it: only the material slot should go up
+    size_t recolourBytes = 0;
+    for (int frame = 1; frame <= 3; frame++) {
+        scene.spheres[sphereCount / 2].color = glm::vec3(0.1f * frame, 0.9f, 0.3f);
+        gpu.setScene(scene);
+        recolourBytes = std::max(recolourBytes, gpu.getRenderer().getLastUploadBytes());
+    }
+    std::cout << "upload: one sphere recoloured, at most " << recolourBytes << " bytes a frame, "
+              << gpu.getRenderer().getGPUScene().materials.size() << " materials" << std::endl;
+    if (recolourBytes > sizeof(GPUSphere) + sizeof(GPUMaterial)) {
+        std::cout << "ERROR::GL_COMPUTE::RECOLOUR_UPLOAD " << recolourBytes << " bytes" << std::endl;
+        ok = false;
+    }
+    cpu.setScene(scene);
+    return checkFrame(gpu, cpu, camera, 0, minPsnr) && ok;
+}
+
+int main(int argc, char** argv) {
+    int width = 320, height = 240, samplesPerPixel = 4, lightCount = 0, lightSamples = 4, frames = 10;
+    int sphereCount = 0;
+    bool sweep = false;
+    uint32_t frameIndex = 0;
+    double minPsnr = 40.0;
+    SamplerType sampler = SamplerType::Grid;
+    std::string outPath, shaderPath = RT_SOURCE_DIR "/shaders/rayTracer.comp";
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--width" && hasValue)            width = std::stoi(argv[++i]);
+        else if (arg == "--height" && hasValue)      height = std::stoi(argv[++i]);
+        else if (arg == "--spp" && hasValue)         samplesPerPixel = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--frame-index" && hasValue) frameIndex = (uint32_t)std::stoul(argv[++i]);
+        else if (arg == "--lights" && hasValue)      lightCount = std::stoi(argv[++i]);
+        else if (arg == "--light-samples" && hasValue) lightSamples = std::stoi(argv[++i]);
+        else if (arg == "--spheres" && hasValue)     sphereCount = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--sweep")                   sweep = true;
+        else if (arg == "--frames" && hasValue)      frames = std::max(0, std::stoi(argv[++i]));
+        else if (arg == "--psnr" && hasValue)        minPsnr = std::stod(argv[++i]);
+        else if (arg == "--shader" && hasValue)      shaderPath = argv[++i];
+        else if (arg == "--out" && hasValue)         outPath = argv[++i];
+        else if (arg == "--sampler" && hasValue) {
+            if (!parseSamplerType(argv[++i], sampler)) {
+                std::cout << "Unknown sampler: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    if (!createHeadlessContext()) return 1;
+    if (!GLCompute::load((GLADloadproc)eglGetProcAddress)) return 1;
+
+    Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+    std::vector<Light> lights = lightCount > 0 ? BenchScenes::randomLights(lightCount) : Scene::demo().lights;
+
+    GLComputeBackend gpu;
+    gpu.getRenderer().shaderPath = shaderPath;
+    CpuBackend cpu(false);
+    for (RenderBackend* backend : {(RenderBackend*)&gpu, (RenderBackend*)&cpu}) {
+        if (!backend->init(width, height)) return 1;
+        backend->setLights(lights, lightSamples);
+        backend->setSampler(sampler, samplesPerPixel);
+        backend->setFrameIndex(frameIndex);
+    }
+    std::cout << width << "x" << height << ", " << samplesPerPixel << " spp " << samplerTypeName(sampler)
+              << ", " << lights.size() << " lights" << std::endl;
+
+    bool ok = true;
+    if (sweep) {
+        for (int count = 10; count <= 100000; count *= 10)
+            ok = checkSpheres(gpu, cpu, camera, count, frames, minPsnr) && ok;
+    } else if (sphereCount > 0) {
+        ok = checkSpheres(gpu, cpu, camera, sphereCount, frames, minPsnr);
+    } else {
+        ok = checkFrame(gpu, cpu, camera, frames, minPsnr);
+    }
+
+    if (!outPath.empty()) {
+        std::vector<uint8_t> gpuPixels;
+        gpu.readPixels(gpuPixels);
+        ImageIO::writePPM(outPath, gpuPixels.data(), width, height);
+    }
+    gpu.cleanup();
+
+    std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+    return ok ? 0 : 1;
+}
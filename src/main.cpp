@@ -12,11 +12,16 @@
 #include "Camera.h"
 #include "Model.h"
 
-#include "MetalRenderer.h" // Add renderer header 
+#include "GLBackends.h" // Metal / GL compute / CPU behind one interface
+#include "CpuRenderer.h"
+#include "BenchScenes.h"
+#include "RenderStats.h"
+#include "Profiler.h"
 
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 
 /* 
@@ -39,6 +44,16 @@ bool useDebugCam = false;
 
 bool uiMode = false;
 
+bool showStats = false; // counter overlay, toggled with O
+
+#ifdef __APPLE__
+BackendType backendType = BackendType::Metal;     // --backend
+#else
+BackendType backendType = BackendType::GLCompute; // no Metal here
+#endif
+bool useCpu = false;                     // CPU backend picked, H cycles its heatmaps
+RenderMode cpuMode = RenderMode::Shaded; // heatmaps on the CPU backend, cycled with H
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     // glViewport(0, 0, width, height);
 
@@ -116,6 +131,22 @@ void processInput(GLFWwindow *window, Camera& camera, float deltaTime){
         useDebugCam = !useDebugCam;
     }
     pWasPressed = pPressed;
+
+    // Stats Overlay Switch
+    static bool oWasPressed = false;
+    bool oPressed = glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS;
+    if(oPressed && !oWasPressed) {
+        showStats = !showStats;
+    }
+    oWasPressed = oPressed;
+
+    // Heatmap Mode Switch (CPU backend only)
+    static bool hWasPressed = false;
+    bool hPressed = glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS;
+    if(hPressed && !hWasPressed && useCpu) {
+        cpuMode = (RenderMode)(((int)cpuMode + 1) % 4);
+    }
+    hWasPressed = hPressed;
 }
 
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
@@ -145,14 +176,102 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
     cam.ProcessMouseMovement(xoffset, yoffset);
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // Command line
+    //   --stats <file>    per-frame counters, .json = JSON lines, anything else = CSV
+    //   --stats-overlay   start with the counter overlay on (O toggles it)
+    //   --trace <file>    Chrome trace-event JSON of the frame stages
+    //   --trace-frames A:B  frames to capture, default 60:120
+    //   --backend B       metal | gl-compute | cpu | cpu-scalar (default metal, gl-compute off macOS)
+    //   --cpu             same as --backend cpu
+    //   --gl-compute      same as --backend gl-compute (needs a GL 4.3 driver)
+    //   --compare A,B     render the same frame on two backends, print speed ratio + image diff, exit
+    //   --compare-frames N  timed frames per backend for --compare (default 20)
+    //   --heatmap M       CPU backend heat mode: nodes | prims | time (H cycles)
+    //   --spheres N       N random spheres instead of the demo ones
+    //   --lights N        N random falloff lights instead of the single demo light
+    //   --light-samples N lights sampled per hit through the light BVH, 0 = all (default 4)
+    //   --sampler S       grid | random | sobol | bluenoise (default grid)
+    //   --spp N           samples per pixel (default 4)
+    StatsWriter statsWriter;
+    std::string tracePath;
+    uint64_t traceFirst = 60, traceLast = 120;
+    int lightCount = 0, lightSamples = 4, samplesPerPixel = 4, sphereCount = 0;
+    SamplerType sampler = SamplerType::Grid;
+    std::vector<BackendType> compareTypes;
+    int compareFrames = 20;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--stats" && i + 1 < argc)
+            statsWriter.open(argv[++i]);
+        else if (arg == "--stats-overlay")
+            showStats = true;
+        else if (arg == "--trace" && i + 1 < argc)
+            tracePath = argv[++i];
+        else if (arg == "--backend" && i + 1 < argc) {
+            if (!parseBackendType(argv[++i], backendType))
+                std::cout << "Unknown backend: " << argv[i] << std::endl;
+        }
+        else if (arg == "--cpu")
+            backendType = BackendType::Cpu;
+        else if (arg == "--gl-compute")
+            backendType = BackendType::GLCompute;
+        else if (arg == "--compare" && i + 1 < argc) {
+            std::string pair = argv[++i];
+            size_t comma = pair.find(',');
+            BackendType a, b;
+            if (comma != std::string::npos && parseBackendType(pair.substr(0, comma), a) &&
+                parseBackendType(pair.substr(comma + 1), b))
+                compareTypes = {a, b};
+            else
+                std::cout << "Bad backend pair: " << pair << std::endl;
+        }
+        else if (arg == "--compare-frames" && i + 1 < argc)
+            compareFrames = std::max(0, std::stoi(argv[++i]));
+        else if (arg == "--heatmap" && i + 1 < argc) {
+            if (!parseRenderMode(argv[++i], cpuMode))
+                std::cout << "Unknown heatmap mode: " << argv[i] << std::endl;
+        }
+        else if (arg == "--spheres" && i + 1 < argc)
+            sphereCount = std::stoi(argv[++i]);
+        else if (arg == "--lights" && i + 1 < argc)
+            lightCount = std::stoi(argv[++i]);
+        else if (arg == "--light-samples" && i + 1 < argc)
+            lightSamples = std::stoi(argv[++i]);
+        else if (arg == "--spp" && i + 1 < argc)
+            samplesPerPixel = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--sampler" && i + 1 < argc) {
+            if (!parseSamplerType(argv[++i], sampler))
+                std::cout << "Unknown sampler: " << argv[i] << std::endl;
+        }
+        else if (arg == "--trace-frames" && i + 1 < argc) {
+            std::string range = argv[++i];
+            size_t colon = range.find(':');
+            try {
+                if (colon == std::string::npos) throw std::invalid_argument(range);
+                traceFirst = std::stoull(range.substr(0, colon));
+                traceLast = std::stoull(range.substr(colon + 1));
+            } catch (const std::logic_error&) { // invalid_argument, out_of_range
+                std::cout << "Bad --trace-frames " << range << ", expected A:B (frame numbers)" << std::endl;
+            }
+        }
+        else
+            std::cout << "Unknown argument: " << arg << std::endl;
+    }
+    Profiler::get().setThreadName("main");
+    if (!tracePath.empty())
+        Profiler::get().configure(tracePath, traceFirst, traceLast);
+
     // Calls intialization in the if statement
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW\n";
         return -1;
     }
-    // Request an OpenGL 3.3 core profile context
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    useCpu = backendType == BackendType::Cpu || backendType == BackendType::CpuScalar;
+    bool needCompute = backendType == BackendType::GLCompute;
+    for (BackendType type : compareTypes) needCompute |= type == BackendType::GLCompute;
+    // Request an OpenGL 3.3 core profile context, 4.3 for compute shaders
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, needCompute ? 4 : 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #ifdef __APPLE__
@@ -180,6 +299,15 @@ int main() {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    if (needCompute && !GLCompute::load((GLADloadproc)glfwGetProcAddress)) {
+        glfwTerminate();
+        return -1;
+    }
+
+    // linked programs get cached next to the binary, later starts skip the compile
+    ShaderCache::load((GLADloadproc)glfwGetProcAddress);
+    // glMultiDrawElementsIndirect for Model::DrawBatched, 4.3+ only
+    MultiDraw::load((GLADloadproc)glfwGetProcAddress);
 
 // --------------------------
     // load shaders
@@ -211,14 +339,58 @@ int main() {
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
     glEnableVertexAttribArray(1);
 
-// ============ Initialize Metal Render ============
-    MetalRenderer metalRenderer;
-    metalRenderer.init(SCR_WIDTH, SCR_HEIGHT);
+// ============ Initialize Render Backend ============
+    std::vector<Light> lights = Scene::demo().lights;
+    if (lightCount > 0) lights = BenchScenes::randomLights(lightCount);
+    Scene scene = Scene::demo();
+    if (sphereCount > 0) scene.spheres = BenchScenes::randomSpheres(sphereCount);
+    CpuRenderSettings cpuSettings;
+    cpuSettings.mode = cpuMode;
+    auto startBackend = [&](BackendType type) {
+        std::unique_ptr<RenderBackend> created = createBackend(type, cpuSettings);
+        if (created && !created->init(SCR_WIDTH, SCR_HEIGHT)) {
+            std::cout << "ERROR::BACKEND::INIT_FAILED " << backendTypeName(type) << std::endl;
+            created.reset();
+        }
+        if (created) {
+            if (sphereCount > 0) created->setScene(scene);
+            created->setLights(lights, lightSamples);
+            created->setSampler(sampler, samplesPerPixel);
+        }
+        return created;
+    };
 
-    unsigned int rayTracedTexture = metalRenderer.getOpenGLTextureID();
+    // Compare mode: same frame on both, report, done
+    if (!compareTypes.empty()) {
+        std::unique_ptr<RenderBackend> a = startBackend(compareTypes[0]);
+        std::unique_ptr<RenderBackend> b = startBackend(compareTypes[1]);
+        if (!a || !b) {
+            glfwTerminate();
+            return -1;
+        }
+        BackendComparison result = compareBackends(*a, *b, camera, compareFrames);
+        printComparison(*a, *b, result);
+        a->cleanup();
+        b->cleanup();
+        glfwTerminate();
+        return 0;
+    }
+
+    std::unique_ptr<RenderBackend> backend = startBackend(backendType);
+    if (!backend) {
+        glfwTerminate();
+        return -1;
+    }
+    unsigned int rayTracedTexture = backend->getOpenGLTextureID();
+    if (showStats && backendType == BackendType::GLCompute)
+        std::cout << "No stats overlay on the compute backend (the image stays on the GPU)" << std::endl;
 
     // Main loop
+    uint64_t frameIndex = 0;
     while (!glfwWindowShouldClose(window)) {
+        Profiler::get().beginFrame(frameIndex);
+        PROFILE_SCOPE("frame");
+
         float currFrame = glfwGetTime();     // current time
         deltaTime = currFrame - lastFrame;   // time between frames
         lastFrame = currFrame;               // time of last frame
@@ -243,23 +415,42 @@ int main() {
         }
         // gets correct camera to use
         Camera& activeCam = useDebugCam ? debugCam : camera;
-        processInput(window, activeCam, deltaTime);
+        {
+            PROFILE_SCOPE("processInput");
+            processInput(window, activeCam, deltaTime);
+        }
 
         // processInput(window, camera, deltaTime);
         
         glClear(GL_COLOR_BUFFER_BIT);
 
-// ============ Metal Ray Tracing ============
-        metalRenderer.render(activeCam);
+// ============ Ray Tracing ============
+        if (useCpu)
+            static_cast<CpuBackend*>(backend.get())->getRenderer().setMode(cpuMode);
+        {
+            PROFILE_SCOPE("backend.render");
+            // keys the sample streams, otherwise every frame reuses frame 0's noise
+            backend->setFrameIndex((uint32_t)frameIndex);
+            backend->render(activeCam);
+        }
 
-        rayShader.use();
-        rayShader.setInt("screenTex", 0);
+        // Frame counters, gathered once per frame by the renderer
+        const RenderStats& stats = backend->getFrameStats();
+        statsWriter.write(frameIndex, deltaTime * 1000.0, stats);
+        // shows up on the next frame, the overlay is baked in during render
+        backend->setOverlayText(showStats ? statsOverlayText(stats, deltaTime * 1000.0) : "");
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, rayTracedTexture);
+        {
+            PROFILE_SCOPE("drawQuad");
+            rayShader.use();
+            rayShader.setInt("screenTex", 0);
 
-        glBindVertexArray(rayVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, rayTracedTexture);
+
+            glBindVertexArray(rayVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        }
 
         // float size = 5.0f; // zoom level
 
@@ -272,15 +463,24 @@ int main() {
         glBindVertexArray(0); 
 
         // Swap front and back buffers
-        glfwSwapBuffers(window);
+        {
+            PROFILE_SCOPE("glfwSwapBuffers");
+            glfwSwapBuffers(window);
+        }
 
         // Poll for and process events
-        glfwPollEvents();
+        {
+            PROFILE_SCOPE("glfwPollEvents");
+            glfwPollEvents();
+        }
+        frameIndex++;
     }
+    Profiler::get().finish(); // window closed before the range ended
 
     // de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
     glDeleteVertexArrays(1, &rayVAO);
+    backend->cleanup();
     // glDeleteBuffers(1, &EBO);
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
@@ -0,0 +1,512 @@
+#include <glm/glm.hpp>
+
+#include "BenchScenes.h"
+#include "Camera.h"
+#include "CpuRenderer.h"
+#include "ImageIO.h"
+#include "MeshOptimize.h"
+#include "Scene.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+---------- Mesh import pipeline benchmark ----------
+What the import steps in MeshOptimize.h / MeshSimplify.h cost and what
+they buy the tracer, on procedural meshes (no assimp needed).
+
+lod     builds each mesh's chain, then renders the demo scene plus the
+        meshes with reflection and shadow rays on every level in turn
+        (CpuRenderSettings::coarseSecondary), and with each mesh at the level
+        its distance allows for all rays. Frame time against PSNR to the
+        full detail image.
+import  the meshes as processMesh used to keep them (a vertex per face
+        corner, triangles in shuffled file order), welded, then cache and
+        fetch ordered: buffer sizes, ACMR, fetch overfetch, and the trace
+        cost of the raw against the optimised triangles.
+load    prepareMeshes (Model's CPU half of a file load) on meshes of mixed
+        size, as triangle soup, with no pool and then pools of 1, 2, 4 ...
+        threads: load time, speedup, and whether every byte came out the
+        same as the serial load. "bound" is what the biggest first schedule
+        could reach on that many cores given each mesh's own time.
+
+./mesh_bench
+./mesh_bench --section import --frames 9
+./mesh_bench --section load --max-threads 16
+./mesh_bench --rings 256 --frames 5 --out lod
+*/
+
+// Same fields and 88 bytes as Mesh.h's Vertex, without pulling in GL
+struct ImportVertex {
+    glm::vec3 Position;
+    glm::vec3 Normal;
+    glm::vec2 TexCoords;
+    glm::vec3 Tangent;
+    glm::vec3 Bitangent;
+    int m_BoneIDs[4];
+    float m_Weights[4];
+};
+
+// UV sphere with sin bumps, 2 * rings * segments triangles. Split seam like
+// BenchScenes::addTessellatedSphere, so the simplifier sees open edges.
+static void bumpySphere(glm::vec3 center, float radius, int rings, int segments,
+                        std::vector<ImportVertex>& vertices, std::vector<unsigned int>& indices)
+{
+    vertices.clear();
+    indices.clear();
+    for (int r = 0; r <= rings; r++) {
+        float theta = 3.14159265f * r / rings;
+        for (int s = 0; s <= segments; s++) {
+            float phi = 2.0f * 3.14159265f * s / segments;
+            float bump = 1.0f + 0.06f * std::sin(12.0f * theta) * std::sin(10.0f * phi);
+            ImportVertex v = {};
+            v.Normal = glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            v.Position = center + radius * bump * v.Normal;
+            v.TexCoords = glm::vec2((float)s / segments, (float)r / rings);
+            vertices.push_back(v);
+        }
+    }
+    for (int r = 0; r < rings; r++) {
+        for (int s = 0; s < segments; s++) {
+            unsigned int a = r * (segments + 1) + s;
+            unsigned int b = a + segments + 1;
+            indices.insert(indices.end(), {a, b, a + 1, a + 1, b, b + 1});
+        }
+    }
+}
+
+// What assimp hands processMesh for an OBJ like file without
+// aiProcess_JoinIdenticalVertices: every corner its own vertex, and the
+// triangles in whatever order the exporter wrote them (shuffled here)
+static void triangleSoup(const std::vector<ImportVertex>& vertices, const std::vector<unsigned int>& indices,
+                         uint32_t seed, std::vector<ImportVertex>& soup, std::vector<unsigned int>& soupIndices)
+{
+    const size_t triangles = indices.size() / 3;
+    std::vector<uint32_t> order(triangles);
+    for (size_t t = 0; t < triangles; t++) order[t] = (uint32_t)t;
+    BenchScenes::Lcg rng(seed);
+    for (size_t t = triangles; t > 1; t--) std::swap(order[t - 1], order[rng.next() % t]);
+    soup.clear();
+    soupIndices.clear();
+    for (uint32_t t : order) {
+        for (int k = 0; k < 3; k++) {
+            soupIndices.push_back((unsigned int)soup.size());
+            soup.push_back(vertices[indices[3 * t + k]]);
+        }
+    }
+}
+
+struct BenchMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    std::vector<LodLevelData> chain;
+    glm::vec3 center;
+    glm::vec3 color;
+    float reflectivity;
+};
+
+struct FrameResult {
+    double ms = 0.0; // fastest frame
+    double mraysPerSec = 0.0;
+    double nodesPerRay = 0.0, testsPerRay = 0.0;
+    std::vector<uint8_t> pixels;
+};
+
+static double msSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static FrameResult renderBest(const Scene& scene, const CpuRenderSettings& settings, int width, int height,
+                              int frames)
+{
+    Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+    CpuRenderer renderer;
+    renderer.init(width, height, settings);
+    renderer.setScene(scene);
+    renderer.render(camera); // warm up
+    FrameResult result;
+    result.ms = 1e30;
+    for (int frame = 0; frame < frames; frame++) {
+        auto start = std::chrono::steady_clock::now();
+        renderer.render(camera);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (ms < result.ms) {
+            result.ms = ms;
+            const RenderStats& stats = renderer.getFrameStats();
+            result.mraysPerSec = stats.totalRays() / (ms * 1000.0);
+            result.nodesPerRay = (double)stats.nodesVisited / std::max<uint64_t>(1, stats.totalRays());
+            result.testsPerRay = (double)stats.primitiveTests / std::max<uint64_t>(1, stats.totalRays());
+        }
+    }
+    result.pixels = renderer.getPixels();
+    return result;
+}
+
+static void printUsage()
+{
+    std::cout <<
+        "Usage: mesh_bench [options]\n"
+        "  --rings N                mesh tessellation, 4 * N * N triangles each (default 128)\n"
+        "  --size WxH               image size (default 240x180)\n"
+        "  --frames N               timed frames per row, fastest kept (default 3)\n"
+        "  --threads N              worker threads (default 1)\n"
+        "  --ratio X                triangles kept level to level (default 0.5)\n"
+        "  --levels N               LOD levels past the full mesh (default 4)\n"
+        "  --pixel-error PX         screen error the by distance row allows (default 1)\n"
+        "  --out PREFIX             write every row's image as PREFIX_<row>.ppm\n"
+        "  --max-threads N          largest pool the load section tries (default: cores)\n"
+        "  --section S              lod | import | load | all (default all)\n";
+}
+
+int main(int argc, char** argv)
+{
+    int rings = 128, width = 240, height = 180, frames = 3, threads = 1;
+    int maxThreads = (int)std::max(1u, std::thread::hardware_concurrency());
+    float pixelError = 1.0f;
+    LodChainSettings lodSettings;
+    std::string outPrefix, section = "all";
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--rings" && hasValue)            rings = std::max(4, std::stoi(argv[++i]));
+        else if (arg == "--size" && hasValue) {
+            if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+                std::cout << "ERROR::MESH_BENCH::BAD_SIZE " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--frames" && hasValue)      frames = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--threads" && hasValue)     threads = std::stoi(argv[++i]);
+        else if (arg == "--ratio" && hasValue)       lodSettings.ratio = std::stof(argv[++i]);
+        else if (arg == "--levels" && hasValue)      lodSettings.maxLevels = std::stoi(argv[++i]);
+        else if (arg == "--pixel-error" && hasValue) pixelError = std::stof(argv[++i]);
+        else if (arg == "--out" && hasValue)         outPrefix = argv[++i];
+        else if (arg == "--max-threads" && hasValue) maxThreads = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--section" && hasValue)     section = argv[++i];
+        else {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    // near and far ones, some in front of the demo's mirrors
+    const glm::vec3 centers[] = {{-2.6f, 0.2f, -4.0f}, {-1.2f, 1.8f, -9.0f}, {1.6f, 2.6f, -12.0f},
+                                 {3.0f, -0.6f, -2.5f}, {-4.5f, 1.0f, -20.0f}, {6.0f, 3.0f, -30.0f}};
+    const size_t meshCount = sizeof(centers) / sizeof(centers[0]);
+    std::vector<BenchMesh> meshes(meshCount);
+    std::vector<std::vector<ImportVertex>> meshVertices(meshCount);
+    for (size_t m = 0; m < meshCount; m++) {
+        BenchMesh& mesh = meshes[m];
+        mesh.center = centers[m];
+        mesh.color = glm::vec3(0.9f, 0.6f + 0.05f * m, 0.3f);
+        mesh.reflectivity = m % 2 ? 0.5f : 0.0f;
+        bumpySphere(mesh.center, 1.0f, rings, 2 * rings, meshVertices[m], mesh.indices);
+        mesh.positions = vertexPositions(meshVertices[m]);
+    }
+    Scene base = Scene::demo();
+    base.lights.push_back({{-3.0f, 4.0f, -2.0f}, {0.8f, 0.8f, 1.0f}});
+    CpuRenderSettings settings;
+    settings.threads = threads;
+    settings.samplesPerPixel = 2;
+    std::cout << std::fixed << std::setprecision(2);
+
+    // ============ LOD chains ============
+    if (section == "all" || section == "lod") {
+        std::cout << "LOD chains, " << 4 * rings * rings << " triangles a mesh, ratio " << lodSettings.ratio << "\n";
+        for (size_t m = 0; m < meshCount; m++) {
+            BenchMesh& mesh = meshes[m];
+            auto start = std::chrono::steady_clock::now();
+            mesh.chain = buildLodChain(mesh.positions, mesh.indices, lodSettings);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (m == 0) {
+                std::cout << "  simplify " << ms << " ms, levels:";
+                for (const LodLevelData& level : mesh.chain)
+                    std::cout << " " << level.indices.size() / 3 << " (err " << std::setprecision(4) << level.error
+                              << std::setprecision(2) << ")";
+                std::cout << "\n";
+            }
+        }
+
+        // ============ Trace ============
+
+        // A row's scene: meshes at level (0 = full) for every ray, level < 0 at
+        // the level their distance allows. coarse adds the level after that for
+        // reflection and shadow rays.
+        struct Row {
+            Scene scene;
+            size_t primaryTriangles = 0, secondaryTriangles = 0;
+        };
+        const float pixelsAtOne = (float)height / (2.0f * std::tan(glm::radians(45.0f) * 0.5f));
+        auto buildRow = [&](int level, bool coarse) {
+            Row row;
+            row.scene = base;
+            for (const BenchMesh& mesh : meshes) {
+                size_t primary = (size_t)std::max(level, 0), secondary = primary;
+                if (level < 0) {
+                    const float distance = glm::length(mesh.center - glm::vec3(0.0f, 0.0f, 3.0f)) - 1.1f;
+                    primary = secondary = lodForDistance(mesh.chain, distance, pixelsAtOne, pixelError);
+                    if (coarse) secondary++;
+                } else if (coarse) {
+                    primary = 0;
+                }
+                primary = std::min(primary, mesh.chain.size());
+                secondary = std::min(secondary, mesh.chain.size());
+                const std::vector<unsigned int>& indices = primary > 0 ? mesh.chain[primary - 1].indices : mesh.indices;
+                row.primaryTriangles += indices.size() / 3;
+                if (secondary != primary) {
+                    const LodLevelData& c = mesh.chain[secondary - 1];
+                    row.scene.addMesh(mesh.positions, indices, mesh.color, mesh.reflectivity, &c.indices, c.error);
+                    row.secondaryTriangles += c.indices.size() / 3;
+                } else {
+                    row.scene.addMesh(mesh.positions, indices, mesh.color, mesh.reflectivity);
+                    row.secondaryTriangles += indices.size() / 3;
+                }
+            }
+            return row;
+        };
+
+        const Row fullRow = buildRow(0, false);
+        const FrameResult full = renderBest(fullRow.scene, settings, width, height, frames);
+        std::cout << "\n" << width << "x" << height << ", " << settings.samplesPerPixel << " spp, " << threads
+                  << " thread(s), fastest of " << frames << "\n";
+        std::cout << std::left << std::setw(28) << "rows" << std::right << std::setw(10) << "primary"
+                  << std::setw(11) << "secondary" << std::setw(9) << "ms" << std::setw(9) << "Mrays/s"
+                  << std::setw(11) << "nodes/ray" << std::setw(11) << "tests/ray" << std::setw(9) << "speedup"
+                  << std::setw(10) << "PSNR" << "\n";
+        auto printRow = [&](const std::string& name, const Row& row, const FrameResult& result) {
+            std::cout << std::left << std::setw(28) << name << std::right << std::setw(10) << row.primaryTriangles
+                      << std::setw(11) << row.secondaryTriangles << std::setw(9) << result.ms << std::setw(9)
+                      << result.mraysPerSec << std::setw(11) << result.nodesPerRay << std::setw(11) << result.testsPerRay
+                      << std::setw(8) << full.ms / result.ms << "x";
+            const double db = ImageIO::psnr(result.pixels.data(), full.pixels.data(), width, height);
+            if (std::isinf(db)) std::cout << std::setw(10) << "inf";
+            else std::cout << std::setw(7) << db << " dB";
+            std::cout << "\n";
+            if (!outPrefix.empty()) {
+                std::string file = name;
+                std::replace(file.begin(), file.end(), ' ', '_');
+                std::replace(file.begin(), file.end(), ',', '_');
+                ImageIO::writePPM(outPrefix + "_" + file + ".ppm", result.pixels.data(), width, height);
+            }
+        };
+        printRow("full", fullRow, full);
+
+        CpuRenderSettings coarse = settings;
+        coarse.coarseSecondary = true;
+        const size_t levels = meshes.empty() ? 0 : meshes[0].chain.size();
+        for (size_t level = 1; level <= levels; level++) {
+            const Row row = buildRow((int)level, true);
+            printRow("secondary at L" + std::to_string(level), row, renderBest(row.scene, coarse, width, height, frames));
+        }
+        for (int level = 1; level <= (int)levels; level++) {
+            const Row row = buildRow(level, false);
+            printRow("everything at L" + std::to_string(level), row, renderBest(row.scene, settings, width, height, frames));
+        }
+        const Row distant = buildRow(-1, false);
+        printRow("by distance, " + std::to_string((int)pixelError) + " px", distant,
+                 renderBest(distant.scene, settings, width, height, frames));
+        const Row distantCoarse = buildRow(-1, true);
+        printRow("by distance + secondary +1", distantCoarse,
+                 renderBest(distantCoarse.scene, coarse, width, height, frames));
+
+        // ============ Parity ============
+        // the wavefront path has to trace the coarse set exactly like the megakernel
+        {
+            const Row row = buildRow(2, true);
+            CpuRenderSettings wavefront = coarse;
+            wavefront.wavefront = true;
+            const FrameResult a = renderBest(row.scene, coarse, width, height, 1);
+            const FrameResult b = renderBest(row.scene, wavefront, width, height, 1);
+            const bool same = a.pixels == b.pixels;
+            std::cout << "\ncoarse secondary, wavefront vs megakernel: " << (same ? "identical  ok" : "DIFFERS") << "\n";
+            if (!same) return 1;
+        }
+    }
+
+    // ============ Import optimisation ============
+    if (section == "all" || section == "import") {
+        struct Stage {
+            const char* name;
+            size_t vertices = 0, indexCount = 0;
+            double acmr = 0.0, fetch = 0.0; // triangle weighted over the meshes
+            double ms = 0.0;
+        };
+        Stage stages[3] = {{"as imported"}, {"welded"}, {"welded + ordered"}};
+        size_t triangles = 0;
+        auto account = [&](Stage& stage, const std::vector<ImportVertex>& vertices,
+                           const std::vector<unsigned int>& indices) {
+            const double weight = (double)(indices.size() / 3);
+            stage.vertices += vertices.size();
+            stage.indexCount += indices.size();
+            stage.acmr += vertexCacheMissRatio(indices, vertices.size()) * weight;
+            stage.fetch += vertexFetchRatio(indices, vertices.size(), sizeof(ImportVertex)) * weight;
+        };
+        std::vector<std::vector<ImportVertex>> rawVertices(meshCount), optimizedVertices(meshCount);
+        std::vector<std::vector<unsigned int>> rawIndices(meshCount), optimizedIndices(meshCount);
+        for (size_t m = 0; m < meshCount; m++) {
+            triangleSoup(meshVertices[m], meshes[m].indices, 17 + (uint32_t)m, rawVertices[m], rawIndices[m]);
+            triangles += rawIndices[m].size() / 3;
+            account(stages[0], rawVertices[m], rawIndices[m]);
+            optimizedVertices[m] = rawVertices[m];
+            optimizedIndices[m] = rawIndices[m];
+            auto start = std::chrono::steady_clock::now();
+            weldVertices(optimizedVertices[m], optimizedIndices[m]);
+            stages[1].ms += msSince(start);
+            account(stages[1], optimizedVertices[m], optimizedIndices[m]);
+            start = std::chrono::steady_clock::now();
+            optimizeVertexCache(optimizedIndices[m], optimizedVertices[m].size());
+            optimizeVertexFetch(optimizedVertices[m], optimizedIndices[m]);
+            stages[2].ms += msSince(start);
+            account(stages[2], optimizedVertices[m], optimizedIndices[m]);
+        }
+
+        std::cout << "\nImport optimisation, " << meshCount << " meshes, " << triangles << " triangles, "
+                  << sizeof(ImportVertex) << " byte vertices\n";
+        std::cout << std::left << std::setw(20) << "stage" << std::right << std::setw(10) << "vertices"
+                  << std::setw(12) << "vertex KB" << std::setw(11) << "index KB" << std::setw(8) << "ACMR"
+                  << std::setw(9) << "fetch" << std::setw(9) << "ms" << "\n";
+        for (const Stage& stage : stages) {
+            std::cout << std::left << std::setw(20) << stage.name << std::right << std::setw(10) << stage.vertices
+                      << std::setw(12) << stage.vertices * sizeof(ImportVertex) / 1024.0 << std::setw(11)
+                      << stage.indexCount * sizeof(unsigned int) / 1024.0 << std::setw(8) << stage.acmr / triangles
+                      << std::setw(9) << stage.fetch / triangles << std::setw(9);
+            if (&stage == &stages[0]) std::cout << "-" << "\n";
+            else std::cout << stage.ms << "\n";
+        }
+
+        // same triangles either way, only their order in memory differs
+        auto sceneOf = [&](const std::vector<std::vector<ImportVertex>>& vertices,
+                           const std::vector<std::vector<unsigned int>>& indices) {
+            Scene scene = base;
+            for (size_t m = 0; m < meshCount; m++)
+                scene.addMesh(vertexPositions(vertices[m]), indices[m], meshes[m].color, meshes[m].reflectivity);
+            return scene;
+        };
+        const FrameResult raw = renderBest(sceneOf(rawVertices, rawIndices), settings, width, height, frames);
+        const FrameResult optimized =
+            renderBest(sceneOf(optimizedVertices, optimizedIndices), settings, width, height, frames);
+        std::cout << "\ntrace, " << width << "x" << height << ", fastest of " << frames << "\n";
+        for (const FrameResult* result : {&raw, &optimized}) {
+            std::cout << std::left << std::setw(20) << (result == &raw ? "as imported" : "welded + ordered")
+                      << std::right << std::setw(9) << result->ms << " ms" << std::setw(9) << result->mraysPerSec
+                      << " Mrays/s" << std::setw(8) << result->nodesPerRay << " nodes/ray" << std::setw(7)
+                      << result->testsPerRay << " tests/ray\n";
+        }
+        const double db = ImageIO::psnr(optimized.pixels.data(), raw.pixels.data(), width, height);
+        std::cout << "speedup " << raw.ms / optimized.ms << "x, PSNR ";
+        if (std::isinf(db)) std::cout << "inf (identical)\n";
+        else std::cout << db << " dB\n";
+    }
+
+    // ============ Parallel load ============
+    if (section == "all" || section == "load") {
+        // 16 meshes, four each at rings, rings / 2, / 4 and / 8, as a file's
+        // worth of triangle soup. convert copies out of it like Model's does
+        // out of an aiMesh.
+        const size_t loadCount = 16;
+        std::vector<std::vector<ImportVertex>> soups(loadCount);
+        std::vector<std::vector<unsigned int>> soupIndices(loadCount);
+        size_t loadTriangles = 0;
+        for (size_t m = 0; m < loadCount; m++) {
+            const int meshRings = std::max(4, rings >> (m % 4));
+            std::vector<ImportVertex> vertices;
+            std::vector<unsigned int> indices;
+            bumpySphere(glm::vec3(0.0f), 1.0f, meshRings, 2 * meshRings, vertices, indices);
+            triangleSoup(vertices, indices, 101 + (uint32_t)m, soups[m], soupIndices[m]);
+            loadTriangles += soupIndices[m].size() / 3;
+        }
+        auto convert = [&](size_t i, PreparedMesh<ImportVertex>& mesh) {
+            mesh.vertices = soups[i];
+            mesh.indices = soupIndices[i];
+        };
+        auto weight = [&](size_t i) { return soupIndices[i].size() / 3; };
+        auto sameBytes = [](const std::vector<PreparedMesh<ImportVertex>>& a,
+                            const std::vector<PreparedMesh<ImportVertex>>& b) {
+            if (a.size() != b.size()) return false;
+            for (size_t m = 0; m < a.size(); m++) {
+                if (a[m].indices != b[m].indices || a[m].lods.size() != b[m].lods.size() ||
+                    a[m].vertices.size() != b[m].vertices.size() ||
+                    std::memcmp(a[m].vertices.data(), b[m].vertices.data(),
+                                a[m].vertices.size() * sizeof(ImportVertex)) != 0)
+                    return false;
+                for (size_t l = 0; l < a[m].lods.size(); l++)
+                    if (a[m].lods[l].indices != b[m].lods[l].indices || a[m].lods[l].error != b[m].lods[l].error)
+                        return false;
+            }
+            return true;
+        };
+        const MeshImportSettings importSettings = {true, true, lodSettings};
+
+        // each mesh on its own, for the schedule bound
+        std::vector<double> meshMs(loadCount);
+        for (size_t m = 0; m < loadCount; m++) {
+            auto start = std::chrono::steady_clock::now();
+            prepareMeshes<ImportVertex>(1, [&](size_t, PreparedMesh<ImportVertex>& mesh) { convert(m, mesh); },
+                                        [&](size_t) { return (size_t)1; }, importSettings);
+            meshMs[m] = msSince(start);
+        }
+        auto boundFor = [&](int workers) {
+            std::vector<size_t> order(loadCount);
+            for (size_t m = 0; m < loadCount; m++) order[m] = m;
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return weight(a) > weight(b); });
+            std::vector<double> busy(workers, 0.0);
+            double total = 0.0;
+            for (size_t m : order) {
+                *std::min_element(busy.begin(), busy.end()) += meshMs[m]; // next free worker takes it
+                total += meshMs[m];
+            }
+            return total / *std::max_element(busy.begin(), busy.end());
+        };
+
+        auto timeLoad = [&](ThreadPool* pool, std::vector<PreparedMesh<ImportVertex>>& out) {
+            double best = 1e30;
+            for (int frame = 0; frame < frames; frame++) {
+                auto start = std::chrono::steady_clock::now();
+                out = prepareMeshes<ImportVertex>(loadCount, convert, weight, importSettings, pool);
+                best = std::min(best, msSince(start));
+            }
+            return best;
+        };
+        std::vector<PreparedMesh<ImportVertex>> serialMeshes;
+        const double serialMs = timeLoad(nullptr, serialMeshes);
+
+        std::cout << "\nParallel load, " << loadCount << " meshes, " << loadTriangles << " triangles, "
+                  << std::thread::hardware_concurrency() << " core(s), fastest of " << frames << "\n";
+        std::cout << std::left << std::setw(12) << "threads" << std::right << std::setw(10) << "ms" << std::setw(9)
+                  << "speedup" << std::setw(12) << "efficiency" << std::setw(8) << "bound" << std::setw(11)
+                  << "same bytes" << "\n";
+        std::cout << std::left << std::setw(12) << "no pool" << std::right << std::setw(10) << serialMs
+                  << std::setw(8) << 1.0 << "x" << std::setw(12) << "-" << std::setw(7) << 1.0 << "x"
+                  << std::setw(11) << "-" << "\n";
+        std::vector<int> threadCounts;
+        for (int n = 1; n < maxThreads; n *= 2) threadCounts.push_back(n);
+        threadCounts.push_back(maxThreads);
+        bool allSame = true;
+        for (int n : threadCounts) {
+            std::unique_ptr<ThreadPool> pool(new ThreadPool(n));
+            std::vector<PreparedMesh<ImportVertex>> parallelMeshes;
+            const double ms = timeLoad(pool.get(), parallelMeshes);
+            const bool same = sameBytes(parallelMeshes, serialMeshes);
+            allSame = allSame && same;
+            std::cout << std::left << std::setw(12) << n << std::right << std::setw(10) << ms << std::setw(8)
+                      << serialMs / ms << "x" << std::setw(11) << 100.0 * serialMs / (ms * n) << "%" << std::setw(7)
+                      << boundFor(n) << "x" << std::setw(11) << (same ? "yes" : "NO") << "\n";
+        }
+        std::cout << "biggest mesh " << *std::max_element(meshMs.begin(), meshMs.end()) << " ms of "
+                  << serialMs << " ms serial\n";
+        if (!allSame) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,678 @@
+#include <glm/glm.hpp>
+
+#include "BenchScenes.h"
+#include "CpuRenderer.h"
+#include "PerfCounters.h"
+#include "Rasterizer.h"
+#include "RenderStats.h"
+#include "Scene.h"
+#include "Shared.h"
+#include "Wavefront.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+---------- Kernel microbenchmarks ----------
+Times the hot CPU kernels on fixed (seeded) inputs, single threaded.
+Each benchmark repeats until a run takes at least --min-time ms and keeps
+the fastest of --runs runs.
+
+./microbench
+./microbench --filter bvh --csv bench.csv
+*/
+
+struct BenchResult {
+    std::string name;
+    double nsPerOp = 0.0;
+    double mraysPerSec = 0.0; // 0 when the kernel doesn't trace rays
+    uint64_t ops = 0;         // ops per iteration
+};
+
+struct BenchOptions {
+    double minTimeMs = 200.0;
+    int runs = 5;
+    std::string filter;
+};
+
+// Keeps the compiler from throwing the results away
+static volatile uint64_t g_sink = 0;
+
+// fn runs one iteration and returns something derived from its results.
+// ops = operations per iteration, rays = rays traced per iteration.
+static BenchResult runBench(const BenchOptions& options, const std::string& name,
+                            uint64_t ops, uint64_t rays, const std::function<uint64_t()>& fn)
+{
+    using Clock = std::chrono::steady_clock;
+    BenchResult result;
+    result.name = name;
+    result.ops = ops;
+
+    g_sink += fn(); // warm up caches and branch predictors
+
+    // Find an iteration count that fills the minimum run time
+    uint64_t iterations = 1;
+    while (true) {
+        auto start = Clock::now();
+        for (uint64_t i = 0; i < iterations; i++) g_sink += fn();
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (ms >= options.minTimeMs || iterations >= (1ull << 30)) break;
+        iterations *= ms > 0.0 ? std::max<uint64_t>(2, (uint64_t)(options.minTimeMs / ms)) : 10;
+    }
+
+    double bestNs = 1e300;
+    for (int run = 0; run < options.runs; run++) {
+        auto start = Clock::now();
+        for (uint64_t i = 0; i < iterations; i++) g_sink += fn();
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        bestNs = std::min(bestNs, ns / (double)iterations);
+    }
+
+    result.nsPerOp = bestNs / (double)ops;
+    if (rays > 0) result.mraysPerSec = (double)rays / bestNs * 1000.0;
+    return result;
+}
+
+static void printUsage() {
+    std::cout <<
+        "Usage: microbench [options]\n"
+        "  --filter TEXT    only run benchmarks whose name contains TEXT\n"
+        "  --min-time MS    minimum time per run (default 200)\n"
+        "  --runs N         runs per benchmark, the fastest is kept (default 5)\n"
+        "  --csv FILE       also write the results as CSV\n";
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    std::string csvPath;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--filter" && hasValue)         options.filter = argv[++i];
+        else if (arg == "--min-time" && hasValue)  options.minTimeMs = std::stod(argv[++i]);
+        else if (arg == "--runs" && hasValue)      options.runs = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--csv" && hasValue)       csvPath = argv[++i];
+        else {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    // ============ Fixed inputs ============
+    const int rayWidth = 256, rayHeight = 256;
+    const std::vector<Ray> coherent = BenchScenes::coherentRays(rayWidth, rayHeight);
+    const std::vector<Ray> incoherent = BenchScenes::incoherentRays(rayWidth * rayHeight);
+
+    // Brute force primitive sets, small enough to stay in L1
+    Scene sphereSet;
+    sphereSet.spheres = BenchScenes::randomSpheres(64);
+    sphereSet.buildBVH(); // also fills the SIMD packets
+
+    Scene triangleSet;
+    BenchScenes::addTessellatedSphere(triangleSet, glm::vec3(0.0f, 0.0f, -10.0f), 4.0f, 4, 8);
+
+    Scene traversal = BenchScenes::traversalScene();
+    traversal.buildBVH();
+
+    std::cout << "rays per set: " << coherent.size()
+              << ", traversal scene: " << traversal.primitiveCount() << " prims, "
+              << traversal.bvh.nodes.size() << " nodes" << std::endl;
+
+    std::vector<BenchResult> results;
+    auto bench = [&](const std::string& name, uint64_t ops, uint64_t rays, const std::function<uint64_t()>& fn) {
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos) return;
+        results.push_back(runBench(options, name, ops, rays, fn));
+        const BenchResult& r = results.back();
+        std::cout << std::left << std::setw(28) << r.name << std::right
+                  << std::fixed << std::setprecision(2) << std::setw(10) << r.nsPerOp << " ns/op";
+        if (r.mraysPerSec > 0.0) std::cout << std::setw(10) << r.mraysPerSec << " Mrays/s";
+        std::cout << std::endl;
+    };
+
+    // ============ Sphere::intersect, scalar vs SIMD ============
+    // One op = one ray against one sphere
+    const uint64_t sphereOps = coherent.size() * sphereSet.spheres.size();
+
+    auto scalarSpheres = [&](const Ray& ray) {
+        Hit hit, best;
+        float tMax = 1e30f;
+        for (const Sphere& s : sphereSet.spheres) {
+            if (s.intersect(ray, 0.001f, tMax, hit)) {
+                tMax = hit.t;
+                best = hit;
+            }
+        }
+        return best;
+    };
+
+    // Both paths have to agree before their timings mean anything
+    {
+        RenderStats stats;
+        int mismatches = 0;
+        for (const Ray& ray : coherent) {
+            Hit a = scalarSpheres(ray), b;
+            bool hitB = sphereSet.intersectSpheresSimd(ray, 0.001f, 1e30f, b, stats);
+            if (a.hit != hitB || (a.hit && std::fabs(a.t - b.t) > 1e-3f * a.t)) mismatches++;
+        }
+        if (mismatches > 0)
+            std::cout << "ERROR::MICROBENCH::SIMD_MISMATCH " << mismatches << " rays" << std::endl;
+    }
+
+    bench("sphere_scalar", sphereOps, coherent.size(), [&] {
+        uint64_t hits = 0;
+        for (const Ray& ray : coherent) hits += scalarSpheres(ray).hit;
+        return hits;
+    });
+
+    bench("sphere_simd4", sphereOps, coherent.size(), [&] {
+        uint64_t hits = 0;
+        RenderStats stats;
+        for (const Ray& ray : coherent) {
+            Hit hit;
+            hits += sphereSet.intersectSpheresSimd(ray, 0.001f, 1e30f, hit, stats);
+        }
+        return hits;
+    });
+
+    // ============ Ray-triangle ============
+    const uint64_t triangleOps = coherent.size() * triangleSet.triangles.size();
+    bench("triangle_moller_trumbore", triangleOps, coherent.size(), [&] {
+        uint64_t hits = 0;
+        for (const Ray& ray : coherent) {
+            Hit hit;
+            float tMax = 1e30f;
+            for (const Triangle& tri : triangleSet.triangles) {
+                if (tri.intersect(ray, 0.001f, tMax, hit)) {
+                    tMax = hit.t;
+                    hits++;
+                }
+            }
+        }
+        return hits;
+    });
+
+    // ============ BVH traversal ============
+    // One op = one ray through the traversal scene
+    auto closestHit = [&](const std::vector<Ray>& rays) {
+        uint64_t hits = 0;
+        RenderStats stats;
+        for (const Ray& ray : rays) {
+            Hit hit;
+            hits += traversal.intersect(ray, 0.001f, 1e30f, hit, stats);
+        }
+        return hits;
+    };
+    auto anyHit = [&](const std::vector<Ray>& rays) {
+        uint64_t hits = 0;
+        RenderStats stats;
+        for (const Ray& ray : rays)
+            hits += traversal.occluded(ray, 0.001f, 1e30f, stats);
+        return hits;
+    };
+
+    bench("bvh_closest_coherent", coherent.size(), coherent.size(), [&] { return closestHit(coherent); });
+    bench("bvh_closest_incoherent", incoherent.size(), incoherent.size(), [&] { return closestHit(incoherent); });
+    bench("bvh_any_coherent", coherent.size(), coherent.size(), [&] { return anyHit(coherent); });
+    bench("bvh_any_incoherent", incoherent.size(), incoherent.size(), [&] { return anyHit(incoherent); });
+
+    // ============ Camera rays, BVH root vs tile frustum ============
+    // The coherent rays again, walked 16x16 tile by tile: once from the BVH
+    // root, once from the entry nodes of each tile's frustum (finding them
+    // is part of the timing). Prints the nodes visited per ray of each.
+    {
+        Scene demo = Scene::demo();
+        demo.buildBVH();
+        const std::vector<std::pair<std::string, const Scene*>> frustumScenes = {
+            {"demo", &demo}, {"dense", &traversal}
+        };
+        const GPUCamera cam = toGPU(Camera(glm::vec3(0.0f, 0.0f, 3.0f)), rayWidth, rayHeight);
+        const TileGrid grid(RenderRegion{0, 0, rayWidth, rayHeight}, 16);
+        for (const auto& entry : frustumScenes) {
+            const Scene& scene = *entry.second;
+            for (bool cull : {false, true}) {
+                RenderStats stats;
+                auto traceTiles = [&] {
+                    uint64_t hits = 0;
+                    for (int i = 0; i < grid.count(); i++) {
+                        const RenderRegion r = grid.tile(i);
+                        BVHEntrySet entrySet;
+                        if (cull) scene.frustumEntry(tileFrustum(r, cam, rayWidth, rayHeight), entrySet);
+                        for (int y = r.y0; y < r.y1; y++)
+                            for (int x = r.x0; x < r.x1; x++) {
+                                Hit hit;
+                                hits += scene.intersect(coherent[y * rayWidth + x], 0.001f, 9999.9f, hit, stats,
+                                                        cull ? &entrySet : nullptr);
+                            }
+                    }
+                    return hits;
+                };
+                const std::string name = (cull ? "camera_frustum_" : "camera_root_") + entry.first;
+                bench(name, coherent.size(), coherent.size(), traceTiles);
+                if (!results.empty() && results.back().name == name) {
+                    stats = RenderStats();
+                    traceTiles();
+                    std::cout << "  " << std::setprecision(2) << (double)stats.nodesVisited / coherent.size()
+                              << " nodes, " << (double)stats.primitiveTests / coherent.size() << " prims per ray"
+                              << std::endl;
+                }
+            }
+        }
+    }
+
+    // ============ First hits, traced vs rasterised ============
+    // Camera hit of every sample of a 4 spp grid frame: traced tile by tile
+    // from the frustum entry nodes like the renderer does, or rasterised into
+    // the visibility buffer and rebuilt from it (hybrid mode). One op = one
+    // sample. Also counts the samples where the two disagree on the primitive.
+    {
+        const int visWidth = 320, visHeight = 240, spp = 4;
+        Scene demo = Scene::demo();
+        demo.buildBVH();
+        const std::vector<std::pair<std::string, const Scene*>> visScenes = {
+            {"demo", &demo}, {"dense", &traversal}
+        };
+        const GPUCamera cam = toGPU(Camera(glm::vec3(0.0f, 0.0f, 3.0f)), visWidth, visHeight);
+        const TileGrid grid(RenderRegion{0, 0, visWidth, visHeight}, 16);
+        std::vector<glm::vec2> offsets;
+        for (int s = 0; s < spp; s++) offsets.push_back(glm::vec2(((s % 2) + 0.5f) / 2 - 0.5f, ((s / 2) + 0.5f) / 2 - 0.5f));
+        const uint64_t samples = (uint64_t)visWidth * visHeight * spp;
+        ThreadPool pool(1);
+        Rasterizer rasterizer;
+        VisibilityBuffer vis;
+        vis.resize(visWidth, visHeight, spp);
+
+        for (const auto& entry : visScenes) {
+            const Scene& scene = *entry.second;
+            std::vector<int> tracedPrims(samples);
+            auto trace = [&] {
+                uint64_t hits = 0;
+                RenderStats stats;
+                for (int i = 0; i < grid.count(); i++) {
+                    const RenderRegion r = grid.tile(i);
+                    BVHEntrySet entrySet;
+                    scene.frustumEntry(tileFrustum(r, cam, visWidth, visHeight), entrySet);
+                    for (int s = 0; s < spp; s++)
+                        for (int y = r.y0; y < r.y1; y++)
+                            for (int x = r.x0; x < r.x1; x++) {
+                                Hit hit;
+                                hits += scene.intersect(generateRay(x, y, offsets[s], cam, visWidth, visHeight),
+                                                        0.001f, 9999.9f, hit, stats, &entrySet);
+                                tracedPrims[vis.index(s, x, y)] = hit.hit ? hit.primID : -1;
+                            }
+                }
+                return hits;
+            };
+            auto raster = [&] {
+                uint64_t hits = 0;
+                rasterizer.render(scene, cam, visWidth, visHeight, offsets, 0, 0, visWidth, visHeight, pool, vis);
+                for (int s = 0; s < spp; s++)
+                    for (int y = 0; y < visHeight; y++)
+                        for (int x = 0; x < visWidth; x++) {
+                            Hit hit;
+                            Ray ray = generateRay(x, y, offsets[s], cam, visWidth, visHeight);
+                            if (!visibilityHit(scene, vis, vis.index(s, x, y), ray, 0.001f, 9999.9f, hit)) continue;
+                            hits += hit.hit;
+                        }
+                return hits;
+            };
+            bench("first_hit_traced_" + entry.first, samples, samples, trace);
+            bench("first_hit_raster_" + entry.first, samples, 0, raster);
+            if (!results.empty() && results.back().name == "first_hit_raster_" + entry.first) {
+                trace();
+                raster();
+                uint64_t mismatched = 0, retraced = 0;
+                for (int s = 0; s < spp; s++)
+                    for (int y = 0; y < visHeight; y++)
+                        for (int x = 0; x < visWidth; x++) {
+                            const size_t i = vis.index(s, x, y);
+                            Hit hit;
+                            Ray ray = generateRay(x, y, offsets[s], cam, visWidth, visHeight);
+                            if (!visibilityHit(scene, vis, i, ray, 0.001f, 9999.9f, hit)) retraced++;
+                            else if ((hit.hit ? hit.primID : -1) != tracedPrims[i]) mismatched++;
+                        }
+                std::cout << "  setup " << std::setprecision(2) << rasterizer.setupMs << " ms, tiles "
+                          << rasterizer.rasterMs << " ms, " << mismatched << " samples see another prim, "
+                          << retraced << " need tracing" << std::endl;
+            }
+        }
+    }
+
+    // ============ Shadow rays ============
+    // Hit points of the camera rays in the traversal scene, each with a
+    // shadow ray to the light. One op = one shadow ray.
+    {
+        std::vector<Ray> shadowRays;
+        std::vector<float> shadowDist;
+        const glm::vec3 lightPos(5.0f, 5.0f, 0.0f);
+        RenderStats stats;
+        for (const Ray& ray : coherent) {
+            Hit hit;
+            if (!traversal.intersect(ray, 0.001f, 1e30f, hit, stats)) continue;
+            Ray shadow;
+            shadow.origin = hit.point;
+            shadow.direction = glm::normalize(lightPos - hit.point);
+            shadowRays.push_back(shadow);
+            shadowDist.push_back(glm::distance(hit.point, lightPos));
+        }
+        const uint64_t count = shadowRays.size();
+
+        // the old way: closest hit with tMax at the light
+        bench("shadow_closest_hit", count, count, [&] {
+            uint64_t blocked = 0;
+            RenderStats shadowStats;
+            for (size_t i = 0; i < shadowRays.size(); i++) {
+                Hit hit;
+                blocked += traversal.intersect(shadowRays[i], 0.001f, shadowDist[i], hit, shadowStats);
+            }
+            return blocked;
+        });
+        bench("shadow_any_hit", count, count, [&] {
+            uint64_t blocked = 0;
+            RenderStats shadowStats;
+            for (size_t i = 0; i < shadowRays.size(); i++)
+                blocked += traversal.occluded(shadowRays[i], 0.001f, shadowDist[i], shadowStats);
+            return blocked;
+        });
+        RenderStats cacheStats;
+        bench("shadow_any_hit_cached", count, count, [&] {
+            uint64_t blocked = 0;
+            OccluderCache cache;
+            cacheStats = RenderStats();
+            for (size_t i = 0; i < shadowRays.size(); i++)
+                blocked += traversal.occluded(shadowRays[i], 0.001f, shadowDist[i], cacheStats, &cache);
+            return blocked;
+        });
+        if (cacheStats.occluderCacheLookups > 0)
+            std::cout << "  occluder cache hit rate " << std::setprecision(1)
+                      << 100.0 * cacheStats.occluderCacheHitRate() << "%" << std::endl;
+    }
+
+    // ============ Secondary ray binning ============
+    // Reflection rays (bounce 2+) of the camera rays in reflective scenes,
+    // traced in the order they were generated vs binned by direction octant
+    // and origin Morton code. One op = one ray; the binned_sort entry
+    // includes the cost of sorting.
+    {
+        Scene mirrors = BenchScenes::mirrorScene();
+        const std::vector<std::pair<std::string, Scene*>> reflective = {
+            {"demo", nullptr}, {"mirrors", &mirrors}
+        };
+        Scene demo = Scene::demo();
+        demo.buildBVH();
+        mirrors.buildBVH();
+
+        CacheMissCounter counter;
+
+        for (const auto& entry : reflective) {
+            const Scene& scene = entry.second ? *entry.second : demo;
+            WavefrontQueues q;
+            RenderStats stats;
+            for (const Ray& ray : coherent) q.paths.push_back({ray, glm::vec3(1.0f), SampleRng(0, 0), 0});
+            std::vector<PathState> secondary;
+            for (int bounce = 0; bounce < 3 && !q.paths.empty(); bounce++) {
+                q.next.clear();
+                for (PathState path : q.paths) {
+                    Hit hit;
+                    if (!scene.intersect(path.ray, 0.001f, 1e30f, hit, stats) || hit.reflectivity < 0.001f) continue;
+                    path.ray.origin = hit.point;
+                    path.ray.direction = glm::reflect(path.ray.direction, hit.normal);
+                    q.next.push_back(path);
+                }
+                std::swap(q.paths, q.next);
+                secondary.insert(secondary.end(), q.paths.begin(), q.paths.end());
+            }
+            if (secondary.empty()) continue;
+
+            q.paths = secondary;
+            binPaths(scene, q);
+            const std::vector<PathState> binned = q.paths;
+
+            auto trace = [&](const std::vector<PathState>& paths) {
+                uint64_t hits = 0;
+                RenderStats traceStats;
+                for (const PathState& path : paths) {
+                    Hit hit;
+                    hits += scene.intersect(path.ray, 0.001f, 1e30f, hit, traceStats);
+                }
+                return hits;
+            };
+            // one more untimed pass with the counters on, if the benchmark ran
+            auto missRate = [&](const std::string& name, const std::function<uint64_t()>& fn) {
+                if (results.empty() || results.back().name != name) return;
+                if (!counter.available()) {
+                    std::cout << "  cache miss rate n/a (perf_event_open refused)" << std::endl;
+                    return;
+                }
+                counter.start();
+                g_sink += fn();
+                counter.stop();
+                std::cout << "  cache miss rate " << std::setprecision(1) << 100.0 * counter.missRate()
+                          << "% (" << counter.misses << " misses)" << std::endl;
+            };
+
+            const uint64_t count = secondary.size();
+            const std::string suffix = "_" + entry.first;
+            auto generated = [&] { return trace(secondary); };
+            auto sorted = [&] { return trace(binned); };
+            auto sortAndTrace = [&] {
+                q.paths = secondary;
+                binPaths(scene, q);
+                return trace(q.paths);
+            };
+            bench("secondary_generated" + suffix, count, count, generated);
+            missRate("secondary_generated" + suffix, generated);
+            bench("secondary_binned" + suffix, count, count, sorted);
+            missRate("secondary_binned" + suffix, sorted);
+            bench("secondary_binned_sort" + suffix, count, count, sortAndTrace);
+        }
+    }
+
+    // ============ generateRay ============
+    const int frameWidth = 800, frameHeight = 600;
+    const uint64_t framePixels = (uint64_t)frameWidth * frameHeight;
+    Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+    const GPUCamera cam = toGPU(camera, frameWidth, frameHeight);
+
+    bench("generate_ray", framePixels, framePixels, [&] {
+        float sum = 0.0f;
+        for (int y = 0; y < frameHeight; y++)
+            for (int x = 0; x < frameWidth; x++)
+                sum += generateRay(x, y, glm::vec2(0.25f), cam, frameWidth, frameHeight).direction.x;
+        return (uint64_t)(sum != 0.0f);
+    });
+
+    // ============ Colour conversion + upload staging ============
+    // The GL upload itself needs a context, so this covers the CPU side of
+    // it: pack float colour to RGBA8 then copy into the staging buffer that
+    // would be handed to glTexSubImage2D. One op = one pixel.
+    std::vector<glm::vec3> colors(framePixels);
+    {
+        BenchScenes::Lcg rng(11);
+        for (glm::vec3& c : colors) c = glm::vec3(rng.range(-0.1f, 1.2f), rng.uniform(), rng.uniform());
+    }
+    std::vector<uint8_t> packed(framePixels * 4), staging(framePixels * 4);
+
+    bench("color_pack", framePixels, 0, [&] {
+        for (size_t i = 0; i < colors.size(); i++) packColor(colors[i], &packed[4 * i]);
+        return (uint64_t)packed[framePixels];
+    });
+
+    bench("color_pack_and_stage", framePixels, 0, [&] {
+        for (size_t i = 0; i < colors.size(); i++) packColor(colors[i], &packed[4 * i]);
+        std::memcpy(staging.data(), packed.data(), packed.size());
+        return (uint64_t)staging[framePixels];
+    });
+
+    // ============ Direct light vs light count ============
+    // One op = one shading point. The light BVH path should stay roughly
+    // flat as lights are added, looping over every light grows linearly.
+    {
+        std::vector<Hit> hitPoints;
+        std::vector<glm::vec3> viewDirs;
+        Scene demo = Scene::demo();
+        demo.buildBVH();
+        RenderStats stats;
+        for (const Ray& ray : BenchScenes::coherentRays(32, 32)) {
+            Hit hit;
+            if (demo.intersect(ray, 0.001f, 1e30f, hit, stats)) {
+                hitPoints.push_back(hit);
+                viewDirs.push_back(-ray.direction);
+            }
+        }
+
+        const int lightSamples = 4;
+        for (int lightCount : {1, 16, 256, 4096}) {
+            Scene lit = Scene::demo();
+            lit.lights = BenchScenes::randomLights(lightCount);
+            lit.buildBVH();
+            auto shadeAll = [&](int samples) {
+                RenderStats shadeStats;
+                float sum = 0.0f;
+                for (size_t i = 0; i < hitPoints.size(); i++) {
+                    SampleRng rng((uint32_t)i, 0);
+                    sum += lit.directLight(hitPoints[i], viewDirs[i], samples, rng, shadeStats).x;
+                }
+                return (uint64_t)(sum > 0.0f);
+            };
+            const uint64_t points = hitPoints.size();
+            const std::string suffix = "_" + std::to_string(lightCount);
+            bench("direct_light_bvh" + std::to_string(lightSamples) + suffix, points,
+                  points * std::min(lightCount, lightSamples), [&] { return shadeAll(lightSamples); });
+            bench("direct_light_all" + suffix, points, points * lightCount, [&] { return shadeAll(0); });
+        }
+    }
+
+    // ============ Samplers ============
+    // Cost of one number from each sampler, then the image error per sample
+    // count against a 1024 spp reference: the demo with 64 lights and one
+    // light sample per hit, so pixel jitter and light picks both matter.
+    {
+        const SamplerType types[] = {SamplerType::Grid, SamplerType::Random, SamplerType::Sobol, SamplerType::BlueNoise};
+        for (SamplerType type : types) {
+            if (type == SamplerType::Grid) continue; // same stream as random
+            const uint64_t count = 64 * 64 * 8;
+            bench(std::string("sampler_next_") + samplerTypeName(type), count, 0, [&] {
+                float sum = 0.0f;
+                for (uint32_t pixel = 0; pixel < 64 * 64; pixel++) {
+                    SampleRng rng(pixel % 64, pixel / 64, 64, pixel & 3u, type);
+                    for (int d = 0; d < 8; d++) sum += rng.next();
+                }
+                return (uint64_t)sum;
+            });
+        }
+
+        const std::string convergenceName = "sampler_convergence";
+        if (options.filter.empty() || convergenceName.find(options.filter) != std::string::npos) {
+            const int w = 64, h = 48;
+            Scene lit = Scene::demo();
+            lit.lights = BenchScenes::randomLights(64);
+            Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+            auto renderWith = [&](SamplerType type, int spp) {
+                CpuRenderSettings settings;
+                settings.threads = 1;
+                settings.lightSamples = 1;
+                settings.sampler = type;
+                settings.samplesPerPixel = spp;
+                CpuRenderer renderer;
+                renderer.init(w, h, settings);
+                renderer.setScene(lit);
+                renderer.render(camera);
+                return renderer.getPixels();
+            };
+            const std::vector<uint8_t> reference = renderWith(SamplerType::Random, 1024);
+            auto rmse = [&](const std::vector<uint8_t>& image) {
+                double sum = 0.0;
+                for (size_t i = 0; i < image.size(); i++) {
+                    if (i % 4 == 3) continue;
+                    double d = ((double)image[i] - (double)reference[i]) / 255.0;
+                    sum += d * d;
+                }
+                return std::sqrt(sum / (double)(w * h * 3));
+            };
+
+            std::cout << std::left << std::setw(28) << "rmse vs 1024 spp" << std::right;
+            for (SamplerType type : types) std::cout << std::setw(11) << samplerTypeName(type);
+            std::cout << std::endl;
+            for (int spp : {1, 4, 16, 64}) {
+                std::cout << std::left << std::setw(28) << (std::to_string(spp) + " spp") << std::right;
+                for (SamplerType type : types)
+                    std::cout << std::setw(11) << std::fixed << std::setprecision(4) << rmse(renderWith(type, spp));
+                std::cout << std::endl;
+            }
+        }
+    }
+
+    // ============ Full frame, megakernel vs wavefront ============
+    // One op = one pixel of a single threaded render. Same image either way,
+    // only the order the work is done in changes.
+    {
+        const int frameWidth = 320, frameHeight = 240;
+        const std::vector<std::pair<std::string, Scene>> frameScenes = {
+            {"demo", Scene::demo()},
+            {"dense", BenchScenes::traversalScene()}
+        };
+        Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+        for (const auto& entry : frameScenes) {
+            for (int variant = 0; variant < 3; variant++) {
+                static const char* names[] = {"render_megakernel_", "render_wavefront_", "render_wavefront_binned_"};
+                CpuRenderSettings settings;
+                settings.threads = 1;
+                settings.wavefront = variant > 0;
+                settings.binSecondary = variant == 2;
+                CpuRenderer renderer;
+                renderer.init(frameWidth, frameHeight, settings);
+                renderer.setScene(entry.second);
+                renderer.render(camera);
+                const uint64_t rays = renderer.getFrameStats().totalRays();
+                bench(names[variant] + entry.first,
+                      (uint64_t)frameWidth * frameHeight, rays, [&] {
+                    renderer.render(camera);
+                    return (uint64_t)renderer.getPixels()[0];
+                });
+            }
+        }
+
+        // Deep paths in the mirror scene: 16 bounces straight vs with Russian
+        // roulette from bounce 2. Prints the average path length of each.
+        for (int rouletteDepth : {0, 2}) {
+            CpuRenderSettings settings;
+            settings.threads = 1;
+            settings.maxBounces = 16;
+            settings.rouletteDepth = rouletteDepth;
+            CpuRenderer renderer;
+            renderer.init(frameWidth, frameHeight, settings);
+            renderer.setScene(BenchScenes::mirrorScene());
+            renderer.render(camera);
+            const RenderStats stats = renderer.getFrameStats();
+            const std::string name = rouletteDepth ? "render_mirrors_b16_roulette" : "render_mirrors_b16";
+            bench(name, (uint64_t)frameWidth * frameHeight, stats.totalRays(), [&] {
+                renderer.render(camera);
+                return (uint64_t)renderer.getPixels()[0];
+            });
+            if (!results.empty() && results.back().name == name)
+                std::cout << "  path " << std::setprecision(2) << stats.averagePathLength() << " segments, "
+                          << stats.averageBouncesSaved() << " bounces saved" << std::endl;
+        }
+    }
+
+    if (!csvPath.empty()) {
+        std::ofstream csv(csvPath);
+        if (!csv) {
+            std::cout << "ERROR::MICROBENCH::COULD_NOT_OPEN " << csvPath << std::endl;
+            return 1;
+        }
+        csv << "name,ns_per_op,mrays_per_sec,ops_per_iteration\n";
+        for (const BenchResult& r : results)
+            csv << r.name << "," << r.nsPerOp << "," << r.mraysPerSec << "," << r.ops << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,552 @@
+#include "Camera.h"
+#include "DrawList.h"
+#include "FrameUniforms.h"
+#include "HeadlessGL.h"
+#include "ImageIO.h"
+#include "Mesh.h"
+#include "FrustumCuller.h"
+#include "MeshBatch.h"
+#include "MeshOptimize.h"
+#include "Random.h"
+#include "Shader.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+/*
+---------- Raster path benchmark ----------
+Draws a grid of procedural meshes through Shader / Mesh (the model path in
+main.cpp, basic.vert / basic.frag) into an offscreen framebuffer on an EGL
+surfaceless context, so it runs on Mesa llvmpipe without a window.
+
+Reports:
+  startup    Shader build time, compiled vs. linked from the binary cache
+  lookup     glGetUniformLocation vs. Shader's reflected table, per call
+  frame CPU  time to submit one frame (no glFinish), median over --frames
+  frame      submit + glFinish
+  allocs     heap allocations per frame while submitting
+
+The "string lookups" row draws the same meshes the way Mesh::Draw / setMat4
+used to: glGetUniformLocation for every uniform on every draw and the
+view / projection matrices set per draw on top of FrameData. "per mesh Draw"
+calls Mesh::Draw in load order, "draw list" submits a DrawList sorted by
+material (what Model::Draw does). Meshes are handed the texture pairs round
+robin, so in load order every draw switches material. The two "batch" rows
+draw a MeshBatch of all meshes (shared buffers, texture array): one
+glDrawElementsBaseVertex per mesh, or one glMultiDrawElementsIndirect on 4.3+.
+The "culled" rows run a FrustumCuller over the draw list first (one thread,
+then a pool) and draw what's left at the LOD it picked; they also print the
+cull time and drawn triangles per frame. Every sphere carries coarser LODs
+(every 2nd / 4th ring and segment). --field scatters the meshes all around
+the camera instead of a grid in front of it, so most of them are off screen.
+The two "import" rows draw one sphere at every grid spot, first the way
+processMesh used to get it from assimp (a vertex per face corner, triangles
+shuffled), then after the import stage (MeshOptimize.h: welded, cache and
+fetch ordered). Use a high --detail for those, small spheres are fill bound.
+
+./raster_bench
+./raster_bench --meshes 2000 --frames 50
+./raster_bench --meshes 5000 --field
+./raster_bench --meshes 100 --detail 64
+*/
+
+static void printUsage() {
+    std::cout <<
+        "Usage: raster_bench [options]\n"
+        "  --meshes N               meshes in the grid (default 500)\n"
+        "  --detail N               sphere rings, 2N segments per mesh (default 8)\n"
+        "  --textures N             distinct diffuse/specular texture pairs (default 16)\n"
+        "  --frames N               timed frames per mode (default 100)\n"
+        "  --width N --height N     framebuffer size (default 800x600)\n"
+        "  --shaders DIR            where basic.vert / basic.frag live (default <repo>/shaders)\n"
+        "  --cache DIR              program binary cache, cleared first (default raster_bench_cache)\n"
+        "  --no-cache               compile every time\n"
+        "  --field                  meshes scattered all around the camera instead of a grid ahead\n"
+        "  --lod-error PX           screen space error the culled rows allow when picking LODs (default 1)\n";
+}
+
+// Keeps the compiler from throwing the lookups away
+static volatile int g_sink = 0;
+
+// Counts every operator new, the draw loops are meant to stay at zero
+static std::atomic<size_t> g_allocations{0};
+
+// The whole replaceable set, plain, array and nothrow, so every new pairs
+// with a delete of this file. Every delete ends in one out of line free: with
+// free() inlined into them GCC sees it called on the result of operator new
+// at each call site and flags it (-Wmismatched-new-delete).
+__attribute__((noinline)) static void releaseBlock(void* p) noexcept { std::free(p); }
+
+void* operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return ::operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept { return ::operator new(size, tag); }
+void operator delete(void* p) noexcept { releaseBlock(p); }
+void operator delete[](void* p) noexcept { releaseBlock(p); }
+void operator delete(void* p, size_t) noexcept { releaseBlock(p); }
+void operator delete[](void* p, size_t) noexcept { releaseBlock(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { releaseBlock(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { releaseBlock(p); }
+
+static double msSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double median(std::vector<double> values)
+{
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+// UV sphere in engine format, what Model::processMesh would hand Mesh
+static void makeSphere(int rings, int segments, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    vertices.clear();
+    indices.clear();
+    for (int r = 0; r <= rings; r++) {
+        float theta = 3.14159265f * r / rings;
+        for (int s = 0; s <= segments; s++) {
+            float phi = 2.0f * 3.14159265f * s / segments;
+            Vertex v = {};
+            v.Normal = glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            v.Position = 0.4f * v.Normal;
+            v.TexCoords = glm::vec2((float)s / segments, (float)r / rings);
+            vertices.push_back(v);
+        }
+    }
+    for (int r = 0; r < rings; r++) {
+        for (int s = 0; s < segments; s++) {
+            unsigned int a = r * (segments + 1) + s, b = a + segments + 1;
+            indices.insert(indices.end(), {a, b, a + 1, a + 1, b, b + 1});
+        }
+    }
+}
+
+// The same sphere with only every step-th ring and segment, over the full
+// sphere's vertices. error is how far its flat faces sit inside the sphere.
+static std::vector<unsigned int> sphereLod(int rings, int segments, int step, float radius, float& error)
+{
+    std::vector<unsigned int> indices;
+    for (int r = 0; r < rings; r += step) {
+        for (int s = 0; s < segments; s += step) {
+            unsigned int a = r * (segments + 1) + s, b = a + step * (segments + 1);
+            indices.insert(indices.end(), {a, b, a + step, a + step, b, b + step});
+        }
+    }
+    error = radius * (1.0f - std::cos(3.14159265f * step / rings));
+    return indices;
+}
+
+// Every corner its own vertex and the triangles in hashed order, what
+// assimp hands processMesh without aiProcess_JoinIdenticalVertices
+static void makeSoup(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+                     std::vector<Vertex>& soup, std::vector<unsigned int>& soupIndices)
+{
+    const size_t triangles = indices.size() / 3;
+    std::vector<uint32_t> order(triangles);
+    for (size_t t = 0; t < triangles; t++) order[t] = (uint32_t)t;
+    for (size_t t = triangles; t > 1; t--) std::swap(order[t - 1], order[pcgHash((uint32_t)t) % t]);
+    soup.clear();
+    soupIndices.clear();
+    for (uint32_t t : order) {
+        for (int k = 0; k < 3; k++) {
+            soupIndices.push_back((unsigned int)soup.size());
+            soup.push_back(vertices[indices[3 * t + k]]);
+        }
+    }
+}
+
+static unsigned int makeTexture(glm::vec3 color)
+{
+    unsigned char texel[4] = {(unsigned char)(color.r * 255), (unsigned char)(color.g * 255),
+                              (unsigned char)(color.b * 255), 255};
+    unsigned int id;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D, id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return id;
+}
+
+int main(int argc, char** argv) {
+    int meshCount = 500, detail = 8, textureCount = 16, frames = 100, width = 800, height = 600;
+    std::string cacheDir = "raster_bench_cache", shaderDir = RT_SOURCE_DIR "/shaders";
+    bool useCache = true;
+    bool field = false;
+    float lodError = 1.0f;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--meshes" && hasValue)        meshCount = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--detail" && hasValue)   detail = std::max(2, std::stoi(argv[++i]));
+        else if (arg == "--textures" && hasValue) textureCount = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--frames" && hasValue)   frames = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--width" && hasValue)    width = std::stoi(argv[++i]);
+        else if (arg == "--height" && hasValue)   height = std::stoi(argv[++i]);
+        else if (arg == "--shaders" && hasValue)  shaderDir = argv[++i];
+        else if (arg == "--cache" && hasValue)    cacheDir = argv[++i];
+        else if (arg == "--no-cache")             useCache = false;
+        else if (arg == "--field")                field = true;
+        else if (arg == "--lod-error" && hasValue) lodError = std::stof(argv[++i]);
+        else {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    if (!createHeadlessContext()) return 1;
+
+// ============ Startup ============
+    if (useCache) {
+        std::error_code error;
+        std::filesystem::remove_all(cacheDir, error);
+        if (!ShaderCache::load((GLADloadproc)eglGetProcAddress, cacheDir))
+            std::cout << "No program binary formats on this driver, compiling every time" << std::endl;
+    }
+    const std::string vertexPath = shaderDir + "/basic.vert", fragmentPath = shaderDir + "/basic.frag";
+    // a program that didn't build draws nothing, every timing and PSNR after it would be about blank frames
+    auto shaderLoaded = [&](const Shader& program) {
+        if (program.linked && !program.getUniforms().empty()) return true;
+        std::cout << "ERROR::RASTER_BENCH::SHADER_NOT_LOADED " << vertexPath << " " << fragmentPath
+                  << " (run from build/ or pass --shaders)" << std::endl;
+        return false;
+    };
+    Shader coldShader(vertexPath.c_str(), fragmentPath.c_str());
+    if (!shaderLoaded(coldShader)) return 1;
+    Shader shader(vertexPath.c_str(), fragmentPath.c_str()); // the second start
+    if (!shaderLoaded(shader)) return 1;
+    std::cout << "startup: basic shader " << coldShader.loadMs << " ms (" << (coldShader.fromCache ? "cache" : "compiled")
+              << "), again " << shader.loadMs << " ms (" << (shader.fromCache ? "cache" : "compiled") << "), "
+              << shader.getUniforms().size() << " uniforms reflected" << std::endl;
+    glDeleteProgram(coldShader.ID);
+
+    // what a set used to cost before the glUniform call itself
+    {
+        const int lookups = 100000;
+        const std::string name = "pointLights[0].position";
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < lookups; i++) g_sink += glGetUniformLocation(shader.ID, name.c_str());
+        double glNs = msSince(start) * 1e6 / lookups;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < lookups; i++) g_sink += shader.location(name);
+        double tableNs = msSince(start) * 1e6 / lookups;
+        std::cout << "uniform lookup: glGetUniformLocation " << glNs << " ns, reflected table " << tableNs
+                  << " ns" << std::endl;
+    }
+
+// ============ Scene ============
+    GLuint fbo, colorBuffer, depthBuffer;
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(1, &colorBuffer);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::RASTER_BENCH::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        return 1;
+    }
+    glViewport(0, 0, width, height);
+    glEnable(GL_DEPTH_TEST);
+
+    std::vector<Texture> textures;
+    for (int i = 0; i < textureCount; i++) {
+        float t = (float)i / textureCount;
+        textures.push_back({makeTexture(glm::vec3(t, 1.0f - t, 0.5f)), "texture_diffuse", ""});
+        textures.push_back({makeTexture(glm::vec3(0.5f)), "texture_specular", ""});
+    }
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    makeSphere(detail, 2 * detail, vertices, indices);
+    std::vector<Mesh> meshes;
+    std::vector<glm::mat4> transforms;
+    std::vector<std::vector<unsigned int>> lodIndices;
+    std::vector<float> lodErrors;
+    for (int step = 2; detail % step == 0 && step <= detail / 2; step *= 2) {
+        float error;
+        lodIndices.push_back(sphereLod(detail, 2 * detail, step, 0.4f, error));
+        lodErrors.push_back(error);
+    }
+    meshes.reserve(meshCount);
+    const int side = (int)std::ceil(std::sqrt((double)meshCount));
+    for (int i = 0; i < meshCount; i++) {
+        int pair = i % textureCount;
+        meshes.emplace_back(vertices, indices, std::vector<Texture>{textures[2 * pair], textures[2 * pair + 1]});
+        for (size_t l = 0; l < lodIndices.size(); l++) meshes.back().addLod(lodIndices[l], lodErrors[l]);
+        glm::vec3 position((i % side) - side * 0.5f, (i / side) - side * 0.5f, -(float)side);
+        if (field) { // same density, but all the way round (and up to the far plane)
+            auto unit = [&](uint32_t k) { return pcgHash(3 * (uint32_t)i + k) / 4294967295.0f * 2.0f - 1.0f; };
+            position = glm::vec3(unit(0), unit(1), unit(2)) * (float)side;
+        }
+        transforms.push_back(glm::translate(glm::mat4(1.0f), position));
+    }
+    size_t triangles = (size_t)meshCount * indices.size() / 3;
+    std::cout << meshCount << " meshes, " << triangles << " triangles, " << lodIndices.size() + 1 << " LODs, "
+              << textureCount << " texture pairs, " << width << "x" << height << (field ? ", field" : "") << std::endl;
+
+    // one sphere as it used to come out of processMesh and one after the
+    // import stage, each drawn at every grid spot
+    std::vector<Vertex> soupVertices, importedVertices;
+    std::vector<unsigned int> soupIndices, importedIndices;
+    makeSoup(vertices, indices, soupVertices, soupIndices);
+    importedVertices = soupVertices;
+    importedIndices = soupIndices;
+    MeshImportSettings importSettings;
+    importSettings.lods.maxLevels = 0; // only the buffers matter here
+    auto importStart = std::chrono::steady_clock::now();
+    prepareMesh(importedVertices, importedIndices, importSettings);
+    const double importMs = msSince(importStart);
+    std::cout << "import: " << soupVertices.size() << " -> " << importedVertices.size() << " vertices ("
+              << soupVertices.size() * sizeof(Vertex) / 1024.0 << " -> "
+              << importedVertices.size() * sizeof(Vertex) / 1024.0 << " KB), ACMR "
+              << vertexCacheMissRatio(soupIndices, soupVertices.size()) << " -> "
+              << vertexCacheMissRatio(importedIndices, importedVertices.size()) << ", " << importMs << " ms"
+              << std::endl;
+    Mesh soupMesh(soupVertices, soupIndices, {textures[0], textures[1]});
+    Mesh importedMesh(importedVertices, importedIndices, {textures[0], textures[1]});
+    DrawList soupList, importedList;
+    for (int i = 0; i < meshCount; i++) {
+        soupList.add(soupMesh, &transforms[i]);
+        importedList.add(importedMesh, &transforms[i]);
+    }
+
+    Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+    const float aspect = (float)width / (float)height;
+    FrameUniforms frameUniforms;
+    frameUniforms.init();
+    frameUniforms.attach(shader);
+
+    // everything packed into one MeshBatch, drawn by the BATCHED shader variant
+    Shader batchedShader(vertexPath.c_str(), fragmentPath.c_str(), "#define BATCHED\n");
+    if (!shaderLoaded(batchedShader)) return 1;
+    frameUniforms.attach(batchedShader);
+    bool multiDraw = MultiDraw::load((GLADloadproc)eglGetProcAddress);
+    MeshBatch batch;
+    batch.layerSize = 1; // the bench textures are 1x1 too
+    for (int i = 0; i < meshCount; i++) batch.add(meshes[i], transforms[i]);
+    auto batchStart = std::chrono::steady_clock::now();
+    if (!batch.build()) return 1;
+    std::cout << "batch: " << batch.size() << " draws, " << batch.getTextureLayers() << " texture layers, built in "
+              << msSince(batchStart) << " ms, multi draw indirect " << (multiDraw ? "yes" : "no (4.3+)") << std::endl;
+
+    for (Shader* program : {&shader, &batchedShader}) {
+        program->use();
+        program->setVec3("pointLights[0].position", glm::vec3(0.0f, 5.0f, 5.0f));
+        program->setFloat("pointLights[0].constant", 1.0f);
+        program->setFloat("pointLights[0].linear", 0.01f);
+        program->setFloat("pointLights[0].quadratic", 0.001f);
+        program->setVec3("pointLights[0].ambient", glm::vec3(0.1f));
+        program->setVec3("pointLights[0].diffuse", glm::vec3(0.8f));
+        program->setVec3("pointLights[0].specular", glm::vec3(1.0f));
+        program->setFloat("material.shininess", 32.0f);
+        // Mesh binds diffuse then specular, the batch reads both out of the array
+        program->setInt("material.diffuse", 0);
+        program->setInt("material.specular", 1);
+    }
+
+// ============ Frames ============
+    // the old per draw pattern, for comparison. basic.vert reads the matrices
+    // from FrameData now, so that still gets written (same image, same GPU
+    // work) and the per draw lookups + sets come on top, as they used to.
+    auto drawLegacy = [&](float seconds) {
+        frameUniforms.update(camera, aspect, seconds);
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Fov), aspect, 0.1f, 100.0f);
+        glUniform1f(glGetUniformLocation(shader.ID, "currFrame"), seconds);
+        for (int i = 0; i < meshCount; i++) {
+            glUniformMatrix4fv(glGetUniformLocation(shader.ID, "view"), 1, GL_FALSE, &view[0][0]);
+            glUniformMatrix4fv(glGetUniformLocation(shader.ID, "projection"), 1, GL_FALSE, &projection[0][0]);
+            glUniformMatrix4fv(glGetUniformLocation(shader.ID, "model"), 1, GL_FALSE, &transforms[i][0][0]);
+            Mesh& mesh = meshes[i];
+            unsigned int diffuseNr = 1, specularNr = 1;
+            for (unsigned int t = 0; t < mesh.textures.size(); t++) {
+                glActiveTexture(GL_TEXTURE0 + t);
+                std::string name = mesh.textures[t].type;
+                std::string number = name == "texture_diffuse" ? std::to_string(diffuseNr++)
+                                                                : std::to_string(specularNr++);
+                glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), t);
+                glBindTexture(GL_TEXTURE_2D, mesh.textures[t].id);
+            }
+            glBindVertexArray(mesh.VAO);
+            glDrawElements(GL_TRIANGLES, (GLsizei)mesh.indices.size(), GL_UNSIGNED_INT, 0);
+            glBindVertexArray(0);
+            glActiveTexture(GL_TEXTURE0);
+        }
+    };
+    auto drawPerMesh = [&](float seconds) {
+        frameUniforms.update(camera, aspect, seconds);
+        for (int i = 0; i < meshCount; i++) {
+            shader.setMat4("model", transforms[i]);
+            meshes[i].Draw(shader);
+        }
+    };
+    DrawList drawList;
+    drawList.reserve(meshes.size());
+    for (int i = 0; i < meshCount; i++) drawList.add(meshes[i], &transforms[i]);
+    drawList.sort();
+    auto drawSorted = [&](float seconds) {
+        frameUniforms.update(camera, aspect, seconds);
+        drawList.submit(shader);
+    };
+
+    FrustumCuller culler;
+    culler.lodPixelError = lodError;
+    culler.build(drawList);
+    ThreadPool pool;
+    std::vector<double> cullMs;
+    std::vector<size_t> drawnTriangles;
+    int cullThreads = 1;
+    cullMs.reserve(3 * frames);
+    drawnTriangles.reserve(3 * frames);
+    auto drawCulled = [&](float seconds, ThreadPool* workers) {
+        frameUniforms.update(camera, aspect, seconds);
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Fov), aspect, 0.1f, 100.0f);
+        culler.cull(camera.GetViewMatrix(), projection, glm::radians(camera.Fov), height, workers);
+        drawList.submit(shader, culler.getLods());
+        cullThreads = workers ? workers->size() : 1;
+        cullMs.push_back(culler.getStats().ms);
+        drawnTriangles.push_back(culler.getStats().triangles);
+    };
+    auto drawCulledSingle = [&](float seconds) { drawCulled(seconds, nullptr); };
+    auto drawCulledPool = [&](float seconds) { drawCulled(seconds, &pool); };
+
+    auto drawBatched = [&](float seconds) {
+        frameUniforms.update(camera, aspect, seconds);
+        batch.useIndirect = false;
+        batch.draw(batchedShader);
+    };
+    auto drawIndirect = [&](float seconds) {
+        frameUniforms.update(camera, aspect, seconds);
+        batch.useIndirect = true;
+        batch.draw(batchedShader);
+    };
+
+    auto drawSoup = [&](float seconds) {
+        frameUniforms.update(camera, aspect, seconds);
+        soupList.submit(shader);
+    };
+    auto drawImported = [&](float seconds) {
+        frameUniforms.update(camera, aspect, seconds);
+        importedList.submit(shader);
+    };
+
+    // the batch has to draw the same picture as the separate meshes, both ways
+    {
+        std::vector<uint8_t> separate((size_t)width * height * 4), batched(separate.size());
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        shader.use();
+        drawSorted(0.0f);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, separate.data());
+        batchedShader.use();
+        for (bool indirect : {false, true}) {
+            if (indirect && !multiDraw) continue;
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            if (indirect) drawIndirect(0.0f);
+            else drawBatched(0.0f);
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, batched.data());
+            std::cout << "batch (" << (indirect ? "multi draw indirect" : "draw per mesh") << ") vs draw list: PSNR "
+                      << ImageIO::psnr(separate.data(), batched.data(), width, height) << " dB" << std::endl;
+        }
+        // and the import stage mustn't change what's drawn
+        shader.use();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        drawSoup(0.0f);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, separate.data());
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        drawImported(0.0f);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, batched.data());
+        std::cout << "import, welded + ordered vs as imported: PSNR "
+                  << ImageIO::psnr(separate.data(), batched.data(), width, height) << " dB" << std::endl;
+    }
+
+    struct Row {
+        const char* name;
+        Shader* program;
+        std::function<void(float)> draw;
+    };
+    std::vector<Row> rows = {{"string lookups", &shader, drawLegacy},
+                             {"per mesh Draw", &shader, drawPerMesh},
+                             {"draw list", &shader, drawSorted},
+                             {"batch, draw per mesh", &batchedShader, drawBatched}};
+    if (multiDraw) rows.push_back({"batch, multi draw indirect", &batchedShader, drawIndirect});
+    rows.push_back({"culled, 1 thread", &shader, drawCulledSingle});
+    rows.push_back({"culled, pool", &shader, drawCulledPool});
+    rows.push_back({"import: as imported", &shader, drawSoup});
+    rows.push_back({"import: welded + ordered", &shader, drawImported});
+    for (const Row& row : rows) {
+        cullMs.clear();
+        drawnTriangles.clear();
+        std::vector<double> submitMs, frameMs;
+        submitMs.reserve(frames);
+        frameMs.reserve(frames);
+        size_t allocations = 0;
+        for (int frame = -2; frame < frames; frame++) { // two warm up frames
+            auto start = std::chrono::steady_clock::now();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            row.program->use();
+            size_t allocationsBefore = g_allocations.load(std::memory_order_relaxed);
+            row.draw(frame * (1.0f / 60.0f));
+            size_t frameAllocations = g_allocations.load(std::memory_order_relaxed) - allocationsBefore;
+            double submit = msSince(start);
+            glFinish();
+            if (frame < 0) continue;
+            submitMs.push_back(submit);
+            frameMs.push_back(msSince(start));
+            allocations += frameAllocations;
+        }
+        double submit = median(submitMs);
+        std::cout << row.name << ": frame CPU " << submit << " ms (" << submit * 1e6 / meshCount
+                  << " ns/draw), frame " << median(frameMs) << " ms, " << (double)allocations / frames
+                  << " allocs/frame" << std::endl;
+        if (!cullMs.empty()) {
+            std::vector<double> triangleCounts(drawnTriangles.begin(), drawnTriangles.end());
+            std::cout << "  cull " << median(cullMs) << " ms (" << median(cullMs) * 1e6 / meshCount
+                      << " ns/mesh, " << cullThreads
+                      << " threads), " << culler.getStats().visible << "/" << meshCount << " meshes visible, "
+                      << (size_t)median(triangleCounts) << " triangles drawn of " << culler.getStats().fullTriangles
+                      << " at LOD 0 (" << triangles << " total)" << std::endl;
+        }
+    }
+    std::cout << "draw list: " << drawList.getMaterialSwitches() << " material binds for " << meshCount
+              << " draws" << std::endl;
+
+    frameUniforms.cleanup();
+    batch.cleanup();
+    for (Mesh& mesh : meshes) glDeleteVertexArrays(1, &mesh.VAO);
+    glDeleteVertexArrays(1, &soupMesh.VAO);
+    glDeleteVertexArrays(1, &importedMesh.VAO);
+    for (const Texture& texture : textures) glDeleteTextures(1, &texture.id);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    return 0;
+}
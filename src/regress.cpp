@@ -0,0 +1,388 @@
+#include <glm/glm.hpp>
+
+#include "BenchScenes.h"
+#include "Camera.h"
+#include "CpuRenderer.h"
+#include "ImageIO.h"
+#include "Scene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+---------- Performance regression gate ----------
+Renders the benchmark scenes, compares Mrays/s and frame time percentiles
+against this machine's regress_timings.csv and the images against
+baselines/<scene>.ppm. Timings are only comparable on the same machine, so
+they never go in git: the first run records them and passes. Exits with 1 when anything is slower than the tolerance allows or an image
+drops below the PSNR threshold. Also checks that the stochastic settings
+(random lights, roulette, every sampler) give byte-identical images on 1 vs
+N threads, other tile sizes and schedules, wavefront mode and a frame
+split into regions rendered separately, that the hybrid (rasterised
+camera hits) images match the traced ones, and a few kernel edge cases
+against their scalar versions.
+
+./regress                          # from the build directory
+./regress --tolerance 0.05 --psnr 45
+./regress --update                 # re-record timings and reference images
+*/
+
+// Repo root from CMake, so the reference images are found from any directory
+#ifndef RT_SOURCE_DIR
+#define RT_SOURCE_DIR ".."
+#endif
+
+struct SceneRun {
+    std::string name;
+    std::map<std::string, double> metrics;
+    std::vector<uint8_t> pixels;
+};
+
+// Nearest rank percentile, p in [0, 100]
+static double percentile(std::vector<double> values, double p) {
+    std::sort(values.begin(), values.end());
+    size_t rank = (size_t)std::ceil(p / 100.0 * values.size());
+    return values[std::min(values.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+// Whether a bigger number is better for this metric
+static bool higherIsBetter(const std::string& metric) {
+    return metric == "mrays_per_sec";
+}
+
+static bool readBaseline(const std::string& path, std::map<std::string, std::map<std::string, double>>& baseline) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#' || line.rfind("scene,", 0) == 0) continue;
+        std::stringstream ss(line);
+        std::string scene, metric, value;
+        if (std::getline(ss, scene, ',') && std::getline(ss, metric, ',') && std::getline(ss, value))
+            baseline[scene][metric] = std::stod(value);
+    }
+    return true;
+}
+
+// Renders with settings (region split into quadrants on separate renderers
+// when split is set), the random light scene on frame 3
+static std::vector<uint8_t> renderDeterminism(const CpuRenderSettings& settings, bool split) {
+    const int width = 96, height = 72;
+    Scene scene = Scene::demo();
+    scene.lights = BenchScenes::randomLights(64);
+    Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+
+    std::vector<uint8_t> image((size_t)width * height * 4, 0);
+    const int parts = split ? 2 : 1;
+    for (int py = 0; py < parts; py++) {
+        for (int px = 0; px < parts; px++) {
+            CpuRenderSettings part = settings;
+            part.region = RenderRegion{px * width / parts, py * height / parts,
+                                       (px + 1) * width / parts, (py + 1) * height / parts};
+            CpuRenderer renderer;
+            renderer.init(width, height, part);
+            renderer.setScene(scene);
+            renderer.setFrameIndex(3);
+            renderer.render(camera);
+            const std::vector<uint8_t>& pixels = renderer.getPixels();
+            for (int y = part.region.y0; y < part.region.y1; y++)
+                for (int x = part.region.x0; x < part.region.x1; x++)
+                    for (int c = 0; c < 4; c++) image[4 * (y * width + x) + c] = pixels[4 * (y * width + x) + c];
+        }
+    }
+    return image;
+}
+
+// Packet the way Scene::packSpheres lays it out, lanes past spheres.size() padded
+static SpherePacket makePacket(const std::vector<Sphere>& spheres) {
+    SpherePacket packet;
+    for (int lane = 0; lane < 4; lane++) {
+        const bool real = lane < (int)spheres.size();
+        packet.cx[lane] = real ? spheres[lane].center.x : 0.0f;
+        packet.cy[lane] = real ? spheres[lane].center.y : 0.0f;
+        packet.cz[lane] = real ? spheres[lane].center.z : 0.0f;
+        packet.r2[lane] = real ? spheres[lane].radius * spheres[lane].radius : -1e30f;
+        packet.ids[lane] = real ? lane : -1;
+    }
+    return packet;
+}
+
+// intersectSpherePacket against Sphere::intersect lane by lane, false on any disagreement
+static bool packetMatchesScalar(const std::vector<Sphere>& spheres, const Ray& ray, float tMax) {
+    float scalarT = tMax;
+    int scalarLane = -1;
+    for (size_t i = 0; i < spheres.size(); i++) {
+        Hit hit;
+        if (spheres[i].intersect(ray, 0.001f, scalarT, hit)) {
+            scalarT = hit.t;
+            scalarLane = (int)i;
+        }
+    }
+    float t = -1.0f;
+    const int lane = intersectSpherePacket(makePacket(spheres), ray, 0.001f, tMax, t);
+    if (lane != scalarLane) return false;
+    return lane < 0 || t == scalarT;
+}
+
+static void printUsage() {
+    std::cout <<
+        "Usage: regress [options]\n"
+        "  --baseline-dir DIR       reference images (default <repo>/baselines)\n"
+        "  --timings FILE           this machine's timing baseline, recorded if missing\n"
+        "                           (default regress_timings.csv)\n"
+        "  --tolerance X            allowed slowdown as a fraction (default 0.10)\n"
+        "  --psnr DB                minimum PSNR against the reference images (default 40)\n"
+        "  --frames N               timed frames per scene (default 20)\n"
+        "  --threads N              worker threads (default 1, keep it the same as the baseline)\n"
+        "  --update                 overwrite the timings and reference images with this run\n";
+}
+
+int main(int argc, char** argv) {
+    std::string baselineDir = RT_SOURCE_DIR "/baselines", timingsPath = "regress_timings.csv";
+    double tolerance = 0.10, minPsnr = 40.0;
+    int frames = 20, threads = 1;
+    bool update = false;
+    const int width = 160, height = 120; // small so the reference images can live in git
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--baseline-dir" && hasValue)   baselineDir = argv[++i];
+        else if (arg == "--timings" && hasValue)   timingsPath = argv[++i];
+        else if (arg == "--tolerance" && hasValue) tolerance = std::stod(argv[++i]);
+        else if (arg == "--psnr" && hasValue)      minPsnr = std::stod(argv[++i]);
+        else if (arg == "--frames" && hasValue)    frames = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--threads" && hasValue)   threads = std::stoi(argv[++i]);
+        else if (arg == "--update")                update = true;
+        else {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    // ============ Run the scenes ============
+    const std::vector<std::pair<std::string, Scene>> scenes = {
+        {"demo", Scene::demo()},
+        {"dense", BenchScenes::traversalScene()}
+    };
+
+    CpuRenderSettings settings;
+    settings.threads = threads;
+    Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+
+    std::vector<SceneRun> runs;
+    for (const auto& entry : scenes) {
+        CpuRenderer renderer;
+        renderer.init(width, height, settings);
+        renderer.setScene(entry.second);
+        renderer.render(camera); // warm up
+
+        std::vector<double> frameMs;
+        uint64_t rays = 0;
+        for (int frame = 0; frame < frames; frame++) {
+            auto start = std::chrono::steady_clock::now();
+            renderer.render(camera);
+            frameMs.push_back(std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count());
+            rays += renderer.getFrameStats().totalRays();
+        }
+        double totalMs = 0.0;
+        for (double ms : frameMs) totalMs += ms;
+
+        SceneRun run;
+        run.name = entry.first;
+        run.metrics["mrays_per_sec"] = rays > 0 ? rays / (totalMs * 1000.0) : 0.0;
+        run.metrics["frame_ms_p50"] = percentile(frameMs, 50.0);
+        run.metrics["frame_ms_p95"] = percentile(frameMs, 95.0);
+        run.metrics["frame_ms_p99"] = percentile(frameMs, 99.0);
+        run.pixels = renderer.getPixels();
+        runs.push_back(run);
+        std::cout << "rendered " << run.name << ": " << run.metrics["frame_ms_p50"] << " ms p50" << std::endl;
+    }
+
+    // ============ Record ============
+    // Timings stay local to the machine (the build dir by default), only the
+    // images are shared through git
+    auto writeTimings = [&] {
+        std::ofstream out(timingsPath);
+        if (!out) {
+            std::cout << "ERROR::REGRESS::COULD_NOT_OPEN " << timingsPath << std::endl;
+            return false;
+        }
+        out << "# regress, " << width << "x" << height << ", " << frames
+            << " frames, " << threads << " thread(s)\n";
+        out << "scene,metric,value\n";
+        for (const SceneRun& run : runs)
+            for (const auto& metric : run.metrics)
+                out << run.name << "," << metric.first << "," << metric.second << "\n";
+        return true;
+    };
+    if (update) {
+        if (!writeTimings()) return 1;
+        for (const SceneRun& run : runs)
+            ImageIO::writePPM(baselineDir + "/" + run.name + ".ppm", run.pixels.data(), width, height);
+        std::cout << "Timings written to " << timingsPath << ", images to " << baselineDir << std::endl;
+        return 0;
+    }
+
+    // ============ Compare ============
+    int failures = 0;
+    std::map<std::string, std::map<std::string, double>> baseline;
+    if (!readBaseline(timingsPath, baseline)) {
+        if (!writeTimings()) return 1;
+        std::cout << "\nNo timing baseline for this machine yet, recorded this run to " << timingsPath
+                  << " (timings get checked from the next run on)" << std::endl;
+    } else {
+        std::cout << "\n" << std::left << std::setw(8) << "scene" << std::setw(16) << "metric" << std::right
+                  << std::setw(12) << "baseline" << std::setw(12) << "current" << std::setw(10) << "change"
+                  << "  status" << std::endl;
+        for (const SceneRun& run : runs) {
+            for (const auto& metric : run.metrics) {
+                std::cout << std::left << std::setw(8) << run.name << std::setw(16) << metric.first << std::right;
+                auto sceneIt = baseline.find(run.name);
+                if (sceneIt == baseline.end() || !sceneIt->second.count(metric.first)) {
+                    std::cout << std::setw(12) << "-" << std::setw(12) << metric.second << "  missing, not checked" << std::endl;
+                    continue;
+                }
+                double base = sceneIt->second[metric.first];
+                double change = base != 0.0 ? (metric.second - base) / base : 0.0;
+                // positive = worse, whichever direction the metric goes
+                double worse = higherIsBetter(metric.first) ? -change : change;
+
+                const char* status = "ok";
+                if (worse > tolerance) {
+                    status = "REGRESSED";
+                    failures++;
+                } else if (worse < -tolerance) {
+                    status = "faster (consider --update)";
+                }
+                std::cout << std::fixed << std::setprecision(3) << std::setw(12) << base << std::setw(12) << metric.second
+                          << std::showpos << std::setprecision(1) << std::setw(9) << 100.0 * change << "%"
+                          << std::noshowpos << "  " << status << std::endl;
+            }
+        }
+    }
+
+    std::cout << std::endl;
+    for (const SceneRun& run : runs) {
+        std::vector<uint8_t> reference;
+        int refWidth = 0, refHeight = 0;
+        const std::string refPath = baselineDir + "/" + run.name + ".ppm";
+        if (!ImageIO::readPPM(refPath, reference, refWidth, refHeight)) {
+            failures++;
+            continue;
+        }
+        if (refWidth != width || refHeight != height) {
+            std::cout << run.name << " image: reference is " << refWidth << "x" << refHeight
+                      << ", expected " << width << "x" << height << "  REGRESSED" << std::endl;
+            failures++;
+            continue;
+        }
+        double db = ImageIO::psnr(run.pixels.data(), reference.data(), width, height);
+        bool ok = db >= minPsnr;
+        if (!ok) failures++;
+        std::cout << run.name << " image: PSNR ";
+        if (std::isinf(db)) std::cout << "inf (identical)";
+        else std::cout << std::setprecision(2) << db << " dB";
+        std::cout << (ok ? "  ok" : "  REGRESSED (shading changed)") << std::endl;
+        if (!ok) {
+            const std::string diffPath = run.name + "_current.ppm";
+            ImageIO::writePPM(diffPath, run.pixels.data(), width, height);
+            std::cout << "  wrote " << diffPath << " to compare against " << refPath << std::endl;
+        }
+    }
+
+    // ============ Hybrid ============
+    // Rasterised camera hits against the traced frame just rendered
+    std::cout << std::endl;
+    for (size_t i = 0; i < scenes.size(); i++) {
+        CpuRenderSettings hybrid = settings;
+        hybrid.hybrid = true;
+        CpuRenderer renderer;
+        renderer.init(width, height, hybrid);
+        renderer.setScene(scenes[i].second);
+        renderer.render(camera);
+        double db = ImageIO::psnr(renderer.getPixels().data(), runs[i].pixels.data(), width, height);
+        bool ok = db >= minPsnr;
+        if (!ok) failures++;
+        std::cout << runs[i].name << " hybrid vs traced: PSNR ";
+        if (std::isinf(db)) std::cout << "inf (identical)";
+        else std::cout << std::setprecision(2) << db << " dB";
+        std::cout << ", raster " << std::setprecision(2) << renderer.getFrameTiming().rasterMs << " ms"
+                  << (ok ? "  ok" : "  REGRESSED") << std::endl;
+    }
+
+    // ============ Determinism ============
+    std::cout << std::endl;
+    for (SamplerType sampler : {SamplerType::Random, SamplerType::Sobol, SamplerType::BlueNoise}) {
+        CpuRenderSettings base;
+        base.threads = 1;
+        base.maxBounces = 8;
+        base.rouletteDepth = 2;
+        base.lightSamples = 2;
+        base.sampler = sampler;
+        const std::vector<uint8_t> reference = renderDeterminism(base, false);
+
+        std::vector<std::pair<std::string, CpuRenderSettings>> variants;
+        CpuRenderSettings v = base;
+        v.threads = 4;
+        variants.push_back({"4 threads", v});
+        v.threads = 3;
+        v.tileSize = 7;
+        v.schedule = TileSchedule::Interleaved;
+        variants.push_back({"3 threads, 7px interleaved", v});
+        v = base;
+        v.threads = 2;
+        v.wavefront = v.binSecondary = true;
+        variants.push_back({"wavefront + binning", v});
+        variants.push_back({"4 regions", base});
+
+        for (const auto& variant : variants) {
+            bool same = renderDeterminism(variant.second, variant.first == "4 regions") == reference;
+            if (!same) failures++;
+            std::cout << "determinism " << std::left << std::setw(10) << samplerTypeName(sampler)
+                      << std::setw(28) << variant.first << std::right
+                      << (same ? "identical  ok" : "DIFFERS from 1 thread") << std::endl;
+        }
+    }
+
+    // ============ Kernel edge cases ============
+    // whole packet missing or behind the ray, with the "infinite" tMax callers pass
+    std::cout << std::endl;
+    {
+        const Sphere ahead = {{0.0f, 0.0f, -5.0f}, 1.0f, glm::vec3(1.0f), 0.0f};
+        const Sphere aside = {{4.0f, 0.0f, -5.0f}, 1.0f, glm::vec3(1.0f), 0.0f};
+        std::vector<Sphere> behind;
+        for (int i = 0; i < 4; i++) behind.push_back({{0.3f * i, 0.0f, 3.0f + i}, 1.0f, glm::vec3(1.0f), 0.0f});
+        const std::vector<std::pair<std::string, std::vector<Sphere>>> packets = {
+            {"4 spheres behind", behind},
+            {"1 behind + 3 padding", {behind[0]}},
+            {"4 off to the side", {aside, aside, aside, aside}},
+            {"padding only", {}},
+            {"hit among misses", {aside, behind[1], ahead, aside}},
+        };
+        const Ray ray = {glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f)};
+        for (float tMax : {1e30f, std::numeric_limits<float>::infinity()}) {
+            for (const auto& packet : packets) {
+                const bool ok = packetMatchesScalar(packet.second, ray, tMax);
+                if (!ok) failures++;
+                std::cout << "sphere packet " << std::left << std::setw(22) << packet.first << "tMax "
+                          << std::setw(7) << (std::isinf(tMax) ? "inf" : "1e30") << std::right
+                          << (ok ? "matches scalar  ok" : "DIFFERS from Sphere::intersect") << std::endl;
+            }
+        }
+    }
+
+    std::cout << "\n" << (failures > 0 ? "FAIL: " : "PASS: ") << failures << " regression(s), tolerance "
+              << std::fixed << std::setprecision(0) << 100.0 * tolerance << "%, PSNR >= " << minPsnr << " dB" << std::endl;
+    return failures > 0 ? 1 : 0;
+}
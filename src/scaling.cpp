@@ -0,0 +1,244 @@
+#include <glm/glm.hpp>
+
+#include "BenchScenes.h"
+#include "Camera.h"
+#include "CpuRenderer.h"
+#include "Scene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+---------- Thread scaling sweep ----------
+Renders a fixed scene with 1, 2, 4 ... N threads for every tile size and
+scheduling policy and reports speedup, parallel efficiency and how long the
+workers sat idle.
+
+./scaling_sweep
+./scaling_sweep --max-threads 128 --tiles 8,16,32 --csv scaling.csv
+
+Reading the numbers: high idle time means load imbalance (try smaller tiles
+or dynamic scheduling). A big serial share means a single threaded stage
+caps the speedup (Amdahl). Low efficiency with little idle or serial time
+means the workers are busy but slower, which points at shared resources
+such as memory bandwidth, SMT siblings or turbo clocks dropping.
+*/
+
+struct SweepResult {
+    int threads = 0;
+    int tileSize = 0;
+    TileSchedule schedule = TileSchedule::Dynamic;
+    double frameMs = 0.0;    // median render + staging copy
+    double renderMs = 0.0;   // median render() only
+    double serialMs = 0.0;   // render() outside the thread pool
+    double stageMs = 0.0;    // copying the pixels out, what the app does before the upload
+    double idleMeanPct = 0.0;
+    double idleMaxPct = 0.0;
+    double mrays = 0.0;
+    double speedup = 1.0;
+    double efficiency = 1.0;
+    double karpFlatt = 0.0;  // experimentally determined serial fraction
+};
+
+static std::vector<int> parseList(const std::string& text) {
+    std::vector<int> values;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty()) values.push_back(std::stoi(item));
+    return values;
+}
+
+static double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+static void printUsage() {
+    std::cout <<
+        "Usage: scaling_sweep [options]\n"
+        "  --width N --height N     image size (default 800x600)\n"
+        "  --scene S                demo | dense (default dense)\n"
+        "  --max-threads N          highest thread count, 0 = all cores (default 0)\n"
+        "  --threads LIST           explicit thread counts, e.g. 1,8,32 (overrides the doubling)\n"
+        "  --tiles LIST             tile sizes (default 8,16,32,64)\n"
+        "  --schedules LIST         dynamic,static,interleaved (default all)\n"
+        "  --frames N               timed frames per config, the median is kept (default 5)\n"
+        "  --csv FILE               also write the results as CSV\n";
+}
+
+int main(int argc, char** argv) {
+    int width = 800, height = 600, frames = 5, maxThreads = 0;
+    std::string sceneName = "dense", csvPath;
+    std::vector<int> threadCounts;
+    std::vector<int> tileSizes = {8, 16, 32, 64};
+    std::vector<TileSchedule> schedules = {TileSchedule::Dynamic, TileSchedule::Static, TileSchedule::Interleaved};
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--width" && hasValue)              width = std::stoi(argv[++i]);
+        else if (arg == "--height" && hasValue)        height = std::stoi(argv[++i]);
+        else if (arg == "--scene" && hasValue)         sceneName = argv[++i];
+        else if (arg == "--max-threads" && hasValue)   maxThreads = std::stoi(argv[++i]);
+        else if (arg == "--threads" && hasValue)       threadCounts = parseList(argv[++i]);
+        else if (arg == "--tiles" && hasValue)         tileSizes = parseList(argv[++i]);
+        else if (arg == "--frames" && hasValue)        frames = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--csv" && hasValue)           csvPath = argv[++i];
+        else if (arg == "--schedules" && hasValue) {
+            schedules.clear();
+            std::stringstream ss(argv[++i]);
+            std::string name;
+            while (std::getline(ss, name, ',')) {
+                TileSchedule schedule;
+                if (!parseTileSchedule(name, schedule)) {
+                    std::cout << "Unknown schedule: " << name << std::endl;
+                    return 1;
+                }
+                schedules.push_back(schedule);
+            }
+        }
+        else {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    if (maxThreads <= 0) maxThreads = (int)std::max(1u, std::thread::hardware_concurrency());
+    if (threadCounts.empty()) {
+        for (int t = 1; t < maxThreads; t *= 2) threadCounts.push_back(t);
+        threadCounts.push_back(maxThreads);
+    }
+    // speedup is measured against the smallest count
+    std::sort(threadCounts.begin(), threadCounts.end());
+    threadCounts.erase(std::unique(threadCounts.begin(), threadCounts.end()), threadCounts.end());
+
+    Scene scene;
+    if (sceneName == "demo") scene = Scene::demo();
+    else if (sceneName == "dense") scene = BenchScenes::traversalScene();
+    else {
+        std::cout << "Unknown scene: " << sceneName << std::endl;
+        return 1;
+    }
+
+    Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+    std::vector<uint8_t> staging((size_t)width * height * 4);
+    std::vector<SweepResult> results;
+
+    std::cout << "scene " << sceneName << ", " << width << "x" << height
+              << ", " << frames << " frames per config\n\n"
+              << std::setw(7) << "threads" << std::setw(6) << "tile" << std::setw(13) << "schedule"
+              << std::setw(10) << "ms" << std::setw(9) << "speedup" << std::setw(7) << "eff"
+              << std::setw(9) << "serial" << std::setw(8) << "stage" << std::setw(9) << "idle%"
+              << std::setw(9) << "maxIdle%" << std::setw(9) << "Mrays/s" << std::setw(8) << "K-F" << std::endl;
+
+    for (int threads : threadCounts) {
+        // one renderer (and pool) per thread count, tile size and schedule can change between frames
+        CpuRenderSettings settings;
+        settings.threads = threads;
+        CpuRenderer renderer;
+        renderer.init(width, height, settings);
+        renderer.setScene(scene);
+
+        for (int tileSize : tileSizes) {
+            for (TileSchedule schedule : schedules) {
+                renderer.setTileSize(tileSize);
+                renderer.setSchedule(schedule);
+                renderer.render(camera); // warm up
+
+                std::vector<double> frameMs, renderMs, serialMs, stageMs, idleMean, idleMax;
+                for (int frame = 0; frame < frames; frame++) {
+                    renderer.render(camera);
+                    auto stageStart = std::chrono::steady_clock::now();
+                    std::memcpy(staging.data(), renderer.getPixels().data(), staging.size());
+                    double stage = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - stageStart).count();
+
+                    const FrameTiming& timing = renderer.getFrameTiming();
+                    double idleSum = 0.0, idleWorst = 0.0;
+                    for (size_t w = 0; w < timing.workerBusyMs.size(); w++) {
+                        idleSum += timing.idleFraction(w);
+                        idleWorst = std::max(idleWorst, timing.idleFraction(w));
+                    }
+                    frameMs.push_back(timing.totalMs + stage);
+                    renderMs.push_back(timing.totalMs);
+                    serialMs.push_back(timing.serialMs());
+                    stageMs.push_back(stage);
+                    idleMean.push_back(100.0 * idleSum / timing.workerBusyMs.size());
+                    idleMax.push_back(100.0 * idleWorst);
+                }
+
+                SweepResult r;
+                r.threads = renderer.getThreadCount();
+                r.tileSize = tileSize;
+                r.schedule = schedule;
+                r.frameMs = median(frameMs);
+                r.renderMs = median(renderMs);
+                r.serialMs = median(serialMs);
+                r.stageMs = median(stageMs);
+                r.idleMeanPct = median(idleMean);
+                r.idleMaxPct = median(idleMax);
+                r.mrays = renderer.getFrameStats().totalRays() / (r.renderMs * 1000.0);
+
+                // baseline = same tile size and schedule at the lowest thread count
+                for (const SweepResult& base : results) {
+                    if (base.threads == threadCounts.front() && base.tileSize == tileSize && base.schedule == schedule) {
+                        r.speedup = base.frameMs / r.frameMs;
+                        double p = (double)r.threads / base.threads;
+                        r.efficiency = r.speedup / p;
+                        if (p > 1.0) r.karpFlatt = (1.0 / r.speedup - 1.0 / p) / (1.0 - 1.0 / p);
+                        break;
+                    }
+                }
+                results.push_back(r);
+
+                std::cout << std::fixed << std::setprecision(2)
+                          << std::setw(7) << r.threads << std::setw(6) << r.tileSize
+                          << std::setw(13) << tileScheduleName(r.schedule)
+                          << std::setw(10) << r.frameMs << std::setw(9) << r.speedup
+                          << std::setw(7) << r.efficiency << std::setw(9) << r.serialMs
+                          << std::setw(8) << r.stageMs << std::setw(9) << r.idleMeanPct
+                          << std::setw(9) << r.idleMaxPct << std::setw(9) << r.mrays
+                          << std::setw(8) << std::setprecision(3) << r.karpFlatt << std::endl;
+            }
+        }
+    }
+
+    // ============ Where does it stop scaling ============
+    std::cout << "\nAt " << threadCounts.back() << " threads:" << std::endl;
+    for (const SweepResult& r : results) {
+        if (r.threads != threadCounts.back() || threadCounts.size() < 2) continue;
+        double serialShare = (r.serialMs + r.stageMs) / r.frameMs;
+        std::cout << "  tile " << std::setw(3) << r.tileSize << " " << std::setw(12) << tileScheduleName(r.schedule)
+                  << " eff " << std::setprecision(2) << r.efficiency << " -> ";
+        if (r.efficiency >= 0.85) std::cout << "scaling fine";
+        else if (r.idleMaxPct > 20.0) std::cout << "load imbalance (workers idle up to " << r.idleMaxPct << "%)";
+        else if (serialShare > 0.10) std::cout << "serial stages (" << 100.0 * serialShare << "% of the frame)";
+        else std::cout << "workers busy but slower, likely memory bandwidth / shared core resources";
+        std::cout << std::endl;
+    }
+
+    if (!csvPath.empty()) {
+        std::ofstream csv(csvPath);
+        if (!csv) {
+            std::cout << "ERROR::SCALING::COULD_NOT_OPEN " << csvPath << std::endl;
+            return 1;
+        }
+        csv << "threads,tile,schedule,frame_ms,render_ms,serial_ms,stage_ms,idle_mean_pct,idle_max_pct,"
+               "mrays_per_sec,speedup,efficiency,karp_flatt\n";
+        for (const SweepResult& r : results)
+            csv << r.threads << "," << r.tileSize << "," << tileScheduleName(r.schedule) << ","
+                << r.frameMs << "," << r.renderMs << "," << r.serialMs << "," << r.stageMs << ","
+                << r.idleMeanPct << "," << r.idleMaxPct << "," << r.mrays << ","
+                << r.speedup << "," << r.efficiency << "," << r.karpFlatt << "\n";
+    }
+    return 0;
+}